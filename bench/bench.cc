@@ -0,0 +1,666 @@
+/**
+ * @file bench.cc
+ * @brief wrapper vs. raw sqlite3 C API benchmarks
+ *
+ * Usage: sqlite3w_bench [scale]
+ *
+ * Every scenario runs once through the wrapper and once through an
+ * equivalent raw sqlite3_* loop, printing one JSON object per line:
+ * {"scenario":..., "impl":"wrapper"|"raw", "ops":..., "seconds":..., "ops_per_sec":...}
+ */
+
+#include <sqlite3w.h>
+#include <sqlite3w_columnar.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <sqlite3.h>
+
+using namespace hgl;
+using clock_type = std::chrono::steady_clock;
+
+static void report(const char * scenario, const char * impl, std::size_t ops, double seconds)
+{
+    std::printf("{\"scenario\":\"%s\",\"impl\":\"%s\",\"ops\":%zu,\"seconds\":%.6f,\"ops_per_sec\":%.1f}\n",
+        scenario, impl, ops, seconds, seconds > 0 ? static_cast<double>(ops) / seconds : 0.0);
+    std::fflush(stdout);
+}
+
+template <typename F> static void measure(const char * scenario, const char * impl, std::size_t ops, F && f)
+{
+    const auto t0 = clock_type::now();
+    f();
+    report(scenario, impl, ops, std::chrono::duration<double>(clock_type::now() - t0).count());
+}
+
+static void check(int rc, sqlite3 * db)
+{
+    if (rc != SQLITE_OK && rc != SQLITE_ROW && rc != SQLITE_DONE)
+    {
+        std::fprintf(stderr, "sqlite3 error %d: %s\n", rc, sqlite3_errmsg(db));
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static void remove_db(const char * name)
+{
+    std::remove(name);
+    std::remove((std::string(name) + "-journal").c_str());
+    std::remove((std::string(name) + "-wal").c_str());
+    std::remove((std::string(name) + "-shm").c_str());
+}
+
+static const char create_sql[] = "CREATE TABLE T (K INTEGER PRIMARY KEY, A INTEGER, B REAL, C TEXT);";
+static const char insert_sql[] = "INSERT INTO T (K, A, B, C) VALUES (?, ?, ?, ?)";
+
+// ---------------------------------------------------------------------------
+
+static void bench_insert(const char * scenario, const char * file, std::size_t n, bool txn)
+{
+    remove_db(file);
+    {
+        SQLite3 db(file);
+        db(create_sql);
+
+        // input rows are built outside the timed part, as the raw loop has none
+        std::vector<std::tuple<std::int64_t, std::int64_t, double, const char *>> rows;
+        if (txn)
+        {
+            rows.reserve(n);
+            for (std::size_t i = 0; i < n; i++)
+                rows.emplace_back(i, i * 7, i * 0.5, "payload");
+        }
+
+        measure(scenario, "wrapper", n, [&]
+        {
+            SQLite3Stmt ins(db, insert_sql);
+            if (txn)
+            {
+                SQLite3Stmt::BulkOptions opts;
+                opts.chunk_rows = 0;
+                ins.executeMany(rows, opts);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    ins(static_cast<std::int64_t>(i), static_cast<std::int64_t>(i * 7), i * 0.5, "payload");
+                    ins.reset();
+                }
+            }
+        });
+    }
+
+    remove_db(file);
+    {
+        sqlite3 * db;
+        check(sqlite3_open(file, &db), db);
+        check(sqlite3_exec(db, create_sql, nullptr, nullptr, nullptr), db);
+
+        measure(scenario, "raw", n, [&]
+        {
+            sqlite3_stmt * ins;
+            check(sqlite3_prepare_v2(db, insert_sql, -1, &ins, nullptr), db);
+            if (txn)
+                check(sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr), db);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                check(sqlite3_bind_int64(ins, 1, i), db);
+                check(sqlite3_bind_int64(ins, 2, i * 7), db);
+                check(sqlite3_bind_double(ins, 3, i * 0.5), db);
+                check(sqlite3_bind_text(ins, 4, "payload", -1, SQLITE_STATIC), db);
+                check(sqlite3_step(ins), db);
+                check(sqlite3_reset(ins), db);
+            }
+            if (txn)
+                check(sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr), db);
+            check(sqlite3_finalize(ins), db);
+        });
+
+        check(sqlite3_close(db), db);
+    }
+    remove_db(file);
+}
+
+static void fill(SQLite3 & db, std::size_t n)
+{
+    db(create_sql);
+    std::vector<std::tuple<std::int64_t, std::int64_t, double, const char *>> rows;
+    rows.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+        rows.emplace_back(i, i * 7, i * 0.5, "payload");
+    SQLite3Stmt ins(db, insert_sql);
+    ins.executeMany(rows);
+}
+
+static void bench_reads(const char * file, std::size_t rows, std::size_t n_point, std::size_t n_scan)
+{
+    remove_db(file);
+    {
+        SQLite3 db(file);
+        fill(db, rows);
+    }
+
+    static const char point_sql[] = "SELECT A, B FROM T WHERE K = ?";
+    static const char named_sql[] = "SELECT A, B FROM T WHERE K = :k";
+    static const char scan_sql[] = "SELECT A, B, C FROM T";
+    volatile std::int64_t sink = 0;
+
+    {
+        SQLite3 db(file);
+
+        measure("point_select", "wrapper", n_point, [&]
+        {
+            SQLite3Stmt sel(db, point_sql);
+            for (std::size_t i = 0; i < n_point; i++)
+            {
+                if (sel(static_cast<std::int64_t>((i * 7919) % rows)))
+                    sink = sink + sel.begin()->readInteger(0);
+            }
+        });
+
+        measure("point_select_named", "wrapper", n_point, [&]
+        {
+            SQLite3Stmt sel(db, named_sql);
+            for (std::size_t i = 0; i < n_point; i++)
+            {
+                sel.bind(":k", static_cast<std::int64_t>((i * 7919) % rows));
+                if (sel())
+                    sink = sink + sel.begin()->read<std::int64_t>("A");
+            }
+        });
+
+        measure("full_scan_cursor", "wrapper", n_scan * rows, [&]
+        {
+            SQLite3Stmt sel(db, scan_sql);
+            for (std::size_t r = 0; r < n_scan; r++)
+            {
+                std::int64_t sum = 0;
+                if (sel())
+                {
+                    for (auto & row: sel)
+                    {
+                        // read the text as well, as the string_view column of rows<>() does
+                        const std::string_view c(row.readText(2), row.readLength(2));
+                        sum += row.readInteger(0) + static_cast<std::int64_t>(row.readFloat(1)) + c.size();
+                    }
+                }
+                sink = sink + sum;
+            }
+        });
+
+        measure("full_scan_rows", "wrapper", n_scan * rows, [&]
+        {
+            SQLite3Stmt sel(db, scan_sql);
+            for (std::size_t r = 0; r < n_scan; r++)
+            {
+                std::int64_t sum = 0;
+                for (auto [a, b, c]: sel.rows<std::int64_t, double, std::string_view>())
+                    sum += a + static_cast<std::int64_t>(b) + c.size();
+                sink = sink + sum;
+            }
+        });
+    }
+
+    {
+        sqlite3 * db;
+        check(sqlite3_open(file, &db), db);
+
+        measure("point_select", "raw", n_point, [&]
+        {
+            sqlite3_stmt * sel;
+            check(sqlite3_prepare_v2(db, point_sql, -1, &sel, nullptr), db);
+            for (std::size_t i = 0; i < n_point; i++)
+            {
+                check(sqlite3_bind_int64(sel, 1, (i * 7919) % rows), db);
+                if (sqlite3_step(sel) == SQLITE_ROW)
+                    sink = sink + sqlite3_column_int64(sel, 0);
+                check(sqlite3_reset(sel), db);
+            }
+            check(sqlite3_finalize(sel), db);
+        });
+
+        // by name without lookup tables: resolve on every execution
+        measure("point_select_named", "raw", n_point, [&]
+        {
+            sqlite3_stmt * sel;
+            check(sqlite3_prepare_v2(db, named_sql, -1, &sel, nullptr), db);
+            for (std::size_t i = 0; i < n_point; i++)
+            {
+                check(sqlite3_bind_int64(sel, sqlite3_bind_parameter_index(sel, ":k"), (i * 7919) % rows), db);
+                if (sqlite3_step(sel) == SQLITE_ROW)
+                {
+                    for (int col = 0; col < sqlite3_column_count(sel); col++)
+                    {
+                        if (std::strcmp(sqlite3_column_name(sel, col), "A") == 0)
+                            sink = sink + sqlite3_column_int64(sel, col);
+                    }
+                }
+                check(sqlite3_reset(sel), db);
+            }
+            check(sqlite3_finalize(sel), db);
+        });
+
+        auto raw_scan = [&]
+        {
+            sqlite3_stmt * sel;
+            check(sqlite3_prepare_v2(db, scan_sql, -1, &sel, nullptr), db);
+            for (std::size_t r = 0; r < n_scan; r++)
+            {
+                std::int64_t sum = 0;
+                while (sqlite3_step(sel) == SQLITE_ROW)
+                {
+                    const std::string_view c(
+                        reinterpret_cast<const char *>(sqlite3_column_text(sel, 2)), sqlite3_column_bytes(sel, 2));
+                    sum += sqlite3_column_int64(sel, 0) +
+                        static_cast<std::int64_t>(sqlite3_column_double(sel, 1)) + c.size();
+                }
+                check(sqlite3_reset(sel), db);
+                sink = sink + sum;
+            }
+            check(sqlite3_finalize(sel), db);
+        };
+        measure("full_scan_cursor", "raw", n_scan * rows, raw_scan);
+        measure("full_scan_rows", "raw", n_scan * rows, raw_scan);
+
+        check(sqlite3_close(db), db);
+    }
+
+    remove_db(file);
+}
+
+static void bench_builders(std::size_t n)
+{
+    SQLite3 db;
+    db(create_sql);
+
+    measure("make_select_runtime", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            db.makeSelect("T", "A,B", "K=?");
+    });
+
+    measure("make_select_constexpr", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            db.makeSelect<"T", "A,B", "K=?">();
+    });
+
+    measure("make_select_uncached", "wrapper", n, [&]
+    {
+        db.setStmtCacheCapacity(0);
+        for (std::size_t i = 0; i < n; i++)
+            db.makeSelect("T", "A,B", "K=?");
+        db.setStmtCacheCapacity(SQLite3::default_stmt_cache_capacity);
+    });
+
+    sqlite3 * raw;
+    check(sqlite3_open(":memory:", &raw), raw);
+    check(sqlite3_exec(raw, create_sql, nullptr, nullptr, nullptr), raw);
+    // the cached wrapper scenarios reuse one statement, as a cache hit does
+    auto raw_reuse = [&]
+    {
+        sqlite3_stmt * stmt;
+        check(sqlite3_prepare_v2(raw, "SELECT A,B FROM T WHERE K=?;", -1, &stmt, nullptr), raw);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            check(sqlite3_reset(stmt), raw);
+            check(sqlite3_clear_bindings(stmt), raw);
+        }
+        check(sqlite3_finalize(stmt), raw);
+    };
+    auto raw_prepare = [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+        {
+            sqlite3_stmt * stmt;
+            check(sqlite3_prepare_v2(raw, "SELECT A,B FROM T WHERE K=?;", -1, &stmt, nullptr), raw);
+            check(sqlite3_finalize(stmt), raw);
+        }
+    };
+    measure("make_select_runtime", "raw", n, raw_reuse);
+    measure("make_select_constexpr", "raw", n, raw_reuse);
+    measure("make_select_uncached", "raw", n, raw_prepare);
+    check(sqlite3_close(raw), raw);
+}
+
+// Half of the inserts hit a primary key conflict.
+static void bench_conflicts(std::size_t n)
+{
+    static const char sql[] = "INSERT INTO T (K, A, B, C) VALUES (?, 0, 0.0, 'x')";
+
+    {
+        SQLite3 db;
+        db(create_sql);
+        db("BEGIN;");
+        measure("insert_conflicts_throw", "wrapper", n, [&]
+        {
+            SQLite3Stmt ins(db, sql);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                try
+                {
+                    ins(static_cast<std::int64_t>(i / 2));
+                }
+                catch (const SQLite3Error &)
+                {
+                }
+                ins.reset();
+            }
+        });
+        db("COMMIT;");
+    }
+
+    {
+        SQLite3 db;
+        db(create_sql);
+        db("BEGIN;");
+        measure("insert_conflicts_try", "wrapper", n, [&]
+        {
+            SQLite3Stmt ins(db, sql);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                (void)ins.tryExec(static_cast<std::int64_t>(i / 2));
+                ins.reset();
+            }
+        });
+        db("COMMIT;");
+    }
+
+    sqlite3 * db;
+    check(sqlite3_open(":memory:", &db), db);
+    check(sqlite3_exec(db, create_sql, nullptr, nullptr, nullptr), db);
+    check(sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr), db);
+    auto raw = [&]
+    {
+        sqlite3_stmt * ins;
+        check(sqlite3_prepare_v2(db, sql, -1, &ins, nullptr), db);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            check(sqlite3_bind_int64(ins, 1, i / 2), db);
+            // every other row is a duplicate key
+            if (const int rc = sqlite3_step(ins); rc != SQLITE_CONSTRAINT)
+                check(rc, db);
+            sqlite3_reset(ins);
+        }
+        check(sqlite3_finalize(ins), db);
+    };
+    measure("insert_conflicts_throw", "raw", n, raw);
+    check(sqlite3_exec(db, "DELETE FROM T", nullptr, nullptr, nullptr), db);
+    measure("insert_conflicts_try", "raw", n, raw);
+    check(sqlite3_close(db), db);
+}
+
+// A short script run repeatedly: typed executor (one-off and cached
+// statements) versus sqlite3_exec() with its text callback.
+static void bench_script(std::size_t n)
+{
+    static const char script[] =
+        "UPDATE T SET A = A + 1 WHERE K = 1;"
+        "SELECT K, A FROM T WHERE K < 16;";
+
+    SQLite3 db;
+    fill(db, 1000);
+
+    std::int64_t sum = 0;
+    auto on_row = [&sum](std::int64_t k, std::int64_t a) { sum += k + a; };
+    measure("exec_script", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            db.execScript(script, on_row);
+    });
+    measure("exec_script_cached", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            db.execScript(script, on_row, true);
+    });
+
+    auto raw_row = [](void * param, int, char ** vals, char **)
+    {
+        *static_cast<std::int64_t *>(param) += std::atoll(vals[0]) + std::atoll(vals[1]);
+        return 0;
+    };
+    sqlite3 * raw_db;
+    check(sqlite3_open(":memory:", &raw_db), raw_db);
+    check(sqlite3_exec(raw_db, create_sql, nullptr, nullptr, nullptr), raw_db);
+    check(sqlite3_exec(raw_db,
+        "WITH RECURSIVE S(K) AS (SELECT 0 UNION ALL SELECT K + 1 FROM S WHERE K < 999)"
+        " INSERT INTO T SELECT K, K * 7, K * 0.5, 'payload' FROM S;",
+        nullptr, nullptr, nullptr), raw_db);
+    auto raw = [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            check(sqlite3_exec(raw_db, script, raw_row, &sum, nullptr), raw_db);
+    };
+    measure("exec_script", "raw", n, raw);
+    measure("exec_script_cached", "raw", n, raw);
+    check(sqlite3_close(raw_db), raw_db);
+}
+
+// Repeated lookups in a small read-mostly table: result cache versus
+// stepping the prepared statement every time.
+static void bench_query_cache(std::size_t n)
+{
+    static const char lookup_sql[] = "SELECT C, A FROM T WHERE A % 16 = ? ORDER BY K";
+    volatile std::int64_t sink = 0;
+
+    SQLite3 db;
+    fill(db, 256);
+
+    measure("repeated_lookup_uncached", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            sink = sink + db.cachedQuery<std::string, std::int64_t>(lookup_sql, i % 16).size();
+    });
+
+    db.enableQueryCache();
+    measure("repeated_lookup", "wrapper", n, [&]
+    {
+        for (std::size_t i = 0; i < n; i++)
+            sink = sink + db.cachedQuery<std::string, std::int64_t>(lookup_sql, i % 16).size();
+    });
+
+    sqlite3 * raw_db;
+    check(sqlite3_open(":memory:", &raw_db), raw_db);
+    check(sqlite3_exec(raw_db, create_sql, nullptr, nullptr, nullptr), raw_db);
+    check(sqlite3_exec(raw_db,
+        "WITH RECURSIVE S(K) AS (SELECT 0 UNION ALL SELECT K + 1 FROM S WHERE K < 255)"
+        " INSERT INTO T SELECT K, K * 7, K * 0.5, 'payload' FROM S;",
+        nullptr, nullptr, nullptr), raw_db);
+    auto raw = [&]
+    {
+        sqlite3_stmt * sel;
+        check(sqlite3_prepare_v2(raw_db, lookup_sql, -1, &sel, nullptr), raw_db);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            std::vector<std::tuple<std::string, std::int64_t>> rows;
+            check(sqlite3_bind_int64(sel, 1, i % 16), raw_db);
+            while (sqlite3_step(sel) == SQLITE_ROW)
+            {
+                rows.emplace_back(reinterpret_cast<const char *>(sqlite3_column_text(sel, 0)),
+                    sqlite3_column_int64(sel, 1));
+            }
+            check(sqlite3_reset(sel), raw_db);
+            sink = sink + rows.size();
+        }
+        check(sqlite3_finalize(sel), raw_db);
+    };
+    measure("repeated_lookup_uncached", "raw", n, raw);
+    measure("repeated_lookup", "raw", n, raw);
+    check(sqlite3_close(raw_db), raw_db);
+}
+
+// Summing one column of an extract: mapped columnar file vs. a query on
+// the database it was exported from.
+static void bench_columnar(const char * file, std::size_t rows, std::size_t n_scan)
+{
+    static const char col_file[] = "bench_columnar.col";
+    static const char sum_sql[] = "SELECT A FROM T";
+    volatile std::int64_t sink = 0;
+
+    remove_db(file);
+    {
+        SQLite3 db(file);
+        fill(db, rows);
+        SQLite3Stmt sel(db, "SELECT A, B, C FROM T");
+        ColumnarFile::write(sel, col_file);
+    }
+
+    measure("column_sum", "wrapper", n_scan * rows, [&]
+    {
+        ColumnarFile extract(col_file);
+        const auto col = extract.columnIndex("A");
+        for (std::size_t r = 0; r < n_scan; r++)
+        {
+            std::int64_t sum = 0;
+            for (std::size_t g = 0; g < extract.groupCount(); g++)
+            {
+                for (auto const v: extract.chunk(g, col).ints)
+                    sum += v;
+            }
+            sink = sink + sum;
+        }
+    });
+
+    {
+        sqlite3 * db;
+        check(sqlite3_open(file, &db), db);
+        measure("column_sum", "raw", n_scan * rows, [&]
+        {
+            sqlite3_stmt * sel;
+            check(sqlite3_prepare_v2(db, sum_sql, -1, &sel, nullptr), db);
+            for (std::size_t r = 0; r < n_scan; r++)
+            {
+                std::int64_t sum = 0;
+                while (sqlite3_step(sel) == SQLITE_ROW)
+                    sum += sqlite3_column_int64(sel, 0);
+                check(sqlite3_reset(sel), db);
+                sink = sink + sum;
+            }
+            check(sqlite3_finalize(sel), db);
+        });
+        check(sqlite3_close(db), db);
+    }
+
+    std::remove(col_file);
+    remove_db(file);
+}
+
+// A second connection repeatedly holds the write lock for short bursts
+// while the measured connection inserts rows in autocommit mode.
+static void bench_busy(const char * file, std::size_t n)
+{
+    using namespace std::chrono_literals;
+
+    auto contend = [file](std::atomic<bool> & stop)
+    {
+        sqlite3 * db;
+        check(sqlite3_open(file, &db), db);
+        check(sqlite3_busy_timeout(db, 1000), db);
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            // BEGIN may give up on SQLITE_BUSY; that is the contention being measured
+            if (sqlite3_exec(db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) == SQLITE_OK)
+            {
+                std::this_thread::sleep_for(300us);
+                check(sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr), db);
+            }
+            std::this_thread::sleep_for(300us);
+        }
+        check(sqlite3_close(db), db);
+    };
+
+    remove_db(file);
+    {
+        SQLite3 setup(file);
+        setup("PRAGMA journal_mode=WAL;");
+        setup("PRAGMA synchronous=OFF;");
+        setup(create_sql);
+    }
+
+    {
+        std::atomic<bool> stop(false);
+        std::thread other(contend, std::ref(stop));
+
+        SQLite3 db(file);
+        db("PRAGMA synchronous=OFF;");
+        measure("busy_contention", "wrapper", n, [&]
+        {
+            SQLite3Stmt ins(db, insert_sql);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                ins(static_cast<std::int64_t>(i), 0, 0.0, "x");
+                ins.reset();
+            }
+        });
+
+        stop = true;
+        other.join();
+
+        auto const stats = db.getBusyStats();
+        std::printf("{\"scenario\":\"busy_contention\",\"impl\":\"wrapper\",\"busy_events\":%llu,"
+            "\"busy_retries\":%llu,\"busy_wait_us\":%llu}\n",
+            static_cast<unsigned long long>(stats.events),
+            static_cast<unsigned long long>(stats.retries),
+            static_cast<unsigned long long>(stats.wait_us));
+    }
+
+    {
+        sqlite3 * db;
+        check(sqlite3_open(file, &db), db);
+        check(sqlite3_busy_timeout(db, 4000), db);
+        check(sqlite3_exec(db, "PRAGMA synchronous=OFF; DELETE FROM T;", nullptr, nullptr, nullptr), db);
+
+        std::atomic<bool> stop(false);
+        std::thread other(contend, std::ref(stop));
+        measure("busy_contention", "raw", n, [&]
+        {
+            sqlite3_stmt * ins;
+            check(sqlite3_prepare_v2(db, insert_sql, -1, &ins, nullptr), db);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                check(sqlite3_bind_int64(ins, 1, i), db);
+                check(sqlite3_bind_int64(ins, 2, 0), db);
+                check(sqlite3_bind_double(ins, 3, 0.0), db);
+                check(sqlite3_bind_text(ins, 4, "x", -1, SQLITE_STATIC), db);
+                check(sqlite3_step(ins), db);
+                check(sqlite3_reset(ins), db);
+            }
+            check(sqlite3_finalize(ins), db);
+        });
+
+        stop = true;
+        other.join();
+        check(sqlite3_close(db), db);
+    }
+    remove_db(file);
+}
+
+int main(int argc, char const *argv[])
+{
+    std::size_t scale = 1;
+    if (argc > 1)
+        scale = std::strtoul(argv[1], nullptr, 10);
+    if (scale == 0)
+        scale = 1;
+
+    bench_insert("insert_autocommit", "bench_insert.db", 200 * scale, false);
+    bench_insert("insert_transaction", "bench_insert.db", 100000 * scale, true);
+    bench_reads("bench_reads.db", 100000 * scale, 200000 * scale, 10);
+    bench_builders(100000 * scale);
+    bench_conflicts(100000 * scale);
+    bench_script(20000 * scale);
+    bench_query_cache(50000 * scale);
+    bench_columnar("bench_columnar.db", 100000 * scale, 10);
+    bench_busy("bench_busy.db", 2000 * scale);
+
+    return 0;
+}
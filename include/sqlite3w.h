@@ -5,10 +5,23 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #if defined __GNUC__ // GCC
 # ifdef _HGL_BUILD_DL
@@ -30,9 +43,13 @@ namespace hgl
 {
     class SQLite3;
     class SQLite3Stmt;
+    class NameIndex; // src/internal.h
+    class ChangeStream; // sqlite3w_changes.h
+    class ColumnarFile; // sqlite3w_columnar.h
+    template <typename T> struct _row_col; // typed column decoding, see SQLite3Stmt::rows()
 
     /// SQLite3 error
-    class SQLite3Error final: public std::exception
+    class HGL_API SQLite3Error final: public std::exception
     {
     private:
         int     code;
@@ -51,18 +68,257 @@ namespace hgl
         int errcode() const noexcept { return code; }
     };
 
+    /**
+     * @brief result code of a non-throwing call
+     *
+     * Nothing is allocated; the message is looked up only when asked for.
+     */
+    class HGL_API SQLite3Status
+    {
+    private:
+        int             code;
+        const SQLite3 * db;
+
+        [[noreturn]] void _raise() const;
+
+    public:
+        constexpr SQLite3Status() noexcept: code(0), db(nullptr) { }
+        constexpr explicit SQLite3Status(int code, const SQLite3 * db = nullptr) noexcept:
+            code(code), db(db) { }
+
+        /**
+         * @brief check if the call succeeded
+         */
+        bool ok() const noexcept { return code == 0; }
+        explicit operator bool () const noexcept { return code == 0; }
+
+        /**
+         * @brief get the SQLite result code (SQLITE_OK on success)
+         */
+        int errcode() const noexcept { return code; }
+
+        /**
+         * @brief get the error message
+         * @note the connection's message is valid until its next API call;
+         * after that the generic text for the code is returned
+         */
+        const char * message() const noexcept;
+
+        /**
+         * @brief throw SQLite3Error if the call failed
+         */
+        void check() const { if (code != 0) _raise(); }
+    };
+
+    /**
+     * @brief value or SQLite3Status, in the manner of std::expected
+     */
+    template <typename T> class SQLite3Result
+    {
+    private:
+        T             val;
+        SQLite3Status status;
+
+    public:
+        SQLite3Result(T v) noexcept(std::is_nothrow_move_constructible_v<T>): val(std::move(v)) { }
+        SQLite3Result(SQLite3Status s) noexcept(std::is_nothrow_default_constructible_v<T>): val(), status(s) { }
+
+        bool has_value() const noexcept { return status.ok(); }
+        explicit operator bool () const noexcept { return status.ok(); }
+
+        /// unchecked access
+        T & operator*() noexcept { return val; }
+        const T & operator*() const noexcept { return val; }
+        T * operator->() noexcept { return &val; }
+        const T * operator->() const noexcept { return &val; }
+
+        /**
+         * @brief get the value, throwing SQLite3Error if there is none
+         */
+        T & value() & { status.check(); return val; }
+        const T & value() const & { status.check(); return val; }
+
+        template <typename U> T value_or(U && other) const
+            { return status.ok() ? val : static_cast<T>(std::forward<U>(other)); }
+
+        /**
+         * @brief get the status (ok() if there is a value)
+         */
+        SQLite3Status error() const noexcept { return status; }
+    };
+
+    /// string literal usable as a template argument
+    template <std::size_t N> struct FixedString
+    {
+        char data[N];
+
+        constexpr FixedString(const char (&s)[N])
+            { for (std::size_t i = 0; i < N; i++) data[i] = s[i]; }
+
+        static constexpr std::size_t size() noexcept { return N - 1; }
+        constexpr std::string_view view() const noexcept { return std::string_view(data, N - 1); }
+    };
+
+    /// virtual table column bound to a data member, see SQLite3::defineTable()
+    template <FixedString Name, auto Member> struct VTableColumn
+    {
+        static constexpr bool is_key = false;
+        static constexpr std::string_view name() noexcept { return Name.view(); }
+        template <typename Row> static const auto & get(const Row & row) noexcept { return row.*Member; }
+    };
+
+    /// the key column of a virtual table: rows are indexed by it for `=`, `<`, `>`, ... lookups
+    template <FixedString Name, auto Member> struct VTableKey: VTableColumn<Name, Member>
+    {
+        static constexpr bool is_key = true;
+    };
+
+    /// SQLite's default SQLITE_MAX_SQL_LENGTH
+    inline constexpr std::size_t sql_max_length = 1000000;
+
+    /// compile-time SQL text writer; only measures when `out` is null
+    struct _SqlSink
+    {
+        char      * out = nullptr;
+        std::size_t len = 0;
+
+        constexpr _SqlSink & operator<<(std::string_view s)
+        {
+            if (out != nullptr)
+                for (std::size_t i = 0; i < s.size(); i++) out[len + i] = s[i];
+            len += s.size();
+            return *this;
+        }
+
+        // "a,b" => "?,?"; "a,b" as assignments => "a=?,b=?"
+        constexpr _SqlSink & placeholders(std::string_view names, bool assign)
+        {
+            if (assign && names.find('=') != std::string_view::npos)
+                return *this << names;
+
+            bool first = true;
+            while (!names.empty())
+            {
+                auto const comma = names.find(',');
+                auto name = names.substr(0, comma);
+                names = comma == std::string_view::npos ?
+                    std::string_view() : names.substr(comma + 1);
+
+                while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+                while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+
+                if (!first) *this << ",";
+                if (assign) *this << name << "=";
+                *this << "?";
+                first = false;
+            }
+            return *this;
+        }
+    };
+
+    /// statement text produced at compile time by `Build(sink)`
+    template <auto Build> struct _SqlText
+    {
+        static constexpr std::size_t length = [] { _SqlSink s; Build(s); return s.len; }();
+        static_assert(length <= sql_max_length, "SQL statement too long");
+
+        static constexpr std::array<char, length + 1> text = []
+        {
+            std::array<char, length + 1> a{};
+            _SqlSink s{a.data(), 0};
+            Build(s);
+            return a;
+        }();
+    };
+
+    /// execution profile of one SQL statement text (see SQLite3::setProfiling())
+    struct StmtProfile
+    {
+        static constexpr std::size_t buckets = 24;
+
+        std::string   sql;            ///< statement text
+        std::uint64_t runs;           ///< executions finished (run to completion or reset)
+        std::uint64_t rows;           ///< result rows returned
+        std::uint64_t steps;          ///< timed SQLite3Stmt steps
+        std::uint64_t total_ns;       ///< total time of timed steps, in nanoseconds
+        std::uint64_t max_ns;         ///< slowest timed step, in nanoseconds
+        std::uint64_t fullscan_steps; ///< SQLITE_STMTSTATUS_FULLSCAN_STEP
+        std::uint64_t sorts;          ///< SQLITE_STMTSTATUS_SORT
+        std::uint64_t autoindexes;    ///< SQLITE_STMTSTATUS_AUTOINDEX
+        std::uint64_t vm_steps;       ///< SQLITE_STMTSTATUS_VM_STEP
+        /// timed steps by latency: bucket 0 is < 1 us, bucket i is [2^(i-1), 2^i) us,
+        /// the last bucket takes everything longer
+        std::uint64_t histogram[buckets];
+    };
+
+    /// flagged node of a query plan (see SQLite3::setPlanCheck())
+    struct PlanIssue
+    {
+        enum Kind : unsigned
+        {
+            FullScan  = 1, ///< `SCAN t` without an index: every row of the table is read
+            TempBTree = 2, ///< `USE TEMP B-TREE FOR ...`: sorting or grouping without an index
+            AutoIndex = 4, ///< `AUTOMATIC ... INDEX`: an index built for each run
+            IndexScan = 8, ///< `SCAN t USING [COVERING] INDEX i`: every entry of the index is read
+        };
+
+        Kind        kind;
+        std::string sql;    ///< statement text
+        std::string detail; ///< the plan node, as in EXPLAIN QUERY PLAN
+    };
+
+    /// query plan rejected by SQLite3::PlanCheck::Throw
+    class HGL_API QueryPlanError final: public std::runtime_error
+    {
+    private:
+        std::vector<PlanIssue> found;
+
+    public:
+        explicit QueryPlanError(std::vector<PlanIssue> issues);
+
+        const std::vector<PlanIssue> & issues() const noexcept { return found; }
+    };
+
     /// SQLite3 statement
     class HGL_API SQLite3Stmt
     {
     protected:
-        void          * handle;   ///< type: sqlite3_stmt*
-        const SQLite3 & database; ///< SQLite3 database connection
-        bool            occupied; ///< whether occupied by other object (in use)
+        struct Internals;
 
-        template <typename T> void _bind_val(int col, T val);
+        void          * handle;    ///< type: sqlite3_stmt*
+        const SQLite3 & database;  ///< SQLite3 database connection
+        bool            occupied;  ///< whether occupied by other object (in use)
+        bool            done;      ///< the last step returned SQLITE_DONE and there was no reset since
+        Internals     * internals; ///< lazily allocated private state (see src/internal.h)
+
+        template <typename T> SQLite3Status _try_bind_val(int col, T && val);
+        template <typename T> void _bind_val(int col, T && val)
+            { _try_bind_val(col, std::forward<T>(val)).check(); }
+        template <typename T> static std::size_t _val_size(const T & val) noexcept;
+        std::string * _owned_slot(int col);
+        NameIndex & _names();
         bool _step();
+        bool _has_row() const noexcept;
+        /// step a statement that has not run yet; false if there is no (more) row
+        bool _start();
+
+        bool _bulk_begin();
+        void _bulk_commit();
+        void _bulk_rollback() noexcept;
+
+        /**
+         * @brief compile the first statement of a multi-statement string
+         * 
+         * @param tail receives a pointer to the text after the statement
+         * @param persistent compile with SQLITE_PREPARE_PERSISTENT
+         * @note the handle stays null if only whitespace or comments are left
+         */
+        SQLite3Stmt(const SQLite3 & db, const char * sql, const char ** tail, bool persistent);
 
         friend class Curoser;
+        friend class SQLite3;
+        friend class ColumnarFile;
+        template <typename T> friend struct _row_col;
 
     public:
         struct Cursor;
@@ -70,6 +326,129 @@ namespace hgl
         /// value type
         enum class Type { Unknown = 0, Null, Integer, Float, Text, Blob };
 
+        /// how long a bound text or blob must stay valid
+        enum class Lifetime
+        {
+            Static,    ///< caller keeps it unchanged until rebound or the statement is destroyed
+            Transient, ///< SQLite makes its own copy while binding
+        };
+
+        /// destructor SQLite calls on bound data it took ownership of
+        using Destructor = void (*)(void *);
+
+        /// a column value decoded as a requested type (see rows())
+        struct Value
+        {
+            Type          type; ///< requested type, or Type::Null
+            std::int64_t  i;    ///< Type::Integer value
+            double        f;    ///< Type::Float value
+            const void  * p;    ///< Type::Text / Type::Blob data
+            std::size_t   n;    ///< Type::Text / Type::Blob length in bytes
+        };
+
+        /**
+         * @brief parameter or column name, see bind(Name, T &&) and RowReader::operator[]()
+         * 
+         * The name is hashed when the Name is made; for a string literal that
+         * happens at compile time. Other strings must be passed as
+         * std::string_view or std::string.
+         */
+        struct Name
+        {
+            std::string_view text;
+            std::uint64_t    hash;
+
+            template <std::size_t N> consteval Name(const char (&s)[N]) noexcept:
+                text(s, N - 1), hash(_hash(text)) { }
+            constexpr Name(std::string_view s) noexcept: text(s), hash(_hash(s)) { }
+            Name(const std::string & s) noexcept: Name(std::string_view(s)) { }
+
+            /// FNV-1a
+            static constexpr std::uint64_t _hash(std::string_view s) noexcept
+            {
+                std::uint64_t h = 0xcbf29ce484222325;
+                for (const char c: s)
+                    h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+                return h;
+            }
+        };
+
+        template <typename ... Ts> class RowRange;
+
+        /// struct-of-arrays result buffer filled by fetchBatch()
+        struct HGL_API ColumnBatch
+        {
+            /// one result column
+            struct Column
+            {
+                /// storage type: Integer, Float, Text or Blob (Unknown: decided by the first row)
+                Type                       type = Type::Unknown;
+                bool                       inferred = false; ///< `type` was picked by fetchBatch(), not the caller
+                std::vector<std::int64_t>  ints;    ///< Type::Integer values (0 for NULL)
+                std::vector<double>        floats;  ///< Type::Float values (0.0 for NULL)
+                std::vector<char>          arena;   ///< Type::Text / Type::Blob bytes, back to back
+                std::vector<std::size_t>   offsets; ///< value i is arena[offsets[i], offsets[i+1])
+                std::vector<std::uint64_t> nulls;   ///< bit i set if value i is NULL
+
+                bool isNull(std::size_t row) const noexcept
+                    { return (nulls[row / 64] >> (row % 64)) & 1; }
+
+                std::string_view text(std::size_t row) const noexcept
+                    { return std::string_view(arena.data() + offsets[row], offsets[row + 1] - offsets[row]); }
+
+                std::span<const std::byte> blob(std::size_t row) const noexcept
+                    { return std::as_bytes(std::span<const char>(arena.data() + offsets[row], offsets[row + 1] - offsets[row])); }
+            };
+
+            std::vector<Column> columns;  ///< one entry per result column
+            std::size_t         rows = 0; ///< number of rows held
+
+            /**
+             * @brief drop all rows, keeping column types and buffer capacity
+             */
+            void clear() noexcept;
+        };
+
+    protected:
+        void _fetch_row(const Type * types, Value * out, int n) noexcept;
+
+        // column accessors of the current row, for the inline decoding in _row_col::read()
+        bool _col_null(int col) const noexcept;
+        std::int64_t _col_int(int col) const noexcept;
+        double _col_float(int col) const noexcept;
+        const char * _col_text(int col, std::size_t & n) const noexcept; ///< `n`: length in bytes
+        const void * _col_blob(int col, std::size_t & n) const noexcept; ///< `n`: length in bytes
+
+        /**
+         * @brief fetchBatch(), optionally without lossy conversions
+         * 
+         * @param exact widen Integer columns to Float when a REAL shows up,
+         *        retype columns that only hold NULLs so far, and throw a
+         *        SQLite3Error (SQLITE_MISMATCH) on other storage class changes
+         */
+        std::size_t _fetch_batch(ColumnBatch & batch, std::size_t n, bool exact);
+
+    public:
+
+        /// executeMany() options
+        struct BulkOptions
+        {
+            std::size_t chunk_rows  = 10000; ///< commit after this many rows (0: no limit)
+            std::size_t chunk_bytes = 0;     ///< commit after this many bound bytes (0: no limit)
+        };
+
+        /// executeMany() report
+        struct BulkStats
+        {
+            std::size_t rows;    ///< rows executed
+            std::size_t bytes;   ///< bytes of bound values
+            std::size_t commits; ///< transactions committed
+            double      seconds; ///< elapsed wall time
+
+            double rowsPerSecond() const noexcept
+                { return seconds > 0 ? static_cast<double>(rows) / seconds : 0.0; }
+        };
+
         /// row data reader
         struct HGL_API RowReader
         {
@@ -82,7 +461,7 @@ namespace hgl
             /**
              * @brief check if usable
              */
-            operator bool () const noexcept { return cur != nullptr; }
+            explicit operator bool () const noexcept { return cur != nullptr; }
 
             /**
              * @brief get row size (column number)
@@ -113,6 +492,34 @@ namespace hgl
             const char * readText(int col);
             const void * readBlob(int col);
             std::size_t readLength(int col);
+
+            /// a column of the current row, see operator[]()
+            struct Field
+            {
+                RowReader * row;
+                int         col; ///< 0 based column
+
+                Type type() const noexcept { return row->type(col); }
+                template <typename T> const T read() { return row->template read<T>(col); }
+            };
+
+            /**
+             * @brief get a column by name
+             * 
+             * The name-to-column table is built once per prepared statement
+             * (and again after a schema change), so the lookup costs a hash
+             * probe. Names are the ones reported by the statement, i.e. the
+             * `AS` alias if there is one, compared case-sensitively.
+             * 
+             * @throw std::out_of_range no such column
+             */
+            Field operator[](Name name);
+            Field operator[](int col) noexcept { return Field{this, col}; }
+
+            /**
+             * @brief read value by column name
+             */
+            template <typename T> const T read(Name name) { return (*this)[name].template read<T>(); }
         };
 
         /// execution-result iterator
@@ -178,124 +585,1481 @@ namespace hgl
          * 
          * @note use begin() and end() or for-range statement to read the results
          */
-        template <typename ... Ts> bool operator()(Ts ... vals)
-            { int i = 0; (_bind_val(++i, vals), ...); return _step(); }
+        template <typename ... Ts> bool operator()(Ts && ... vals)
+            { int i = 0; (_bind_val(++i, std::forward<Ts>(vals)), ...); return _step(); }
+
+        /**
+         * @brief execute the statement without throwing
+         * 
+         * Binding stops at the first failing value.
+         * 
+         * @return has results, or the status of the failing call
+         */
+        template <typename ... Ts> SQLite3Result<bool> tryExec(Ts && ... vals)
+        {
+            int i = 0;
+            SQLite3Status st;
+            (void)((st = _try_bind_val(++i, std::forward<Ts>(vals))).ok() && ...);
+            if (!st)
+                return st;
+            return tryStep();
+        }
+
+        /**
+         * @brief step the statement once without throwing
+         * 
+         * @return true if a row is available, false when done, or the error status
+         */
+        SQLite3Result<bool> tryStep();
+
+        /**
+         * @brief execute the statement once per row of a range
+         * 
+         * Each element is a tuple-like value (std::tuple, std::pair,
+         * std::array) whose members are bound in order. Outside a transaction,
+         * rows are wrapped in transactions committed every
+         * `opts.chunk_rows` rows or `opts.chunk_bytes` bytes; inside one, the
+         * caller's transaction is left alone. On error the uncommitted chunk
+         * is rolled back and the exception is rethrown.
+         * 
+         * @param rows range of rows to bind
+         * @param opts chunking options
+         * @return rows, bytes, commits and elapsed time
+         */
+        template <typename Range>
+        BulkStats executeMany(Range && rows, const BulkOptions & opts = {});
+
+        /**
+         * @brief execute the statement once per row of a range
+         * 
+         * @param rows range of rows
+         * @param proj callable mapping an element to a tuple-like value to bind,
+         *        e.g. `[](const User & u) { return std::tie(u.id, u.name); }`;
+         *        it may also return by value, the result is kept until the row has run
+         * @param opts chunking options
+         */
+        template <typename Range, typename Proj>
+        BulkStats executeMany(Range && rows, Proj proj, const BulkOptions & opts = {});
 
         Cursor begin() noexcept { return Cursor(this); }
         Cursor end() noexcept { return Cursor(); }
 
         /**
-         * @brief reset statement
+         * @brief iterate the results as typed tuples
+         * 
+         * Column i is decoded as Ts[i]: signed or unsigned integers, floats,
+         * std::string_view, std::string, const char*, std::span<const std::byte>,
+         * or std::optional of these (std::nullopt for NULL). The whole row is
+         * fetched with one library call. Starts at the current row if the
+         * statement has already been stepped by operator(), otherwise runs it;
+         * the statement is reset once the results are exhausted.
+         * 
+         * @code
+         * for (auto [id, score, name]: stmt.rows<std::int64_t, double, std::string_view>())
+         * @endcode
+         * 
+         * @note views and pointers are only valid until the next row is fetched
          */
-        void reset() noexcept;
+        template <typename ... Ts> RowRange<Ts...> rows() noexcept
+            { return RowRange<Ts...>(this); }
 
-        void bindInteger(int col, std::int64_t v);
-        void bindFloat(int col, double v);
-        void bindText(int col, const char * v);
-    };
+        /**
+         * @brief read up to `n` result rows into column buffers
+         * 
+         * Reading starts at the current row, so run the statement with
+         * operator() first; call repeatedly until it returns 0. Previous
+         * contents of `batch` are cleared, but its capacity is kept, so a
+         * reused batch does not allocate per row.
+         * 
+         * Columns of type Type::Unknown take the storage class of their first
+         * value (or the declared type if it is NULL) and keep values exact:
+         * an Integer column is widened to Float when a REAL shows up, a column
+         * holding only NULLs so far is retyped, and any other change of
+         * storage class throws. Such a type is kept for later calls, where the
+         * same rules apply. Column types the caller set before the call are
+         * kept, and values are converted to them.
+         * 
+         * @throw SQLite3Error (SQLITE_MISMATCH) a column of inferred type
+         *        holds both numbers and text or blobs; `batch` is left empty
+         * 
+         * @param batch buffer to fill
+         * @param n max number of rows
+         * @return number of rows read; 0 once the results are exhausted
+         */
+        std::size_t fetchBatch(ColumnBatch & batch, std::size_t n);
 
-    /// SQLite3 database connection
-    class HGL_API SQLite3
-    {
-    protected:
-        mutable void * handle; ///< type: sqlite3*
-        mutable char * buffer; ///< string buffer
+        /**
+         * @brief read up to `n` result rows into a buffer owned by the statement
+         * 
+         * @param n max number of rows
+         * @return the buffer, valid until the next call or statement destruction
+         */
+        const ColumnBatch & fetchBatch(std::size_t n);
 
-        friend class SQLite3Error;
-        friend class SQLite3Stmt;
+        /**
+         * @brief get the index of a named parameter
+         * 
+         * The table is built once per prepared statement and kept with it in
+         * the statement cache.
+         * 
+         * @param name parameter name including its prefix, e.g. ":id"
+         * @return 1 based index, or 0 if there is no such parameter
+         */
+        int paramIndex(Name name);
 
-    public:
-        using exec_callback_type =
-            int(*)(void* param, int col_num, char** col_val, char** col_name);
+        /**
+         * @brief get the column of a named result column
+         * 
+         * @return 0 based column, or -1 if there is no such column
+         */
+        int columnIndex(Name name);
 
         /**
-         * @brief create a temporary in-memory database
+         * @brief bind a value to a named parameter
+         * 
+         * @code
+         * stmt.bind(":id", 42);
+         * stmt.bind(":name", std::string_view("alice"));
+         * stmt();
+         * @endcode
+         * 
+         * @param name parameter name including its prefix
+         * @param val value, of any type operator() accepts
+         * @throw SQLite3Error SQLITE_RANGE if there is no such parameter
          */
-        SQLite3(): SQLite3(":memory:") { }
+        template <typename T> void bind(Name name, T && val)
+            { _bind_val(paramIndex(name), std::forward<T>(val)); }
 
         /**
-         * @brief opening a new database connection
+         * @brief bind a value to a named parameter without throwing
+         */
+        template <typename T> SQLite3Status tryBind(Name name, T && val)
+            { return _try_bind_val(paramIndex(name), std::forward<T>(val)); }
+
+        /**
+         * @brief get the profile collected for this statement's SQL text
          * 
-         * @param filename name of the database file
+         * @return the profile; all counters are 0 unless profiling is enabled
          */
-        explicit SQLite3(const char * filename);
+        StmtProfile getProfile() const;
 
-        SQLite3(SQLite3 &&) = delete;
-        SQLite3(const SQLite3 &) = delete;
+        /**
+         * @brief reset statement
+         */
+        void reset() noexcept;
 
-        ~SQLite3();
+        void bindInteger(int col, std::int64_t v);
+        void bindFloat(int col, double v);
+        void bindNull(int col);
 
         /**
-         * @brief check if the database is opened
+         * @brief bind a null-terminated string, which must stay valid (static)
          */
-        operator bool () const noexcept { return handle != nullptr; }
+        void bindText(int col, const char * v);
 
         /**
-         * @brief opening a new database connection
+         * @brief bind text of known length
          * 
-         * @param filename name of the database file
+         * @param col 1 based parameter index
+         * @param v the text, need not be null-terminated
+         * @param life lifetime policy of the referenced characters
          */
-        void open(const char * filename);
+        void bindText(int col, std::string_view v, Lifetime life = Lifetime::Static);
 
         /**
-         * @brief close the database connection
-         * @note this function will be called automatically in distructor
+         * @brief bind text, moving the string into the statement
+         * @note the string is kept until the parameter is rebound or the statement is destroyed
          */
-        void close() noexcept;
+        void bindText(int col, std::string && v);
 
         /**
-         * @brief evaluate simple SQL statments
+         * @brief bind text, handing ownership to SQLite
          * 
-         * @param stmts SQL statments to evaluate
+         * @param col 1 based parameter index
+         * @param v the text
+         * @param n length in bytes
+         * @param destructor called by SQLite with `v` once it is no longer used
          */
-        void operator()(const char * stmts);
+        void bindText(int col, const char * v, std::size_t n, Destructor destructor);
 
         /**
-         * @brief evaluate simple SQL statments
+         * @brief bind a blob
          * 
-         * @param stmts SQL statments to evaluate
-         * @param cb callback
-         * @param cb_param 1st arguemtn for callback function
+         * @param col 1 based parameter index
+         * @param v the bytes
+         * @param life lifetime policy of the referenced bytes
          */
-        void operator()(const char * stmts, exec_callback_type cb, void * cb_param);
+        void bindBlob(int col, std::span<const std::byte> v, Lifetime life = Lifetime::Static);
 
         /**
-         * @brief get last error message
+         * @brief bind a blob, moving the string into the statement
+         * @note the string is kept until the parameter is rebound or the statement is destroyed
+         */
+        void bindBlob(int col, std::string && v);
+
+        /**
+         * @brief bind a blob, handing ownership to SQLite
          * 
-         * @return message string
+         * @param col 1 based parameter index
+         * @param v the bytes
+         * @param n length in bytes
+         * @param destructor called by SQLite with `v` once it is no longer used
          */
-        const char * getErrMsg() noexcept;
+        void bindBlob(int col, const void * v, std::size_t n, Destructor destructor);
 
-        SQLite3Stmt makeInsert(const char * table, const char * names, const char * values);
-        SQLite3Stmt makeInsert(const char * table, const char * values);
-        SQLite3Stmt makeSelect(const char * table, const char * names = nullptr, const char * where = nullptr);
-        SQLite3Stmt makeUpdate(const char * table,
-            std::initializer_list<std::pair<const char*, const char*>> name_vals, const char * where);
-        SQLite3Stmt makeDelete(const char * table, const char * where);
+        /**
+         * @brief bind a blob of `n` zero bytes (to be filled by incremental I/O)
+         */
+        void bindZeroBlob(int col, std::size_t n);
+
+        /// @name non-throwing binders, see the bind* functions above
+        /// @{
+        SQLite3Status tryBindInteger(int col, std::int64_t v) noexcept;
+        SQLite3Status tryBindFloat(int col, double v) noexcept;
+        SQLite3Status tryBindNull(int col) noexcept;
+        SQLite3Status tryBindText(int col, const char * v) noexcept;
+        SQLite3Status tryBindText(int col, std::string_view v, Lifetime life = Lifetime::Static) noexcept;
+        SQLite3Status tryBindText(int col, std::string && v);
+        SQLite3Status tryBindText(int col, const char * v, std::size_t n, Destructor destructor) noexcept;
+        SQLite3Status tryBindBlob(int col, std::span<const std::byte> v, Lifetime life = Lifetime::Static) noexcept;
+        SQLite3Status tryBindBlob(int col, std::string && v);
+        SQLite3Status tryBindBlob(int col, const void * v, std::size_t n, Destructor destructor) noexcept;
+        SQLite3Status tryBindZeroBlob(int col, std::size_t n) noexcept;
+        /// @}
     };
 
-} // namespace hgl
+    /// user-defined SQL function object, owned by the connection (see SQLite3::defineFunction())
+    struct _SqlFunction
+    {
+        virtual ~_SqlFunction() = default;
 
+        // arguments: sqlite3_context*, the aggregate state slot (not for call()),
+        // argument count and sqlite3_value** argument vector
+        virtual void call(void *, int, void **) noexcept { }
+        virtual void step(void *, void **, int, void **) noexcept { }
+        virtual void inverse(void *, void **, int, void **) noexcept { }
+        virtual void value(void *, void **) noexcept { }
+        virtual void final(void *, void **) noexcept { }
+    };
 
-#include <type_traits>
+    /// container exposed as a virtual table (see SQLite3::defineTable())
+    struct _VTableSource
+    {
+        virtual ~_VTableSource() = default;
 
-template <typename T> inline void hgl::SQLite3Stmt::_bind_val(int col, T val)
-{
-    if constexpr (std::is_integral<T>::value)
-        bindInteger(col, val);
-    else if constexpr (std::is_floating_point<T>::value)
-        bindFloat(col, val);
-    else if constexpr (std::is_same<const char*, T>::value)
-        bindText(val);
-    else
-        static_assert(std::is_floating_point<T>::value, "invalid type T");
-}
+        virtual const char * declaration() const noexcept = 0; ///< CREATE TABLE statement
+        virtual std::size_t size() const noexcept = 0;
+        virtual int keyColumn() const noexcept = 0;            ///< -1 if there is no key
+        virtual std::size_t rowAt(std::size_t pos) const noexcept = 0; ///< container index of the pos-th row in key order
+        virtual void column(std::size_t row, int col, SQLite3Stmt::Value & out) const noexcept = 0;
+        virtual bool comparable(const SQLite3Stmt::Value & v) const noexcept = 0;
+        virtual int compare(std::size_t row, const SQLite3Stmt::Value & v) const noexcept = 0; ///< key <=> v
+    };
 
-template <typename T> inline const T hgl::SQLite3Stmt::RowReader::read(int col)
-{
-    using U = typename std::remove_cv<T>::type;
+    /// argument and result marshalling for _SqlFunction (see src/function.cc)
+    struct HGL_API _SqlFn
+    {
+        using Type  = SQLite3Stmt::Type;
+        using Value = SQLite3Stmt::Value;
 
-    if constexpr (std::is_same<std::size_t, U>::value)
+        static void args(void ** argv, const Type * types, Value * out, int n) noexcept;
+        static void arg(void ** argv, int i, Value & out) noexcept; ///< decode in its own type
+        static void result(void * ctx, const Value & v, bool copy = true) noexcept;
+        static void error(void * ctx, const char * msg, int code) noexcept;
+        static void noMemory(void * ctx) noexcept;
+    };
+
+    /// SQLite3 database connection
+    class HGL_API SQLite3
+    {
+    protected:
+        struct Internals;
+
+        mutable void      * handle;      ///< type: sqlite3*
+        mutable char      * buffer;      ///< string buffer for the make* builders
+        mutable std::size_t buffer_size; ///< capacity of buffer, grown on demand
+        mutable Internals * internals;   ///< connection-private state (see src/internal.h)
+
+        enum class _FnKind { Scalar, Aggregate, Window };
+
+        void _define(const char * name, int nargs, int flags, _FnKind kind, _SqlFunction * fn);
+        void _define_table(const char * name, _VTableSource * src, bool eponymous);
+        void _exec_script(const char * script, bool cache, int columns,
+            void (*visit)(void * ctx, SQLite3Stmt & stmt), void * ctx);
+        void _cached_query(const char * sql, std::string & key, const SQLite3Stmt::Type * types, int columns,
+            void (*bind)(void * ctx, SQLite3Stmt & stmt), void * bind_ctx,
+            void (*sink)(void * ctx, const SQLite3Stmt::Value * vals), void * sink_ctx);
+        static void _query_key(std::string & key, const char * sql, const SQLite3Stmt::Type * types, int columns);
+        template <typename T> static void _query_key_arg(std::string & key, const T & val);
+
+        friend class SQLite3Error;
+        friend class SQLite3Status;
+        friend class SQLite3Stmt;
+
+    public:
+        using exec_callback_type =
+            int(*)(void* param, int col_num, char** col_val, char** col_name);
+
+        /// prepared statement cache statistics
+        struct StmtCacheStats
+        {
+            std::uint64_t hits;      ///< statements reused from the cache
+            std::uint64_t misses;    ///< statements that had to be compiled
+            std::uint64_t evictions; ///< idle statements finalized to respect the capacity
+            std::size_t   size;      ///< statements currently held by the cache
+            std::size_t   capacity;  ///< maximum number of statements held
+        };
+
+        /// query result cache statistics
+        struct QueryCacheStats
+        {
+            std::uint64_t hits;      ///< queries answered from the cache
+            std::uint64_t misses;    ///< queries run (and stored if possible)
+            std::uint64_t stores;    ///< results stored
+            std::uint64_t stale;     ///< entries dropped because a table they read changed
+            std::uint64_t evictions; ///< entries dropped to respect the budget
+            std::size_t   entries;   ///< results currently held
+            std::size_t   bytes;     ///< memory used by the held results
+            std::size_t   budget;    ///< maximum memory, 0 if disabled
+        };
+
+        /// default capacity of the prepared statement cache
+        static constexpr std::size_t default_stmt_cache_capacity = 32;
+
+        /// how SQLITE_BUSY is handled when preparing and stepping statements,
+        /// and by the BEGIN, COMMIT, SAVEPOINT and RELEASE of Transaction, Savepoint and executeMany()
+        struct BusyPolicy
+        {
+            enum class Mode
+            {
+                Throw,   ///< throw SQLite3Error at once
+                Timeout, ///< let SQLite retry every `min_delay` until `deadline` (sqlite3_busy_handler)
+                Backoff, ///< retry with jittered exponential backoff until `deadline`
+            };
+
+            Mode                      mode;
+            std::chrono::milliseconds min_delay; ///< Backoff: first delay; Timeout: delay between retries (at least 1 ms)
+            std::chrono::milliseconds max_delay; ///< Backoff: longest delay
+            std::chrono::milliseconds deadline;  ///< Timeout, Backoff: give up after waiting this long
+
+            static BusyPolicy throwImmediately() noexcept
+                { return BusyPolicy{Mode::Throw, {}, {}, {}}; }
+
+            static BusyPolicy timeout(std::chrono::milliseconds deadline) noexcept
+                { return BusyPolicy{Mode::Timeout, {}, {}, deadline}; }
+
+            static BusyPolicy backoff(std::chrono::milliseconds min_delay,
+                    std::chrono::milliseconds max_delay, std::chrono::milliseconds deadline) noexcept
+                { return BusyPolicy{Mode::Backoff, min_delay, max_delay, deadline}; }
+        };
+
+        /**
+         * @brief statistics of SQLITE_BUSY episodes met when preparing and stepping statements
+         */
+        struct BusyStats
+        {
+            static constexpr std::size_t buckets = 16;
+
+            std::uint64_t events;   ///< episodes (one per prepare or step that met SQLITE_BUSY)
+            std::uint64_t retries;  ///< Timeout, Backoff: sleeps taken
+            std::uint64_t failures; ///< episodes that ended in SQLite3Error
+            std::uint64_t wait_us;  ///< total time spent waiting, in microseconds
+            /// episodes by wait time: bucket 0 is < 1 ms, bucket i is [2^(i-1), 2^i) ms,
+            /// the last bucket takes everything longer
+            std::uint64_t histogram[buckets];
+        };
+
+        /**
+         * @brief how a connection is opened and tuned
+         *
+         * Everything is applied by open() before the connection is handed
+         * out; if any setting fails the connection is closed again and
+         * SQLite3Error is thrown. Unset fields keep SQLite's defaults.
+         */
+        struct OpenOptions
+        {
+            /// open flags, same values as the SQLITE_OPEN_* constants
+            enum Flag : int
+            {
+                ReadOnly     = 0x00000001,
+                ReadWrite    = 0x00000002,
+                Create       = 0x00000004,
+                Uri          = 0x00000040,
+                Memory       = 0x00000080,
+                NoMutex      = 0x00008000, ///< connection is never used by two threads at once
+                FullMutex    = 0x00010000,
+                SharedCache  = 0x00020000,
+                PrivateCache = 0x00040000,
+                NoFollow     = 0x01000000,
+            };
+
+            enum class Journal { Default, Delete, Truncate, Persist, Memory, Wal, Off };
+            enum class Synchronous { Default, Off, Normal, Full, Extra };
+            enum class TempStore { Default, File, Memory };
+
+            int                         flags = ReadWrite | Create;
+            std::optional<std::int64_t> mmap_size;   ///< PRAGMA mmap_size, bytes
+            std::optional<std::int64_t> cache_size;  ///< PRAGMA cache_size: pages, or KiB if negative
+            std::optional<std::int64_t> page_size;   ///< PRAGMA page_size (new databases only)
+            Journal                     journal_mode = Journal::Default;
+            Synchronous                 synchronous  = Synchronous::Default;
+            TempStore                   temp_store   = TempStore::Default;
+            int                         lookaside_slot_size = 0; ///< bytes per slot, 0 = default
+            int                         lookaside_slots     = 0; ///< number of slots, 0 = default
+
+            /// WAL, memory-mapped reads and a larger page cache for read-heavy workloads
+            static OpenOptions readMostlyMmap(std::int64_t mmap_size = 256 << 20) noexcept
+            {
+                OpenOptions o;
+                o.mmap_size = mmap_size;
+                o.cache_size = -16384;
+                o.journal_mode = Journal::Wal;
+                o.synchronous = Synchronous::Normal;
+                o.temp_store = TempStore::Memory;
+                return o;
+            }
+
+            /// read-only connection used by one thread at a time
+            static OpenOptions readOnly(std::int64_t mmap_size = 256 << 20) noexcept
+            {
+                OpenOptions o;
+                o.flags = ReadOnly | NoMutex;
+                o.mmap_size = mmap_size;
+                return o;
+            }
+
+            /// no journal and no fsync: fast, but a crash can corrupt the database
+            static OpenOptions bulkLoadUnsafe() noexcept
+            {
+                OpenOptions o;
+                o.cache_size = -65536;
+                o.journal_mode = Journal::Off;
+                o.synchronous = Synchronous::Off;
+                o.temp_store = TempStore::Memory;
+                o.lookaside_slot_size = 1200;
+                o.lookaside_slots = 1000;
+                return o;
+            }
+
+            /// WAL with a full fsync on every commit
+            static OpenOptions durable() noexcept
+            {
+                OpenOptions o;
+                o.journal_mode = Journal::Wal;
+                o.synchronous = Synchronous::Full;
+                return o;
+            }
+        };
+
+        /// options of SQLite3::backup()
+        struct BackupOptions
+        {
+            int                       pages_per_step = 256;   ///< pages copied per step, -1 for all at once
+            std::chrono::milliseconds pause{0};               ///< sleep between steps (0 just yields)
+            std::chrono::milliseconds busy_timeout{5000};     ///< give up if locked out this long
+            const char *              to_schema   = "main";
+            const char *              from_schema = "main";
+            /// called after each step with (remaining, total) pages; return false to stop early
+            std::function<bool(int, int)> progress;
+        };
+
+        /// result of SQLite3::backup()
+        struct BackupStats
+        {
+            bool          complete; ///< false if stopped by the progress callback
+            std::uint64_t steps;
+            std::uint64_t pages;    ///< total pages in the source
+            double        seconds;
+        };
+
+        /// transaction locking mode
+        enum class TransactionMode
+        {
+            Deferred,  ///< BEGIN DEFERRED: take locks on first access
+            Immediate, ///< BEGIN IMMEDIATE: take the write lock up front
+            Exclusive, ///< BEGIN EXCLUSIVE: also keep readers out (non-WAL)
+        };
+
+        /// scoped transaction, rolled back unless committed
+        class HGL_API Transaction
+        {
+        protected:
+            SQLite3 & db;
+            bool      active;
+
+        public:
+            /**
+             * @brief begin a transaction
+             * 
+             * @param db database connection
+             * @param mode locking mode
+             */
+            explicit Transaction(SQLite3 & db, TransactionMode mode = TransactionMode::Deferred);
+
+            Transaction(Transaction &&) = delete;
+            Transaction(const Transaction &) = delete;
+
+            /**
+             * @brief roll back if neither committed nor rolled back
+             */
+            ~Transaction();
+
+            /**
+             * @brief check if the transaction is still open
+             */
+            operator bool () const noexcept { return active; }
+
+            /**
+             * @brief commit the transaction
+             * @note if COMMIT fails (e.g. SQLITE_BUSY) the transaction stays open
+             */
+            void commit();
+
+            /**
+             * @brief roll back the transaction
+             */
+            void rollback() noexcept;
+        };
+
+        /// scoped savepoint (nestable), rolled back unless released
+        class HGL_API Savepoint
+        {
+        protected:
+            SQLite3 &    db;
+            unsigned int level; ///< nesting level, 0 if no longer active
+
+            void _exec(const char * verb);
+
+        public:
+            /**
+             * @brief set a savepoint
+             * 
+             * @param db database connection
+             */
+            explicit Savepoint(SQLite3 & db);
+
+            Savepoint(Savepoint &&) = delete;
+            Savepoint(const Savepoint &) = delete;
+
+            /**
+             * @brief roll back to the savepoint if not released
+             */
+            ~Savepoint();
+
+            /**
+             * @brief check if the savepoint is still active
+             */
+            operator bool () const noexcept { return level != 0; }
+
+            /**
+             * @brief release the savepoint, keeping its changes
+             */
+            void commit();
+
+            /**
+             * @brief undo changes made since the savepoint and release it
+             */
+            void rollback() noexcept;
+        };
+
+        /**
+         * @brief incremental I/O on one blob or text value (sqlite3_blob_open)
+         *
+         * The value is accessed in place, so arbitrarily large objects can be
+         * streamed through a small buffer. Its size is fixed when the row is
+         * written (e.g. with `zeroblob(n)` or SQLite3Stmt::bindZeroBlob()).
+         */
+        class HGL_API BlobStream
+        {
+        protected:
+            const SQLite3 * db;
+            void          * handle;   ///< type: sqlite3_blob*
+            std::size_t     length;
+            std::size_t     position;
+
+        public:
+            /// std::streambuf adapter, for use with std::istream / std::ostream
+            class StreamBuf;
+
+            /**
+             * @brief open a value for incremental I/O
+             *
+             * @param db database connection
+             * @param table table name
+             * @param column column name
+             * @param rowid row to open
+             * @param writable open for writing as well as reading
+             * @param schema database name ("main", "temp" or an attached one)
+             */
+            BlobStream(const SQLite3 & db, const char * table, const char * column,
+                std::int64_t rowid, bool writable = false, const char * schema = "main");
+
+            BlobStream(BlobStream && other) noexcept;
+            BlobStream(const BlobStream &) = delete;
+
+            ~BlobStream();
+
+            BlobStream & operator=(BlobStream && other) noexcept;
+
+            /**
+             * @brief check if the stream is open
+             */
+            operator bool () const noexcept { return handle != nullptr; }
+
+            /**
+             * @brief get size of the value in bytes
+             */
+            std::size_t size() const noexcept { return length; }
+
+            /**
+             * @brief get current read/write offset
+             */
+            std::size_t tell() const noexcept { return position; }
+
+            /**
+             * @brief move the read/write offset
+             * @note throws std::out_of_range if `pos` is past the end
+             */
+            void seek(std::size_t pos);
+
+            /**
+             * @brief read from the current offset
+             *
+             * @param buf destination; at most `buf.size()` bytes are read
+             * @return number of bytes read, 0 at the end of the value
+             */
+            std::size_t read(std::span<std::byte> buf);
+
+            /**
+             * @brief write at the current offset
+             * @note the size of the value cannot change; writing past its end
+             * throws SQLite3Error without writing anything
+             */
+            void write(std::span<const std::byte> data);
+
+            /**
+             * @brief point the stream at another row of the same table and column
+             *
+             * Much cheaper than opening a new stream. The offset goes back to 0.
+             */
+            void reopen(std::int64_t rowid);
+
+            /**
+             * @brief close the stream
+             * @note this function will be called automatically in destructor
+             */
+            void close() noexcept;
+        };
+
+        /**
+         * @brief create a temporary in-memory database
+         */
+        SQLite3(): SQLite3(":memory:") { }
+
+        /**
+         * @brief opening a new database connection
+         * 
+         * @param filename name of the database file
+         */
+        explicit SQLite3(const char * filename);
+
+        /**
+         * @brief opening a new database connection with options
+         * 
+         * @param filename name of the database file
+         * @param opts open flags and tuning
+         */
+        SQLite3(const char * filename, const OpenOptions & opts);
+
+        SQLite3(SQLite3 &&) = delete;
+        SQLite3(const SQLite3 &) = delete;
+
+        ~SQLite3();
+
+        /**
+         * @brief check if the database is opened
+         */
+        operator bool () const noexcept { return handle != nullptr; }
+
+        /**
+         * @brief opening a new database connection
+         * 
+         * @param filename name of the database file
+         */
+        void open(const char * filename);
+
+        /**
+         * @brief opening a new database connection with options
+         * 
+         * @param filename name of the database file
+         * @param opts open flags and tuning, applied before this returns
+         * @throw SQLite3Error if an option cannot be applied, e.g. a journal
+         *        mode that does not take effect; the connection is then closed
+         */
+        void open(const char * filename, const OpenOptions & opts);
+
+        /**
+         * @brief close the database connection
+         * @note this function will be called automatically in distructor
+         */
+        void close() noexcept;
+
+        /**
+         * @brief evaluate simple SQL statments
+         * 
+         * @param stmts SQL statments to evaluate
+         */
+        void operator()(const char * stmts);
+
+        /**
+         * @brief evaluate simple SQL statments
+         * 
+         * @param stmts SQL statments to evaluate
+         * @param cb callback
+         * @param cb_param 1st arguemtn for callback function
+         */
+        void operator()(const char * stmts, exec_callback_type cb, void * cb_param);
+
+        /**
+         * @brief evaluate simple SQL statments without throwing
+         * 
+         * @param stmts SQL statments to evaluate
+         * @return status of the first failing statement
+         */
+        SQLite3Status tryExec(const char * stmts) noexcept;
+
+        /**
+         * @brief evaluate SQL statements, passing result rows to a typed callable
+         * 
+         * Statements are compiled one at a time, each right after the
+         * previous one has run, so later statements may use tables created by
+         * earlier ones. `f` is either called as `f(SQLite3Stmt::RowReader &)`
+         * for every result row, or its parameter types are the column types
+         * (as in SQLite3Stmt::rows()) and it is called for the rows of every
+         * statement with a matching number of columns. Other statements are
+         * just run to completion.
+         * 
+         * With `cache` set, the statements are kept in the statement cache
+         * and the split of `script` is remembered, so running the same script
+         * again skips parsing.
+         * 
+         * @code
+         * db.execScript("CREATE TABLE t(a, b); INSERT INTO t VALUES (1, 'x'); SELECT a, b FROM t;",
+         *     [](std::int64_t a, std::string_view b) { ... });
+         * @endcode
+         * 
+         * @param script SQL statements
+         * @param f row callback
+         * @param cache cache the compiled statements
+         * @note statements already run are not undone if a later one fails
+         */
+        template <typename F> void execScript(const char * script, F && f, bool cache = false);
+
+        /**
+         * @brief evaluate SQL statements, discarding result rows
+         * 
+         * @param script SQL statements
+         * @param cache cache the compiled statements (see above)
+         */
+        void execScript(const char * script, bool cache = false)
+            { _exec_script(script, cache, 0, nullptr, nullptr); }
+
+        /**
+         * @brief get last error message
+         * 
+         * @return message string
+         */
+        const char * getErrMsg() noexcept;
+
+        /**
+         * @brief check if a transaction is open on this connection
+         */
+        bool inTransaction() const noexcept;
+
+        /**
+         * @brief set prepared statement cache capacity
+         * 
+         * Destroyed SQLite3Stmt objects hand their compiled statement back to
+         * the cache, and constructing a SQLite3Stmt with the same SQL text
+         * (whitespace and trailing semicolons ignored) reuses it after a reset.
+         * 
+         * @param capacity max number of cached statements; 0 disables the cache
+         */
+        void setStmtCacheCapacity(std::size_t capacity) noexcept;
+
+        /**
+         * @brief get prepared statement cache statistics
+         */
+        StmtCacheStats getStmtCacheStats() const noexcept;
+
+        /**
+         * @brief finalize all idle statements in the cache
+         */
+        void clearStmtCache() noexcept;
+
+        /**
+         * @brief set how SQLITE_BUSY is handled
+         * 
+         * The default is BusyPolicy::backoff(1ms, 250ms, 4s).
+         */
+        void setBusyPolicy(const BusyPolicy & policy) noexcept;
+
+        /**
+         * @brief get current busy policy
+         */
+        BusyPolicy getBusyPolicy() const noexcept;
+
+        /**
+         * @brief get busy-event statistics
+         */
+        BusyStats getBusyStats() const noexcept;
+
+        /**
+         * @brief reset busy-event statistics
+         */
+        void resetBusyStats() noexcept;
+
+        /**
+         * @brief enable or disable statement profiling
+         * 
+         * When enabled, runs, result rows and sqlite3_stmt_status counters
+         * of every statement on this connection (including those of
+         * operator()(const char*)) are collected per SQL text through a
+         * sqlite3_trace_v2 callback, and each step of a SQLite3Stmt is timed.
+         * When disabled, no callback is installed and nothing is measured.
+         */
+        void setProfiling(bool enable) noexcept;
+
+        /**
+         * @brief check if statement profiling is enabled
+         */
+        bool isProfiling() const noexcept;
+
+        /**
+         * @brief get a snapshot of the collected profiles
+         * @note may be called from any thread
+         */
+        std::vector<StmtProfile> getProfile() const;
+
+        /**
+         * @brief get a snapshot of the collected profiles as a JSON array
+         * @note may be called from any thread
+         */
+        std::string getProfileJSON() const;
+
+        /**
+         * @brief discard the collected profiles
+         */
+        void resetProfile() noexcept;
+
+        /**
+         * @brief publish committed row changes to a queue
+         * 
+         * Installs the update, commit and rollback hooks of the connection.
+         * Changed rows are recorded as the statements run and queued when
+         * the transaction commits; rolled back transactions and savepoints
+         * leave nothing behind, whether they use SQLite3::Savepoint or
+         * SAVEPOINT / ROLLBACK TO in SQL. Include sqlite3w_changes.h to
+         * consume the events.
+         * 
+         * While watching, operator() and tryExec() run their SQL one
+         * statement at a time instead of through sqlite3_exec().
+         * 
+         * @param capacity max queued events (see ChangeStream)
+         * @return the stream; calling again returns the same stream
+         */
+        std::shared_ptr<ChangeStream> watchChanges(std::size_t capacity = 4096);
+
+        /**
+         * @brief stop publishing changes and close the stream
+         */
+        void unwatchChanges() noexcept;
+
+        /**
+         * @brief enable the query result cache of cachedQuery()
+         * 
+         * Results are stored as encoded rows, one buffer per query, and the
+         * least recently used ones are dropped to stay within `budget`
+         * bytes. Calling again changes the budget.
+         * 
+         * An update hook records every changed row, so a result is dropped
+         * as soon as a table it read changes through this connection; DDL,
+         * backup() into this connection and BlobStream writes clear the
+         * whole cache. Queries reading WITHOUT ROWID tables, which the
+         * update hook does not report, are never stored.
+         * 
+         * @note Writes by other connections or processes are not seen: use
+         *       the cache on databases only this connection writes, or call
+         *       clearQueryCache() when told otherwise. Results of virtual
+         *       tables and of non-deterministic functions (random(),
+         *       date('now')) must not be cached either.
+         */
+        void enableQueryCache(std::size_t budget = 16 << 20);
+
+        /**
+         * @brief drop all cached results and stop caching
+         */
+        void disableQueryCache() noexcept;
+
+        /**
+         * @brief drop all cached results
+         */
+        void clearQueryCache() noexcept;
+
+        /**
+         * @brief get query result cache statistics
+         */
+        QueryCacheStats getQueryCacheStats() const noexcept;
+
+        /**
+         * @brief run a query, or answer it from the result cache
+         * 
+         * The cache key is the SQL text, the column types and the parameter
+         * values. A hit does not touch SQLite at all. Read-write statements,
+         * queries inside a transaction (whose changes could still be rolled
+         * back) and any query while the cache is disabled are just run.
+         * 
+         * @code
+         * auto rows = db.cachedQuery<std::string, std::int64_t>("SELECT name, value FROM config WHERE app = ?", app);
+         * @endcode
+         * 
+         * @tparam Ts column types, as for SQLite3Stmt::rows() but without views
+         * @param sql the query
+         * @param args parameters: integers, floats, text, std::span<const std::byte>, nullptr or std::optional of these
+         * @return all result rows
+         */
+        template <typename ... Ts, typename ... Args>
+        std::vector<std::tuple<Ts...>> cachedQuery(const char * sql, Args && ... args);
+
+        /// what the query plan analyzer does with flagged plans
+        enum class PlanCheck
+        {
+            Off,    ///< plans are not looked at
+            Report, ///< issues are collected, see getPlanIssues()
+            Throw,  ///< the SQLite3Stmt constructor throws QueryPlanError
+        };
+
+        /**
+         * @brief analyze the plan of every newly prepared statement
+         * 
+         * Each time a SQLite3Stmt compiles its SQL (a statement cache miss,
+         * including statements of execScript()), the plan is read with
+         * EXPLAIN QUERY PLAN and the nodes of the given kinds are flagged.
+         * Statements run by operator()(const char*) are not analyzed.
+         * 
+         * @param mode what to do with flagged nodes
+         * @param kinds combination of PlanIssue::Kind to flag
+         */
+        void setPlanCheck(PlanCheck mode, unsigned kinds) noexcept;
+        void setPlanCheck(PlanCheck mode) noexcept
+            { this->setPlanCheck(mode, PlanIssue::FullScan | PlanIssue::TempBTree | PlanIssue::AutoIndex | PlanIssue::IndexScan); }
+
+        /**
+         * @brief get current plan analyzer mode
+         */
+        PlanCheck getPlanCheck() const noexcept;
+
+        /**
+         * @brief get the issues collected by PlanCheck::Report, each reported once
+         */
+        std::vector<PlanIssue> getPlanIssues() const;
+
+        /**
+         * @brief discard the collected plan issues
+         */
+        void clearPlanIssues() noexcept;
+
+        /**
+         * @brief get the query plan of a statement as a tree, like the sqlite3 shell
+         * 
+         * @code
+         * QUERY PLAN
+         * |--SCAN T
+         * `--USE TEMP B-TREE FOR ORDER BY
+         * @endcode
+         * 
+         * @param sql one statement; parameters may be left unbound
+         * @throw SQLite3Error if the statement cannot be prepared
+         */
+        std::string explainPlan(const char * sql) const;
+
+        /// flags of user-defined SQL functions, same values as the SQLITE_* constants
+        enum FunctionFlag : int
+        {
+            Deterministic = 0x000000800, ///< same arguments, same result
+            DirectOnly    = 0x000080000, ///< not usable from triggers, views or schema
+            Innocuous     = 0x000200000, ///< no side effects, safe in any context
+        };
+
+        /**
+         * @brief copy a database into another one, page by page (online backup)
+         * 
+         * Other connections may keep using the source between steps; if the
+         * source is written through another connection the copy restarts.
+         * 
+         * @param to destination connection; its content is replaced
+         * @param from source connection
+         * @param opts step size, pacing and progress callback
+         * @return statistics
+         */
+        static BackupStats backup(SQLite3 & to, const SQLite3 & from, const BackupOptions & opts);
+        static BackupStats backup(SQLite3 & to, const SQLite3 & from) { return backup(to, from, BackupOptions()); }
+
+        /**
+         * @brief replace this database with the content of a database file
+         * 
+         * e.g. warm-start an in-memory replica with `SQLite3 db; db.loadFrom("data.db");`
+         */
+        BackupStats loadFrom(const char * filename, const BackupOptions & opts);
+        BackupStats loadFrom(const char * filename) { return loadFrom(filename, BackupOptions()); }
+
+        /**
+         * @brief write a snapshot of this database to a database file
+         */
+        BackupStats saveTo(const char * filename, const BackupOptions & opts) const;
+        BackupStats saveTo(const char * filename) const { return saveTo(filename, BackupOptions()); }
+
+        /**
+         * @brief define a scalar SQL function
+         * 
+         * Argument and result types are taken from the callable's signature
+         * (arithmetic, std::string_view, std::string, const char *,
+         * std::span<const std::byte>, or std::optional of those for NULL).
+         * Exceptions thrown by `f` become SQL errors.
+         * 
+         * @param name function name
+         * @param f the callable
+         * @param flags combination of FunctionFlag; pass Deterministic for pure
+         *        functions so that SQLite may factor their calls out
+         */
+        template <typename F> void defineFunction(const char * name, F f, int flags = 0);
+
+        /**
+         * @brief define an aggregate SQL function
+         * 
+         * @tparam State per-group state, value-initialized on the first row
+         * @param name function name
+         * @param step called as `step(State &, args...)` for each row
+         * @param final called as `final(State &)`, returns the result
+         * @param flags combination of FunctionFlag
+         */
+        template <typename State, typename Step, typename Final>
+        void defineAggregate(const char * name, Step step, Final final, int flags = 0);
+
+        /**
+         * @brief define an aggregate SQL function usable as a window function
+         * 
+         * @tparam State per-window state
+         * @param name function name
+         * @param step called as `step(State &, args...)` when a row enters the window
+         * @param inverse called as `inverse(State &, args...)` when a row leaves it
+         * @param value called as `value(State &)`, returns the current result
+         * @param flags combination of FunctionFlag
+         */
+        template <typename State, typename Step, typename Inverse, typename Value>
+        void defineWindow(const char * name, Step step, Inverse inverse, Value value, int flags = 0);
+
+        /**
+         * @brief expose a container of structs as a read-only virtual table
+         * 
+         * Rows are read in place, nothing is copied. With a VTableKey
+         * column, an index permutation sorted by the key is built here and
+         * used to answer `=`, `<`, `<=`, `>`, `>=` constraints and ORDER BY
+         * on that column.
+         * 
+         * @tparam Columns VTableColumn / VTableKey descriptions, in table order
+         * @param name table name
+         * @param rows random-access container; must outlive the connection and
+         * keep its size and keys unchanged
+         * @param eponymous if true the table is usable as `main.name` right away;
+         * otherwise `temp.name` is created with CREATE VIRTUAL TABLE
+         */
+        template <typename ... Columns, typename Container>
+        void defineTable(const char * name, const Container & rows, bool eponymous = true);
+
+        /**
+         * @brief remove a user-defined SQL function
+         * 
+         * @param name function name
+         * @param nargs number of arguments it was defined with
+         */
+        void removeFunction(const char * name, int nargs);
+
+        SQLite3Stmt makeInsert(const char * table, const char * names, const char * values);
+        SQLite3Stmt makeInsert(const char * table, const char * values);
+        SQLite3Stmt makeSelect(const char * table, const char * names = nullptr, const char * where = nullptr);
+        SQLite3Stmt makeUpdate(const char * table,
+            std::initializer_list<std::pair<const char*, const char*>> name_vals, const char * where);
+        SQLite3Stmt makeDelete(const char * table, const char * where);
+
+        /**
+         * @brief make an INSERT statement whose text is built at compile time
+         * 
+         * `makeInsert<"users", "id,name">()` compiles
+         * `INSERT INTO users(id,name) VALUES (?,?);`
+         * 
+         * @tparam Table table name
+         * @tparam Names column names, separated by commas
+         * @tparam Values value expressions; one `?` per column if empty
+         */
+        template <FixedString Table, FixedString Names, FixedString Values = "">
+        SQLite3Stmt makeInsert()
+        {
+            static_assert(Table.size() != 0 && Names.size() != 0);
+            using Sql = _SqlText<[](_SqlSink & s)
+            {
+                s << "INSERT INTO " << Table.view() << "(" << Names.view() << ") VALUES (";
+                if constexpr (Values.size() == 0)
+                    s.placeholders(Names.view(), false);
+                else
+                    s << Values.view();
+                s << ");";
+            }>;
+            return SQLite3Stmt(*this, Sql::text.data());
+        }
+
+        /**
+         * @brief make a SELECT statement whose text is built at compile time
+         * 
+         * `makeSelect<"users", "id,name", "age>?">()` compiles
+         * `SELECT id,name FROM users WHERE age>?;`
+         * 
+         * @tparam Table table name
+         * @tparam Names result columns
+         * @tparam Where condition; no WHERE clause if empty
+         */
+        template <FixedString Table, FixedString Names = "*", FixedString Where = "">
+        SQLite3Stmt makeSelect()
+        {
+            static_assert(Table.size() != 0 && Names.size() != 0);
+            using Sql = _SqlText<[](_SqlSink & s)
+            {
+                s << "SELECT " << Names.view() << " FROM " << Table.view();
+                if constexpr (Where.size() != 0)
+                    s << " WHERE " << Where.view();
+                s << ";";
+            }>;
+            return SQLite3Stmt(*this, Sql::text.data());
+        }
+
+        /**
+         * @brief make an UPDATE statement whose text is built at compile time
+         * 
+         * `makeUpdate<"users", "name,age", "id=?">()` compiles
+         * `UPDATE users SET name=?,age=? WHERE id=?;`
+         * 
+         * @tparam Table table name
+         * @tparam Assignments column names (each gets `=?`), or full assignments if containing '='
+         * @tparam Where condition; no WHERE clause if empty
+         */
+        template <FixedString Table, FixedString Assignments, FixedString Where = "">
+        SQLite3Stmt makeUpdate()
+        {
+            static_assert(Table.size() != 0 && Assignments.size() != 0);
+            using Sql = _SqlText<[](_SqlSink & s)
+            {
+                s << "UPDATE " << Table.view() << " SET ";
+                s.placeholders(Assignments.view(), true);
+                if constexpr (Where.size() != 0)
+                    s << " WHERE " << Where.view();
+                s << ";";
+            }>;
+            return SQLite3Stmt(*this, Sql::text.data());
+        }
+
+        /**
+         * @brief make a DELETE statement whose text is built at compile time
+         * 
+         * @tparam Table table name
+         * @tparam Where condition; no WHERE clause if empty
+         */
+        template <FixedString Table, FixedString Where = "">
+        SQLite3Stmt makeDelete()
+        {
+            static_assert(Table.size() != 0);
+            using Sql = _SqlText<[](_SqlSink & s)
+            {
+                s << "DELETE FROM " << Table.view();
+                if constexpr (Where.size() != 0)
+                    s << " WHERE " << Where.view();
+                s << ";";
+            }>;
+            return SQLite3Stmt(*this, Sql::text.data());
+        }
+    };
+
+} // namespace hgl
+
+
+#include <algorithm>
+#include <streambuf>
+#include <type_traits>
+
+namespace hgl
+{
+    template <typename T> struct _is_optional: std::false_type { };
+    template <typename T> struct _is_optional<std::optional<T>>: std::true_type { };
+}
+
+template <typename T> inline hgl::SQLite3Status hgl::SQLite3Stmt::_try_bind_val(int col, T && val)
+{
+    using U = std::remove_cv_t<std::remove_reference_t<T>>;
+
+    if constexpr (std::is_same<std::nullptr_t, U>::value)
+        return tryBindNull(col);
+    else if constexpr (_is_optional<U>::value)
+    {
+        if (val.has_value())
+            return _try_bind_val(col, *std::forward<T>(val));
+        else
+            return tryBindNull(col);
+    }
+    else if constexpr (std::is_integral<U>::value)
+        return tryBindInteger(col, val);
+    else if constexpr (std::is_floating_point<U>::value)
+        return tryBindFloat(col, val);
+    else if constexpr (std::is_array<U>::value && std::is_same<char, std::remove_extent_t<U>>::value)
+        return tryBindText(col, static_cast<const char *>(val));
+    else if constexpr (std::is_same<const char*, U>::value || std::is_same<char*, U>::value)
+    {
+        if (val == nullptr)
+            return tryBindNull(col);
+        else
+            return tryBindText(col, static_cast<const char *>(val));
+    }
+    else if constexpr (std::is_same<std::string, U>::value && !std::is_lvalue_reference<T>::value)
+        return tryBindText(col, std::move(val));
+    else if constexpr (std::is_convertible<const U &, std::string_view>::value)
+        return tryBindText(col, std::string_view(val));
+    else if constexpr (std::is_convertible<const U &, std::span<const std::byte>>::value)
+        return tryBindBlob(col, std::span<const std::byte>(val));
+    else
+        static_assert(std::is_floating_point<U>::value, "invalid type T");
+}
+
+template <typename T> inline std::size_t hgl::SQLite3Stmt::_val_size(const T & val) noexcept
+{
+    if constexpr (std::is_same<std::nullptr_t, T>::value)
+        return 0;
+    else if constexpr (_is_optional<T>::value)
+        return val.has_value() ? _val_size(*val) : 0;
+    else if constexpr (std::is_same<const char*, T>::value || std::is_same<char*, T>::value)
+        return val == nullptr ? 0 : std::strlen(val);
+    else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+        return std::string_view(val).size();
+    else if constexpr (std::is_convertible<const T &, std::span<const std::byte>>::value)
+        return std::span<const std::byte>(val).size();
+    else
+        return sizeof val;
+}
+
+template <typename Range>
+inline hgl::SQLite3Stmt::BulkStats hgl::SQLite3Stmt::executeMany(Range && rows, const BulkOptions & opts)
+{
+    return executeMany(std::forward<Range>(rows),
+        [](const auto & row) -> const auto & { return row; }, opts);
+}
+
+template <typename Range, typename Proj>
+inline hgl::SQLite3Stmt::BulkStats hgl::SQLite3Stmt::executeMany(
+    Range && rows, Proj proj, const BulkOptions & opts)
+{
+    using clock = std::chrono::steady_clock;
+
+    BulkStats stats{0, 0, 0, 0.0};
+    std::size_t chunk_rows = 0, chunk_bytes = 0;
+    const auto start = clock::now();
+
+    this->reset();
+    bool own_txn = this->_bulk_begin();
+
+    try
+    {
+        for (auto && row: rows)
+        {
+            // text and blobs are bound without a copy: keep a projected temporary until the step
+            auto && projected = proj(row);
+            std::size_t row_bytes = 0;
+            std::apply([this, &row_bytes](const auto & ... vals)
+            {
+                int i = 0;
+                ((this->_bind_val(++i, vals), row_bytes += _val_size(vals)), ...);
+            }, projected);
+
+            this->_step();
+            this->reset();
+
+            stats.rows++;
+            stats.bytes += row_bytes;
+            chunk_rows++;
+            chunk_bytes += row_bytes;
+
+            if (own_txn &&
+                ((opts.chunk_rows != 0 && chunk_rows >= opts.chunk_rows) ||
+                 (opts.chunk_bytes != 0 && chunk_bytes >= opts.chunk_bytes)))
+            {
+                this->_bulk_commit();
+                stats.commits++;
+                chunk_rows = 0;
+                chunk_bytes = 0;
+                own_txn = this->_bulk_begin();
+            }
+        }
+
+        if (own_txn)
+        {
+            this->_bulk_commit();
+            if (chunk_rows != 0)
+                stats.commits++;
+        }
+    }
+    catch (...)
+    {
+        this->reset();
+        if (own_txn)
+            this->_bulk_rollback();
+        throw;
+    }
+
+    stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return stats;
+}
+
+namespace hgl
+{
+    template <typename T> struct _row_col
+    {
+        static constexpr SQLite3Stmt::Type type =
+            std::is_integral<T>::value ? SQLite3Stmt::Type::Integer :
+            std::is_floating_point<T>::value ? SQLite3Stmt::Type::Float :
+            std::is_same<std::span<const std::byte>, T>::value ? SQLite3Stmt::Type::Blob :
+            SQLite3Stmt::Type::Text;
+
+        static_assert(std::is_arithmetic<T>::value || std::is_same<std::string_view, T>::value ||
+            std::is_same<std::string, T>::value || std::is_same<const char*, T>::value ||
+            std::is_same<std::span<const std::byte>, T>::value, "invalid column type T");
+
+        /// decode column `col` of the current row of `s`
+        static T read(const SQLite3Stmt & s, int col)
+        {
+            if constexpr (std::is_integral<T>::value)
+                return static_cast<T>(s._col_int(col));
+            else if constexpr (std::is_floating_point<T>::value)
+                return static_cast<T>(s._col_float(col));
+            else
+            {
+                std::size_t n;
+                if constexpr (std::is_same<std::span<const std::byte>, T>::value)
+                    return T(static_cast<const std::byte *>(s._col_blob(col, n)), n);
+                else
+                {
+                    auto const p = s._col_text(col, n);
+                    if constexpr (std::is_same<const char*, T>::value)
+                        return p == nullptr ? "" : p;
+                    else
+                        return T(p == nullptr ? "" : p, n);
+                }
+            }
+        }
+
+        static T decode(const SQLite3Stmt::Value & v)
+        {
+            if constexpr (std::is_integral<T>::value)
+                return static_cast<T>(v.i);
+            else if constexpr (std::is_floating_point<T>::value)
+                return static_cast<T>(v.f);
+            else if constexpr (std::is_same<std::span<const std::byte>, T>::value)
+                return T(static_cast<const std::byte *>(v.p), v.n);
+            else if constexpr (std::is_same<const char*, T>::value)
+                return v.p == nullptr ? "" : static_cast<const char *>(v.p);
+            else
+                return T(v.p == nullptr ? "" : static_cast<const char *>(v.p), v.n);
+        }
+    };
+
+    template <typename T> struct _row_col<std::optional<T>>
+    {
+        static constexpr SQLite3Stmt::Type type = _row_col<T>::type;
+
+        static std::optional<T> read(const SQLite3Stmt & s, int col)
+        {
+            if (s._col_null(col))
+                return std::nullopt;
+            return _row_col<T>::read(s, col);
+        }
+
+        static std::optional<T> decode(const SQLite3Stmt::Value & v)
+        {
+            if (v.type == SQLite3Stmt::Type::Null)
+                return std::nullopt;
+            return _row_col<T>::decode(v);
+        }
+    };
+}
+
+/// input range of typed rows, see SQLite3Stmt::rows()
+template <typename ... Ts> class hgl::SQLite3Stmt::RowRange
+{
+private:
+    SQLite3Stmt * stmt;
+
+public:
+    using value_type = std::tuple<Ts...>;
+
+    class iterator
+    {
+    private:
+        SQLite3Stmt * stmt; ///< nullptr once exhausted
+
+        template <std::size_t ... Is> value_type decode(std::index_sequence<Is...>) const
+            { return value_type(_row_col<Ts>::read(*stmt, static_cast<int>(Is)) ...); }
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = std::tuple<Ts...>;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept: stmt(nullptr) { }
+        explicit iterator(SQLite3Stmt * s) noexcept: stmt(s) { }
+
+        value_type operator*() const { return decode(std::index_sequence_for<Ts...>()); }
+
+        iterator & operator++()
+        {
+            if (!stmt->_step())
+            {
+                stmt->reset();
+                stmt = nullptr;
+            }
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator & it, std::default_sentinel_t) noexcept
+            { return it.stmt == nullptr; }
+    };
+
+    explicit RowRange(SQLite3Stmt * s) noexcept: stmt(s) { }
+
+    iterator begin()
+    {
+        if (!stmt->_start())
+        {
+            stmt->reset();
+            return iterator();
+        }
+        return iterator(stmt);
+    }
+
+    std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+};
+
+template <typename T> inline const T hgl::SQLite3Stmt::RowReader::read(int col)
+{
+    using U = typename std::remove_cv<T>::type;
+
+    if constexpr (std::is_same<std::size_t, U>::value)
         return readLength(col);
     else if constexpr (std::is_same<char*, U>::value)
         return readText(col);
@@ -308,3 +2072,590 @@ template <typename T> inline const T hgl::SQLite3Stmt::RowReader::read(int col)
     else
         static_assert(std::is_floating_point<U>::value, "invalid type T");
 }
+
+/// buffered std::streambuf over a BlobStream
+class hgl::SQLite3::BlobStream::StreamBuf final: public std::streambuf
+{
+private:
+    static constexpr std::size_t chunk = 16384;
+
+    BlobStream & blob;
+    char         get_buf[chunk];
+    char         put_buf[chunk];
+
+    bool _flush()
+    {
+        if (pptr() != pbase())
+        {
+            blob.write(std::as_bytes(std::span<const char>(pbase(), pptr())));
+            setp(put_buf, put_buf + chunk);
+        }
+        return true;
+    }
+
+    std::size_t _logical_pos() const noexcept
+        { return blob.tell() - (egptr() - gptr()) + (pptr() - pbase()); }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() != egptr())
+            return traits_type::to_int_type(*gptr());
+        _flush();
+        const auto n = blob.read(std::as_writable_bytes(std::span<char>(get_buf, chunk)));
+        setg(get_buf, get_buf, get_buf + n);
+        return n == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (gptr() != egptr())
+        {
+            blob.seek(_logical_pos());
+            setg(nullptr, nullptr, nullptr);
+        }
+        _flush();
+        setp(put_buf, put_buf + chunk);
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        try
+        {
+            _flush();
+            return 0;
+        }
+        catch (...)
+        {
+            return -1;
+        }
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override
+    {
+        const auto base = static_cast<off_type>(
+            dir == std::ios_base::beg ? 0 : dir == std::ios_base::end ? blob.size() : _logical_pos());
+        const auto target = base + off;
+        if (target < 0 || target > static_cast<off_type>(blob.size()) || sync() != 0)
+            return pos_type(off_type(-1));
+        setg(nullptr, nullptr, nullptr);
+        blob.seek(static_cast<std::size_t>(target));
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        { return seekoff(off_type(pos), std::ios_base::beg, which); }
+
+public:
+    explicit StreamBuf(BlobStream & blob) noexcept: blob(blob) { }
+    StreamBuf(const StreamBuf &) = delete;
+    ~StreamBuf() { sync(); }
+};
+
+namespace hgl
+{
+    /// signature of a callable: result and decayed argument types
+    template <typename F> struct _fn_traits: _fn_traits<decltype(&F::operator())> { };
+    template <typename R, typename ... As> struct _fn_traits<R(*)(As...)>
+    {
+        using result_type = R;
+        using args_tuple = std::tuple<std::remove_cvref_t<As>...>;
+    };
+    template <typename R, typename C, typename ... As> struct _fn_traits<R(C::*)(As...)>: _fn_traits<R(*)(As...)> { };
+    template <typename R, typename C, typename ... As> struct _fn_traits<R(C::*)(As...) const>: _fn_traits<R(*)(As...)> { };
+    template <typename R, typename C, typename ... As> struct _fn_traits<R(C::*)(As...) noexcept>: _fn_traits<R(*)(As...)> { };
+    template <typename R, typename C, typename ... As> struct _fn_traits<R(C::*)(As...) const noexcept>: _fn_traits<R(*)(As...)> { };
+
+    template <typename Tuple> struct _tuple_tail;
+    template <typename T, typename ... Ts> struct _tuple_tail<std::tuple<T, Ts...>> { using type = std::tuple<Ts...>; };
+
+    /// C++ value to SQLite3Stmt::Value (the reverse of _row_col), referencing `r`
+    template <typename T> inline SQLite3Stmt::Value _to_value(const T & r) noexcept
+    {
+        SQLite3Stmt::Value v{SQLite3Stmt::Type::Null, 0, 0.0, nullptr, 0};
+        if constexpr (std::is_same<std::nullptr_t, T>::value)
+            ;
+        else if constexpr (_is_optional<T>::value)
+        {
+            if (r.has_value())
+                v = _to_value(*r);
+        }
+        else if constexpr (std::is_integral<T>::value)
+            v.type = SQLite3Stmt::Type::Integer, v.i = static_cast<std::int64_t>(r);
+        else if constexpr (std::is_floating_point<T>::value)
+            v.type = SQLite3Stmt::Type::Float, v.f = static_cast<double>(r);
+        else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+        {
+            const std::string_view sv(r);
+            v.type = SQLite3Stmt::Type::Text, v.p = sv.data(), v.n = sv.size();
+        }
+        else if constexpr (std::is_convertible<const T &, std::span<const std::byte>>::value)
+        {
+            const std::span<const std::byte> sp(r);
+            v.type = SQLite3Stmt::Type::Blob, v.p = sp.data(), v.n = sp.size();
+        }
+        else
+            static_assert(std::is_floating_point<T>::value, "invalid result type");
+        return v;
+    }
+
+    /// call `f(prefix..., decoded args...)` and report the result or error to SQLite
+    template <typename Args> struct _fn_invoke;
+    template <typename ... As> struct _fn_invoke<std::tuple<As...>>
+    {
+        static constexpr int argc = sizeof...(As);
+
+        template <typename F, std::size_t ... Is, typename ... Pre>
+        static void apply(void * ctx, const SQLite3Stmt::Value * vals,
+            std::index_sequence<Is...>, F & f, Pre & ... pre)
+        {
+            using R = decltype(f(pre..., _row_col<As>::decode(vals[Is]) ...));
+            if constexpr (std::is_void<R>::value)
+                f(pre..., _row_col<As>::decode(vals[Is]) ...);
+            else
+                _SqlFn::result(ctx, _to_value(f(pre..., _row_col<As>::decode(vals[Is]) ...)));
+        }
+
+        template <typename F, typename ... Pre>
+        static void run(void * ctx, void ** argv, F & f, Pre & ... pre) noexcept
+        {
+            static constexpr SQLite3Stmt::Type types[argc == 0 ? 1 : argc] = { _row_col<As>::type ... };
+            SQLite3Stmt::Value vals[argc == 0 ? 1 : argc];
+            _SqlFn::args(argv, types, vals, argc);
+
+            try
+            {
+                apply(ctx, vals, std::index_sequence_for<As...>(), f, pre...);
+            }
+            catch (const SQLite3Error & e)
+            {
+                _SqlFn::error(ctx, e.what(), e.errcode());
+            }
+            catch (const std::exception & e)
+            {
+                _SqlFn::error(ctx, e.what(), 1);
+            }
+            catch (...)
+            {
+                _SqlFn::error(ctx, "unknown exception in SQL function", 1);
+            }
+        }
+
+        template <typename F, typename S> static void finish(void * ctx, F & f, S & state) noexcept
+        {
+            try
+            {
+                _SqlFn::result(ctx, _to_value(f(state)));
+            }
+            catch (const SQLite3Error & e)
+            {
+                _SqlFn::error(ctx, e.what(), e.errcode());
+            }
+            catch (const std::exception & e)
+            {
+                _SqlFn::error(ctx, e.what(), 1);
+            }
+            catch (...)
+            {
+                _SqlFn::error(ctx, "unknown exception in SQL function", 1);
+            }
+        }
+    };
+
+    template <typename F> struct _ScalarFunction final: _SqlFunction
+    {
+        using invoke = _fn_invoke<typename _fn_traits<F>::args_tuple>;
+
+        F f;
+
+        explicit _ScalarFunction(F && f): f(std::move(f)) { }
+
+        void call(void * ctx, int, void ** argv) noexcept override
+            { invoke::run(ctx, argv, this->f); }
+    };
+
+    template <typename State, typename Step, typename Inverse, typename Final>
+    struct _AggregateFunction final: _SqlFunction
+    {
+        using invoke = _fn_invoke<typename _tuple_tail<typename _fn_traits<Step>::args_tuple>::type>;
+
+        Step    step_f;
+        Inverse inverse_f;
+        Final   final_f;
+
+        _AggregateFunction(Step && s, Inverse && i, Final && f):
+            step_f(std::move(s)), inverse_f(std::move(i)), final_f(std::move(f)) { }
+
+        static State * get(void ** state) noexcept
+        {
+            if (*state == nullptr)
+            {
+                try
+                {
+                    *state = new State();
+                }
+                catch (...)
+                {
+                    return nullptr;
+                }
+            }
+            return static_cast<State *>(*state);
+        }
+
+        void step(void * ctx, void ** state, int, void ** argv) noexcept override
+        {
+            if (auto st = get(state))
+                invoke::run(ctx, argv, this->step_f, *st);
+            else
+                _SqlFn::noMemory(ctx);
+        }
+
+        void inverse(void * ctx, void ** state, int, void ** argv) noexcept override
+        {
+            if constexpr (!std::is_same<std::nullptr_t, Inverse>::value)
+            {
+                if (auto st = get(state))
+                    invoke::run(ctx, argv, this->inverse_f, *st);
+            }
+        }
+
+        void value(void * ctx, void ** state) noexcept override
+        {
+            if (auto st = get(state))
+                invoke::finish(ctx, this->final_f, *st);
+            else
+                _SqlFn::noMemory(ctx);
+        }
+
+        void final(void * ctx, void ** state) noexcept override
+        {
+            if (state == nullptr || *state == nullptr) // no rows at all
+            {
+                State empty{};
+                invoke::finish(ctx, this->final_f, empty);
+                return;
+            }
+            auto st = static_cast<State *>(*state);
+            invoke::finish(ctx, this->final_f, *st);
+            delete st;
+            *state = nullptr;
+        }
+    };
+}
+
+namespace hgl
+{
+    /// row callback of SQLite3::execScript(), called with typed columns
+    template <typename F, typename Args> struct _ScriptRows;
+    template <typename F, typename ... As> struct _ScriptRows<F, std::tuple<As...>>
+    {
+        static constexpr int columns = sizeof...(As);
+
+        static void visit(void * ctx, SQLite3Stmt & stmt)
+        {
+            auto & f = *static_cast<F *>(ctx);
+            for (auto && row: stmt.rows<As...>())
+                std::apply(f, std::move(row));
+        }
+    };
+
+    /// row callback of SQLite3::execScript(), called with a RowReader
+    template <typename F> struct _ScriptRows<F, std::tuple<SQLite3Stmt::RowReader>>
+    {
+        static constexpr int columns = -1;
+
+        static void visit(void * ctx, SQLite3Stmt & stmt)
+        {
+            auto & f = *static_cast<F *>(ctx);
+            for (auto & row: stmt)
+                f(row);
+        }
+    };
+}
+
+template <typename F> inline void hgl::SQLite3::execScript(const char * script, F && f, bool cache)
+{
+    using Rows = _ScriptRows<std::remove_reference_t<F>, typename _fn_traits<std::decay_t<F>>::args_tuple>;
+    this->_exec_script(script, cache, Rows::columns, &Rows::visit,
+        const_cast<void *>(static_cast<const void *>(std::addressof(f))));
+}
+
+namespace hgl
+{
+    /// decode a row fetched by SQLite3Stmt::_fetch_row() or stored by the query cache
+    template <typename ... Ts, std::size_t ... Is>
+    inline std::tuple<Ts...> _decode_row(const SQLite3Stmt::Value * vals, std::index_sequence<Is...>)
+        { return std::tuple<Ts...>(_row_col<Ts>::decode(vals[Is]) ...); }
+}
+
+/// append a parameter to a query cache key: a type tag, then the value (length-prefixed if variable)
+template <typename T> inline void hgl::SQLite3::_query_key_arg(std::string & key, const T & val)
+{
+    using U = std::remove_cv_t<T>;
+
+    auto put = [&key](char tag, const void * p, std::size_t n)
+    {
+        key.push_back(tag);
+        key.append(reinterpret_cast<const char *>(&n), sizeof n);
+        key.append(static_cast<const char *>(p), n);
+    };
+
+    if constexpr (std::is_same<std::nullptr_t, U>::value)
+        key.push_back('n');
+    else if constexpr (_is_optional<U>::value)
+    {
+        if (val.has_value())
+            _query_key_arg(key, *val);
+        else
+            key.push_back('n');
+    }
+    else if constexpr (std::is_integral<U>::value)
+    {
+        const auto v = static_cast<std::int64_t>(val);
+        put('i', &v, sizeof v);
+    }
+    else if constexpr (std::is_floating_point<U>::value)
+    {
+        const auto v = static_cast<double>(val);
+        put('f', &v, sizeof v);
+    }
+    else if constexpr (std::is_same<const char*, U>::value || std::is_same<char*, U>::value)
+    {
+        if (val == nullptr)
+            key.push_back('n');
+        else
+            put('t', val, std::strlen(val));
+    }
+    else if constexpr (std::is_convertible<const U &, std::string_view>::value)
+    {
+        const std::string_view v(val);
+        put('t', v.data(), v.size());
+    }
+    else if constexpr (std::is_convertible<const U &, std::span<const std::byte>>::value)
+    {
+        const std::span<const std::byte> v(val);
+        put('b', v.data(), v.size());
+    }
+    else
+        static_assert(std::is_floating_point<U>::value, "invalid type T");
+}
+
+template <typename ... Ts, typename ... Args>
+inline std::vector<std::tuple<Ts...>> hgl::SQLite3::cachedQuery(const char * sql, Args && ... args)
+{
+    static_assert(sizeof...(Ts) != 0, "no column types");
+    static_assert(((!std::is_same<std::string_view, Ts>::value &&
+        !std::is_same<const char *, Ts>::value &&
+        !std::is_same<std::span<const std::byte>, Ts>::value) && ...),
+        "rows outlive their statement: use std::string instead of views");
+
+    using Rows = std::vector<std::tuple<Ts...>>;
+    using Params = std::tuple<Args && ...>;
+    static constexpr SQLite3Stmt::Type types[] = { _row_col<Ts>::type ... };
+
+    std::string key;
+    _query_key(key, sql, types, sizeof...(Ts));
+    (_query_key_arg(key, args), ...);
+
+    Params params(std::forward<Args>(args)...);
+    Rows rows;
+    this->_cached_query(sql, key, types, sizeof...(Ts),
+        [](void * ctx, SQLite3Stmt & stmt)
+        {
+            std::apply([&stmt](auto && ... vals)
+                { int i = 0; (stmt._bind_val(++i, std::forward<decltype(vals)>(vals)), ...); },
+                std::move(*static_cast<Params *>(ctx)));
+        }, &params,
+        [](void * ctx, const SQLite3Stmt::Value * vals)
+            { static_cast<Rows *>(ctx)->push_back(_decode_row<Ts...>(vals, std::index_sequence_for<Ts...>())); },
+        &rows);
+    return rows;
+}
+
+template <typename F> inline void hgl::SQLite3::defineFunction(const char * name, F f, int flags)
+{
+    using Fn = _ScalarFunction<F>;
+    this->_define(name, Fn::invoke::argc, flags, _FnKind::Scalar, new Fn(std::move(f)));
+}
+
+template <typename State, typename Step, typename Final>
+inline void hgl::SQLite3::defineAggregate(const char * name, Step step, Final final, int flags)
+{
+    using Fn = _AggregateFunction<State, Step, std::nullptr_t, Final>;
+    this->_define(name, Fn::invoke::argc, flags, _FnKind::Aggregate,
+        new Fn(std::move(step), nullptr, std::move(final)));
+}
+
+template <typename State, typename Step, typename Inverse, typename Value>
+inline void hgl::SQLite3::defineWindow(const char * name, Step step, Inverse inverse, Value value, int flags)
+{
+    using Fn = _AggregateFunction<State, Step, Inverse, Value>;
+    this->_define(name, Fn::invoke::argc, flags, _FnKind::Window,
+        new Fn(std::move(step), std::move(inverse), std::move(value)));
+}
+
+namespace hgl
+{
+    /// SQL column type of a member
+    template <typename T> constexpr const char * _sql_type_name() noexcept
+    {
+        if constexpr (_is_optional<T>::value)
+            return _sql_type_name<typename T::value_type>();
+        else if constexpr (std::is_integral<T>::value)
+            return "INTEGER";
+        else if constexpr (std::is_floating_point<T>::value)
+            return "REAL";
+        else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+            return "TEXT";
+        else
+            return "BLOB";
+    }
+
+    /// key ordering for _VTable; empty optionals sort first
+    template <typename K> inline bool _key_less(const K & a, const K & b) noexcept
+    {
+        if constexpr (_is_optional<K>::value)
+            return b.has_value() && (!a.has_value() || _key_less(*a, *b));
+        else if constexpr (std::is_arithmetic<K>::value)
+            return a < b;
+        else if constexpr (std::is_convertible<const K &, std::string_view>::value)
+            return std::string_view(a) < std::string_view(b);
+        else
+        {
+            const std::span<const std::byte> x(a), y(b);
+            return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+        }
+    }
+
+    template <typename K> inline bool _key_comparable(const SQLite3Stmt::Value & v) noexcept
+    {
+        using Type = SQLite3Stmt::Type;
+        if constexpr (_is_optional<K>::value)
+            return _key_comparable<typename K::value_type>(v);
+        else if constexpr (std::is_arithmetic<K>::value)
+            return v.type == Type::Integer || v.type == Type::Float;
+        else if constexpr (std::is_convertible<const K &, std::string_view>::value)
+            return v.type == Type::Text;
+        else
+            return v.type == Type::Blob;
+    }
+
+    /// compare a key with a constraint value of a comparable type, in SQLite's BINARY order
+    template <typename K> inline int _key_compare(const K & k, const SQLite3Stmt::Value & v) noexcept
+    {
+        if constexpr (_is_optional<K>::value)
+            return k.has_value() ? _key_compare(*k, v) : -1;
+        else if constexpr (std::is_arithmetic<K>::value)
+        {
+            if (std::is_integral<K>::value && v.type == SQLite3Stmt::Type::Integer)
+            {
+                const auto x = static_cast<std::int64_t>(k);
+                return x < v.i ? -1 : x > v.i ? 1 : 0;
+            }
+            const auto x = static_cast<double>(k);
+            const auto y = v.type == SQLite3Stmt::Type::Integer ? static_cast<double>(v.i) : v.f;
+            return x < y ? -1 : x > y ? 1 : 0;
+        }
+        else
+        {
+            std::string_view x;
+            if constexpr (std::is_convertible<const K &, std::string_view>::value)
+                x = std::string_view(k);
+            else
+            {
+                const std::span<const std::byte> sp(k);
+                x = std::string_view(reinterpret_cast<const char *>(sp.data()), sp.size());
+            }
+            const auto c = x.compare(std::string_view(static_cast<const char *>(v.p), v.n));
+            return c < 0 ? -1 : c > 0 ? 1 : 0;
+        }
+    }
+
+    template <typename Container, typename ... Columns> struct _VTable final: _VTableSource
+    {
+        static constexpr int key_index = []
+        {
+            constexpr bool keys[] = { Columns::is_key ... };
+            int key = -1;
+            for (int i = 0; i < static_cast<int>(sizeof...(Columns)); i++)
+            {
+                if (keys[i])
+                    key = i;
+            }
+            return key;
+        }();
+
+        static_assert(sizeof...(Columns) > 0, "no columns");
+        static_assert((0 + ... + (Columns::is_key ? 1 : 0)) <= 1, "more than one VTableKey");
+
+        using KeyColumn = std::tuple_element_t<key_index < 0 ? 0 : key_index, std::tuple<Columns...>>;
+        using Row = std::remove_cvref_t<decltype(*std::begin(std::declval<const Container &>()))>;
+        using Key = std::remove_cvref_t<decltype(KeyColumn::get(std::declval<const Row &>()))>;
+
+        const Container &        rows;
+        std::vector<std::size_t> order; ///< container indices sorted by key
+        std::string              decl;
+
+        const Row & at(std::size_t i) const noexcept { return std::begin(this->rows)[i]; }
+
+        explicit _VTable(const Container & c): rows(c)
+        {
+            this->decl = "CREATE TABLE x(";
+            ((this->decl.append(this->decl.back() == '(' ? "\"" : ", \"").append(Columns::name())
+                .append("\" ").append(_sql_type_name<std::remove_cvref_t<
+                    decltype(Columns::get(std::declval<const Row &>()))>>())), ...);
+            this->decl += ')';
+
+            if constexpr (key_index >= 0)
+            {
+                this->order.resize(this->size());
+                for (std::size_t i = 0; i < this->order.size(); i++)
+                    this->order[i] = i;
+                std::stable_sort(this->order.begin(), this->order.end(), [this](std::size_t a, std::size_t b)
+                    { return _key_less(KeyColumn::get(this->at(a)), KeyColumn::get(this->at(b))); });
+            }
+        }
+
+        const char * declaration() const noexcept override { return this->decl.c_str(); }
+        std::size_t size() const noexcept override { return static_cast<std::size_t>(std::size(this->rows)); }
+        int keyColumn() const noexcept override { return key_index; }
+
+        std::size_t rowAt(std::size_t pos) const noexcept override
+            { return key_index < 0 ? pos : this->order[pos]; }
+
+        template <std::size_t ... Is>
+        void _column(std::index_sequence<Is...>, const Row & row, int col, SQLite3Stmt::Value & out) const noexcept
+            { (void)((col == static_cast<int>(Is) ? (out = _to_value(Columns::get(row)), true) : false) || ...); }
+
+        void column(std::size_t row, int col, SQLite3Stmt::Value & out) const noexcept override
+            { this->_column(std::index_sequence_for<Columns...>(), this->at(row), col, out); }
+
+        bool comparable(const SQLite3Stmt::Value & v) const noexcept override
+        {
+            if constexpr (key_index >= 0)
+                return _key_comparable<Key>(v);
+            else
+                return false;
+        }
+
+        int compare(std::size_t row, const SQLite3Stmt::Value & v) const noexcept override
+        {
+            if constexpr (key_index >= 0)
+                return _key_compare(KeyColumn::get(this->at(row)), v);
+            else
+                return 0;
+        }
+    };
+}
+
+template <typename ... Columns, typename Container>
+inline void hgl::SQLite3::defineTable(const char * name, const Container & rows, bool eponymous)
+{
+    this->_define_table(name, new _VTable<Container, Columns...>(rows), eponymous);
+}
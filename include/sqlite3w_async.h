@@ -0,0 +1,313 @@
+/**
+ * @file sqlite3w_async.h
+ * @brief asynchronous SQLite3 execution on a dedicated worker thread
+ */
+
+#pragma once
+
+#include "sqlite3w.h"
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+namespace hgl
+{
+    /**
+     * @brief database connection owned by a worker thread
+     *
+     * Jobs are pushed onto a lock-free queue and run in submission order on
+     * the worker, which is the only thread touching the connection. Write
+     * jobs that are queued back to back are coalesced into one transaction
+     * (group commit), each inside its own savepoint so that a failing job
+     * only rolls back itself. Write results become ready after the commit.
+     */
+    class HGL_API SQLite3Async
+    {
+    public:
+        struct Options
+        {
+            std::size_t max_group = 1000; ///< max write jobs per group commit
+
+            /// how to resume an awaiting coroutine; empty resumes it on the worker thread
+            std::function<void(std::coroutine_handle<>)> resume;
+        };
+
+        struct Stats
+        {
+            std::uint64_t jobs;    ///< jobs completed
+            std::uint64_t writes;  ///< write jobs completed
+            std::uint64_t commits; ///< group commits
+        };
+
+        template <typename T> class Result;
+
+    protected:
+        template <typename T> struct State
+        {
+            using storage_type = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+            std::atomic<int>        phase{0}; ///< 0 = pending, 1 = awaited, 2 = ready
+            std::optional<storage_type> value;
+            std::exception_ptr      error;
+            std::coroutine_handle<> waiter;
+            const std::function<void(std::coroutine_handle<>)> * resume;
+
+            void finish() noexcept
+            {
+                if (this->phase.exchange(2, std::memory_order_acq_rel) == 1)
+                {
+                    if (*this->resume)
+                        (*this->resume)(this->waiter);
+                    else
+                        this->waiter.resume();
+                }
+                this->phase.notify_all();
+            }
+        };
+
+        /// queued job; the worker calls run(), then finish() or fail()
+        struct Job
+        {
+            Job * next = nullptr;
+            bool  write;
+
+            explicit Job(bool w) noexcept: write(w) { }
+            virtual ~Job() = default;
+            virtual void run(SQLite3 & db) = 0;
+            virtual void finish() noexcept = 0;
+            virtual void fail(std::exception_ptr e) noexcept = 0;
+        };
+
+        template <typename F, typename T> struct JobImpl final: Job
+        {
+            F f;
+            std::shared_ptr<State<T>> state;
+
+            template <typename G> JobImpl(bool w, G && fn, std::shared_ptr<State<T>> s):
+                Job(w), f(std::forward<G>(fn)), state(std::move(s)) { }
+
+            void run(SQLite3 & db) override
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    this->f(db);
+                    this->state->value.emplace(true);
+                }
+                else
+                {
+                    this->state->value.emplace(this->f(db));
+                }
+            }
+
+            void finish() noexcept override { this->state->finish(); }
+
+            void fail(std::exception_ptr e) noexcept override
+            {
+                this->state->value.reset();
+                this->state->error = std::move(e);
+                this->state->finish();
+            }
+        };
+
+        struct Internals;
+
+        Internals * internals; ///< connection, queue and worker thread (see src/async.cc)
+
+        void _push(Job * job) noexcept;
+        const std::function<void(std::coroutine_handle<>)> * _resumer() const noexcept;
+
+        /// argument copy kept until the job runs: text becomes std::string,
+        /// blobs std::vector<std::byte>, null char pointers an empty optional
+        template <typename T> static auto _own(T && v);
+
+        template <typename T, typename F> Result<T> _submit(bool write, F && f);
+
+    public:
+        /**
+         * @brief pending result of an asynchronous job
+         *
+         * Either co_await it (at most once) or block on get().
+         */
+        template <typename T> class Result
+        {
+        protected:
+            std::shared_ptr<State<T>> state;
+
+            explicit Result(std::shared_ptr<State<T>> s) noexcept: state(std::move(s)) { }
+
+            friend class SQLite3Async;
+
+        public:
+            Result() = default;
+
+            /**
+             * @brief check if the job has completed
+             */
+            bool ready() const noexcept { return this->state->phase.load(std::memory_order_acquire) == 2; }
+
+            /**
+             * @brief wait for the job to complete
+             */
+            void wait() const noexcept
+            {
+                for (int p; (p = this->state->phase.load(std::memory_order_acquire)) != 2; )
+                    this->state->phase.wait(p, std::memory_order_acquire);
+            }
+
+            /**
+             * @brief wait for the job and get its result
+             * @note rethrows the exception thrown by the job
+             */
+            T get()
+            {
+                this->wait();
+                if (this->state->error)
+                    std::rethrow_exception(this->state->error);
+                if constexpr (!std::is_void_v<T>)
+                    return std::move(*this->state->value);
+            }
+
+            bool await_ready() const noexcept { return this->ready(); }
+
+            bool await_suspend(std::coroutine_handle<> h) noexcept
+            {
+                this->state->waiter = h;
+                int expected = 0;
+                return this->state->phase.compare_exchange_strong(expected, 1, std::memory_order_acq_rel);
+            }
+
+            T await_resume() { return this->get(); }
+        };
+
+        /**
+         * @brief open a database and start the worker thread
+         *
+         * @param filename name of the database file
+         * @param opts queue options
+         */
+        SQLite3Async(const char * filename, Options opts);
+
+        /**
+         * @brief open a database with default options and start the worker thread
+         */
+        explicit SQLite3Async(const char * filename): SQLite3Async(filename, Options()) { }
+
+        SQLite3Async(SQLite3Async &&) = delete;
+        SQLite3Async(const SQLite3Async &) = delete;
+
+        /**
+         * @brief run the remaining jobs, stop the worker and close the database
+         */
+        ~SQLite3Async();
+
+        /**
+         * @brief run `f(SQLite3 &)` on the worker, outside any group commit
+         */
+        template <typename F> auto submit(F && f)
+            { return this->_submit<std::invoke_result_t<F &, SQLite3 &>>(false, std::forward<F>(f)); }
+
+        /**
+         * @brief run `f(SQLite3 &)` on the worker as part of a group commit
+         *
+         * The result becomes ready after the enclosing transaction commits.
+         * An exception thrown by `f` rolls back its own changes only.
+         */
+        template <typename F> auto write(F && f)
+            { return this->_submit<std::invoke_result_t<F &, SQLite3 &>>(true, std::forward<F>(f)); }
+
+        /**
+         * @brief execute a writing statement with parameters
+         *
+         * The arguments are copied; text and blob views are copied into
+         * strings and byte vectors.
+         */
+        template <typename ... Args> Result<void> execute(std::string sql, Args && ... args);
+
+        /**
+         * @brief run a query and collect all rows
+         *
+         * @tparam Ts column types (std::string rather than views, the statement is gone afterwards)
+         */
+        template <typename ... Ts, typename ... Args>
+        Result<std::vector<std::tuple<Ts...>>> query(std::string sql, Args && ... args);
+
+        /**
+         * @brief get worker statistics
+         */
+        Stats getStats() const noexcept;
+    };
+
+} // namespace hgl
+
+
+template <typename T> auto hgl::SQLite3Async::_own(T && v)
+{
+    using U = std::decay_t<T>;
+
+    if constexpr (std::is_same_v<U, std::nullptr_t> || std::is_arithmetic_v<U> ||
+            std::is_same_v<U, std::string> || std::is_same_v<U, std::vector<std::byte>>)
+        return U(std::forward<T>(v));
+    else if constexpr (std::is_same_v<U, const char *> || std::is_same_v<U, char *>)
+    {
+        const char * p = v; // decay string literals before the null check
+        return p == nullptr ? std::optional<std::string>() : std::optional<std::string>(p);
+    }
+    else if constexpr (_is_optional<U>::value)
+    {
+        using V = decltype(_own(*std::forward<T>(v)));
+        return v.has_value() ? std::optional<V>(_own(*std::forward<T>(v))) : std::optional<V>();
+    }
+    else if constexpr (std::is_convertible_v<const U &, std::string_view>)
+        return std::string(std::string_view(v));
+    else if constexpr (std::is_convertible_v<const U &, std::span<const std::byte>>)
+    {
+        const std::span<const std::byte> bytes(v);
+        return std::vector<std::byte>(bytes.begin(), bytes.end());
+    }
+    else
+        return U(std::forward<T>(v));
+}
+
+template <typename T, typename F>
+hgl::SQLite3Async::Result<T> hgl::SQLite3Async::_submit(bool write, F && f)
+{
+    auto state = std::make_shared<State<T>>();
+    state->resume = this->_resumer();
+    this->_push(new JobImpl<std::decay_t<F>, T>(write, std::forward<F>(f), state));
+    return Result<T>(std::move(state));
+}
+
+template <typename ... Args>
+hgl::SQLite3Async::Result<void> hgl::SQLite3Async::execute(std::string sql, Args && ... args)
+{
+    return this->write(
+        [sql = std::move(sql), params = std::make_tuple(_own(std::forward<Args>(args))...)]
+        (SQLite3 & db)
+        {
+            SQLite3Stmt stmt(db, sql.c_str());
+            std::apply(stmt, params);
+        });
+}
+
+template <typename ... Ts, typename ... Args>
+hgl::SQLite3Async::Result<std::vector<std::tuple<Ts...>>>
+hgl::SQLite3Async::query(std::string sql, Args && ... args)
+{
+    return this->submit(
+        [sql = std::move(sql), params = std::make_tuple(_own(std::forward<Args>(args))...)]
+        (SQLite3 & db)
+        {
+            SQLite3Stmt stmt(db, sql.c_str());
+            std::vector<std::tuple<Ts...>> rows;
+            if (std::apply(stmt, params))
+            {
+                for (auto && row: stmt.rows<Ts...>())
+                    rows.push_back(std::move(row));
+            }
+            return rows;
+        });
+}
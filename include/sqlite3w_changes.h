@@ -0,0 +1,114 @@
+/**
+ * @file sqlite3w_changes.h
+ * @brief committed row changes of a connection, see SQLite3::watchChanges()
+ */
+
+#pragma once
+
+#include "sqlite3w.h"
+
+#include <atomic>
+#include <deque>
+
+namespace hgl
+{
+    /// one changed row
+    struct ChangeEvent
+    {
+        enum class Op { Insert, Update, Delete };
+
+        Op           op;
+        const char * table; ///< table name, valid as long as the stream
+        std::int64_t rowid;
+    };
+
+    /**
+     * @brief bounded lock-free queue of committed row changes
+     * 
+     * Filled by the connection that created it (see SQLite3::watchChanges())
+     * and drained by any number of consumer threads. Events of a transaction
+     * are published together when it commits and discarded when it rolls
+     * back, or when a savepoint they were made under is rolled back to.
+     * When the queue is full, new events are dropped and counted; a
+     * consumer that sees dropped() grow has missed changes and should
+     * resynchronize (e.g. invalidate all caches).
+     * 
+     * @note Changes of WITHOUT ROWID tables and rows deleted by ON CONFLICT
+     *       REPLACE are not reported (see sqlite3_update_hook). Events are
+     *       published once the COMMIT has returned successfully, so a
+     *       consumer never sees changes of a transaction that failed.
+     */
+    class HGL_API ChangeStream
+    {
+    protected:
+        /// ring slot, sequenced as in D. Vyukov's bounded MPMC queue
+        struct Cell
+        {
+            std::atomic<std::uint64_t> seq;
+            ChangeEvent                event;
+        };
+
+        Cell        * cells;
+        std::size_t   mask;    ///< capacity - 1, capacity being a power of 2
+
+        alignas(64) std::atomic<std::uint64_t> head;  ///< next slot to write
+        alignas(64) std::atomic<std::uint64_t> tail;  ///< next slot to read
+        alignas(64) std::atomic<std::uint64_t> epoch; ///< bumped on each publish, for wait()
+        std::atomic<std::uint64_t> published_count, dropped_count;
+        std::atomic<bool>          is_closed;
+
+        std::deque<std::string> tables; ///< interned table names, producer side only
+
+        bool _push(const ChangeEvent & ev) noexcept;
+        void _publish(const ChangeEvent * events, std::size_t n) noexcept;
+        const char * _intern(const char * table);
+        void _close() noexcept;
+
+        friend class ChangeLog; // src/internal.h
+
+    public:
+        /**
+         * @param capacity max queued events, rounded up to a power of 2
+         */
+        explicit ChangeStream(std::size_t capacity);
+        ChangeStream(const ChangeStream &) = delete;
+        ~ChangeStream();
+
+        /**
+         * @brief take queued events without blocking
+         * 
+         * @param out buffer to fill
+         * @return number of events taken, 0 if the queue is empty
+         */
+        std::size_t drain(std::span<ChangeEvent> out) noexcept;
+
+        /**
+         * @brief take one queued event without blocking
+         */
+        bool pop(ChangeEvent & ev) noexcept { return drain(std::span<ChangeEvent>(&ev, 1)) == 1; }
+
+        /**
+         * @brief block until events are queued or the stream is closed
+         * 
+         * @return false if the stream is closed and empty
+         * @note another consumer may take the events first; drain() may then return 0
+         */
+        bool wait() const noexcept;
+
+        /**
+         * @brief check if the connection has stopped publishing
+         * 
+         * Happens on SQLite3::unwatchChanges() and when the connection is destroyed.
+         */
+        bool closed() const noexcept { return is_closed.load(std::memory_order_acquire); }
+
+        std::size_t capacity() const noexcept { return mask + 1; }
+
+        /// events queued so far
+        std::uint64_t published() const noexcept { return published_count.load(std::memory_order_relaxed); }
+
+        /// events dropped because the queue was full
+        std::uint64_t dropped() const noexcept { return dropped_count.load(std::memory_order_relaxed); }
+    };
+
+} // namespace hgl
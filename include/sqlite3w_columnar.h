@@ -0,0 +1,138 @@
+/**
+ * @file sqlite3w_columnar.h
+ * @brief query results exported to memory-mappable columnar files
+ */
+
+#pragma once
+
+#include "sqlite3w.h"
+
+namespace hgl
+{
+    /**
+     * @brief read-only columnar file, mapped into memory
+     * 
+     * Written by write() from a statement's results: rows are cut into row
+     * groups, and each group stores every column as a null bitmap followed
+     * by fixed-width values (64-bit integers or doubles) or by 64-bit
+     * offsets into a byte heap (text and blobs). A footer at the end of the
+     * file describes the columns and where each chunk lies.
+     * 
+     * Opening a file maps it and reads the footer only; column data is
+     * accessed in place through Chunk, so only the pages of the columns
+     * actually read are loaded. Files use the byte order of the writer;
+     * opening a file of the other byte order fails.
+     */
+    class HGL_API ColumnarFile
+    {
+    public:
+        struct WriteOptions
+        {
+            std::size_t group_rows = 65536; ///< rows per row group
+        };
+
+        struct WriteStats
+        {
+            std::uint64_t rows;
+            std::uint64_t groups;
+            std::uint64_t bytes;   ///< file size
+            double        seconds;
+        };
+
+        /// one column of one row group, pointing into the mapped file
+        struct Chunk
+        {
+            SQLite3Stmt::Type               type;    ///< Integer, Float, Text or Blob, per row group
+            std::size_t                     rows;
+            std::span<const std::uint64_t>  nulls;   ///< bit i set if value i is NULL
+            std::span<const std::int64_t>   ints;    ///< Type::Integer values (0 for NULL)
+            std::span<const double>         floats;  ///< Type::Float values (0.0 for NULL)
+            std::span<const std::uint64_t>  offsets; ///< Type::Text / Type::Blob: value i is heap[offsets[i], offsets[i+1])
+            const char                    * heap;
+
+            bool isNull(std::size_t row) const noexcept
+                { return (nulls[row / 64] >> (row % 64)) & 1; }
+
+            std::string_view text(std::size_t row) const noexcept
+                { return std::string_view(heap + offsets[row], offsets[row + 1] - offsets[row]); }
+
+            std::span<const std::byte> blob(std::size_t row) const noexcept
+                { return std::as_bytes(std::span<const char>(heap + offsets[row], offsets[row + 1] - offsets[row])); }
+        };
+
+    protected:
+        struct Internals;
+
+        const char  * data;      ///< mapped file
+        std::size_t   size;      ///< file size
+        Internals   * internals; ///< footer and mapping handles (see src/columnar.cc)
+
+        /// unmap the file and release the handles
+        void _close() noexcept;
+
+    public:
+        /**
+         * @brief write the remaining results of a statement to a file
+         * 
+         * Runs the statement if it has not been stepped yet, then reads it
+         * to the end like SQLite3Stmt::fetchBatch(), one row group at a
+         * time. Each row group picks the types of its own columns, and no
+         * value is converted to another storage class: an Integer column
+         * turns into a Float one when a REAL shows up, while numbers mixed
+         * with text or blobs in one column of a group are an error.
+         * The file is written under a temporary name and renamed when
+         * complete, so readers never see a partial file.
+         * 
+         * @param stmt the query
+         * @param filename file to create or replace
+         * @param opts row group size
+         * @throw std::system_error on I/O errors
+         * @throw SQLite3Error (SQLITE_MISMATCH) if a column mixes numbers with text or blobs
+         */
+        static WriteStats write(SQLite3Stmt & stmt, const char * filename, const WriteOptions & opts);
+        static WriteStats write(SQLite3Stmt & stmt, const char * filename)
+            { return write(stmt, filename, WriteOptions()); }
+
+        /**
+         * @brief map a file written by write()
+         * 
+         * @throw std::system_error if the file cannot be opened or mapped
+         * @throw std::runtime_error if it is not a valid columnar file
+         */
+        explicit ColumnarFile(const char * filename);
+
+        ColumnarFile(ColumnarFile &&) = delete;
+        ColumnarFile(const ColumnarFile &) = delete;
+
+        ~ColumnarFile();
+
+        std::size_t columnCount() const noexcept;
+        std::string_view columnName(std::size_t col) const noexcept;
+
+        /**
+         * @brief get the storage type of a column
+         * @return Integer, Float, Text or Blob; Null if the file holds no rows;
+         *         Unknown if the row groups differ (see Chunk::type)
+         */
+        SQLite3Stmt::Type columnType(std::size_t col) const noexcept;
+
+        /**
+         * @brief find a column by name
+         * @return 0 based column, or -1 if there is no such column
+         */
+        int columnIndex(std::string_view name) const noexcept;
+
+        std::uint64_t rowCount() const noexcept;
+        std::size_t groupCount() const noexcept;
+        std::size_t groupRows(std::size_t group) const noexcept;
+
+        /**
+         * @brief get a column of a row group
+         * 
+         * @param group 0 based row group
+         * @param col 0 based column
+         */
+        Chunk chunk(std::size_t group, std::size_t col) const noexcept;
+    };
+
+} // namespace hgl
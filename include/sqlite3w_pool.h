@@ -0,0 +1,118 @@
+/**
+ * @file sqlite3w_pool.h
+ * @brief SQLite3 connection pool
+ */
+
+#pragma once
+
+#include "sqlite3w.h"
+
+namespace hgl
+{
+    /**
+     * @brief thread-safe pool of connections to one database file
+     * 
+     * The database is switched to WAL mode so that the read-only connections
+     * never block each other or the single writer connection. Each pooled
+     * connection keeps its own prepared statement cache.
+     */
+    class HGL_API SQLite3Pool
+    {
+    protected:
+        struct Internals;
+
+        Internals * internals; ///< connections and synchronization (see src/pool.cc)
+
+        void _release(std::size_t slot) noexcept;
+
+    public:
+        /// exclusive loan of a pooled connection, returned on destruction
+        class HGL_API Lease
+        {
+        protected:
+            SQLite3Pool * pool;
+            SQLite3     * conn;
+            std::size_t   slot;
+
+            Lease(SQLite3Pool * p, SQLite3 * c, std::size_t s): pool(p), conn(c), slot(s) { }
+
+            friend class SQLite3Pool;
+
+        public:
+            Lease(): pool(nullptr), conn(nullptr), slot(0) { }
+            Lease(Lease && other) noexcept:
+                pool(other.pool), conn(other.conn), slot(other.slot)
+                { other.pool = nullptr; other.conn = nullptr; }
+            Lease(const Lease &) = delete;
+            ~Lease() { release(); }
+
+            Lease & operator=(Lease && other) noexcept
+            {
+                if (this != &other)
+                {
+                    release();
+                    std::swap(pool, other.pool);
+                    std::swap(conn, other.conn);
+                    slot = other.slot;
+                }
+                return *this;
+            }
+
+            /**
+             * @brief check if a connection is held
+             */
+            operator bool () const noexcept { return conn != nullptr; }
+
+            SQLite3 & operator*() const noexcept { return *conn; }
+            SQLite3 * operator->() const noexcept { return conn; }
+
+            /**
+             * @brief give the connection back to the pool early
+             */
+            void release() noexcept
+                { if (pool != nullptr) { pool->_release(slot); pool = nullptr; conn = nullptr; } }
+        };
+
+        /**
+         * @brief open the pool
+         * 
+         * @param filename name of the database file (in-memory databases cannot be shared)
+         * @param readers number of read-only connections, at least 1
+         * @param thread_affinity let each thread prefer the same reader connection
+         * @throw std::invalid_argument if `readers` is 0
+         */
+        SQLite3Pool(const char * filename, std::size_t readers, bool thread_affinity = true);
+
+        SQLite3Pool(SQLite3Pool &&) = delete;
+        SQLite3Pool(const SQLite3Pool &) = delete;
+
+        /**
+         * @brief close all connections
+         * @note all leases must have been released
+         */
+        ~SQLite3Pool();
+
+        /**
+         * @brief borrow a read-only connection, waiting until one is free
+         */
+        Lease reader();
+
+        /**
+         * @brief borrow a read-only connection if one is free
+         * 
+         * @return the lease, empty if all readers are busy
+         */
+        Lease tryReader();
+
+        /**
+         * @brief borrow the writer connection, waiting until it is free
+         */
+        Lease writer();
+
+        /**
+         * @brief get number of read-only connections
+         */
+        std::size_t readerCount() const noexcept;
+    };
+
+} // namespace hgl
@@ -0,0 +1,251 @@
+/**
+ * @file sqlite3w_shard.h
+ * @brief SQLite3 databases sharded over several files
+ */
+
+#pragma once
+
+#include "sqlite3w.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <queue>
+
+namespace hgl
+{
+    /// shard connections and worker threads, see ShardedSQLite3
+    class HGL_API _ShardSet
+    {
+    protected:
+        struct Internals;
+
+        Internals * internals; ///< connections, locks and thread pool (see src/shard.cc)
+
+        /**
+         * @brief run `job(shard index, connection)` on every shard in parallel and wait
+         * @note rethrows the first exception thrown by a job
+         */
+        void _scatter(const std::function<void(std::size_t, SQLite3 &)> & job);
+
+        std::mutex & _lock(std::size_t shard) const noexcept;
+
+    public:
+        /**
+         * @brief open one database file per shard
+         * 
+         * @param filenames database files, one per shard
+         * @param threads worker threads for scatter-gather reads, 0 for one per shard
+         * @param opts open options for all shards
+         */
+        _ShardSet(const std::vector<std::string> & filenames, std::size_t threads,
+            const SQLite3::OpenOptions & opts);
+
+        _ShardSet(_ShardSet &&) = delete;
+        _ShardSet(const _ShardSet &) = delete;
+
+        ~_ShardSet();
+
+        /**
+         * @brief get number of shards
+         */
+        std::size_t shardCount() const noexcept;
+
+        /**
+         * @brief run `f(SQLite3 &)` on one shard, holding its lock
+         */
+        template <typename F> decltype(auto) withShard(std::size_t shard, F && f)
+        {
+            std::lock_guard<std::mutex> lock(this->_lock(shard));
+            return std::forward<F>(f)(this->shard(shard));
+        }
+
+        /**
+         * @brief get a shard connection
+         * @note not synchronized; prefer withShard() when other threads use the set
+         */
+        SQLite3 & shard(std::size_t shard) const noexcept;
+
+        /**
+         * @brief run a statement on every shard in parallel (e.g. schema changes)
+         */
+        void executeAll(const char * stmts);
+    };
+
+    /**
+     * @brief default key hash of ShardedSQLite3: FNV-1a, the same with every compiler and library
+     * 
+     * Integers and enumerations are hashed as the 8 little-endian bytes of
+     * their 64-bit value, strings as their bytes. Other key types need a
+     * Hash of their own.
+     */
+    template <typename Key> struct ShardHash
+    {
+        std::uint64_t operator()(const Key & key) const noexcept
+        {
+            if constexpr (std::is_integral_v<Key> || std::is_enum_v<Key>)
+            {
+                auto v = static_cast<std::uint64_t>(key);
+                std::uint64_t h = 0xcbf29ce484222325;
+                for (int i = 0; i < 8; i++, v >>= 8)
+                    h = (h ^ (v & 0xff)) * 0x100000001b3;
+                return h;
+            }
+            else
+            {
+                static_assert(std::is_convertible_v<const Key &, std::string_view>,
+                    "no stable hash for this key type: pass a Hash to ShardedSQLite3");
+                return SQLite3Stmt::Name::_hash(std::string_view(key));
+            }
+        }
+    };
+
+    /**
+     * @brief N database files behind one interface
+     * 
+     * Writes go to the shard chosen by hashing a key; each shard has its own
+     * lock, so writes to different shards run concurrently. Reads run on all
+     * shards in parallel and the rows are gathered, either concatenated or
+     * k-way merged on a column the per-shard query is ordered by.
+     * 
+     * @tparam Key routing key type
+     * @tparam Hash hash function object for Key; it decides which file a row
+     *         is stored in, so it must give the same values for as long as
+     *         the data lives (std::hash does not promise that across
+     *         standard libraries or versions)
+     */
+    template <typename Key, typename Hash = ShardHash<Key>>
+    class ShardedSQLite3: public _ShardSet
+    {
+    protected:
+        Hash hash;
+
+        template <typename ... Ts> static void _check_row_types()
+        {
+            static_assert(((!std::is_same<std::string_view, Ts>::value &&
+                !std::is_same<const char *, Ts>::value &&
+                !std::is_same<std::span<const std::byte>, Ts>::value) && ...),
+                "rows outlive their statement: use std::string instead of views");
+        }
+
+        template <typename ... Ts, typename ... Args>
+        std::vector<std::vector<std::tuple<Ts...>>> _gather(const char * sql, Args && ... args)
+        {
+            _check_row_types<Ts...>();
+            std::vector<std::vector<std::tuple<Ts...>>> parts(this->shardCount());
+            this->_scatter([&parts, sql, &args ...](std::size_t i, SQLite3 & db)
+            {
+                SQLite3Stmt stmt(db, sql);
+                if (stmt(args ...))
+                {
+                    for (auto && row: stmt.rows<Ts...>())
+                        parts[i].push_back(std::move(row));
+                }
+            });
+            return parts;
+        }
+
+    public:
+        /**
+         * @brief open the shards
+         * 
+         * @param filenames database files, one per shard; their order defines the routing
+         * @param threads worker threads for reads, 0 for one per shard
+         * @param opts open options for all shards
+         * @param hash key hash
+         */
+        ShardedSQLite3(const std::vector<std::string> & filenames, std::size_t threads,
+            const SQLite3::OpenOptions & opts, Hash hash = Hash()):
+            _ShardSet(filenames, threads, opts), hash(std::move(hash)) { }
+
+        explicit ShardedSQLite3(const std::vector<std::string> & filenames):
+            ShardedSQLite3(filenames, 0, SQLite3::OpenOptions()) { }
+
+        /**
+         * @brief get the shard a key belongs to
+         */
+        std::size_t shardOf(const Key & key) const
+            { return static_cast<std::size_t>(static_cast<std::uint64_t>(this->hash(key)) % this->shardCount()); }
+
+        /**
+         * @brief run `f(SQLite3 &)` on the shard owning `key`, holding its lock
+         */
+        template <typename F> decltype(auto) write(const Key & key, F && f)
+            { return this->withShard(this->shardOf(key), std::forward<F>(f)); }
+
+        /**
+         * @brief execute a statement with parameters on the shard owning `key`
+         */
+        template <typename ... Args> void execute(const Key & key, const char * sql, Args && ... args)
+        {
+            this->write(key, [&](SQLite3 & db)
+            {
+                SQLite3Stmt stmt(db, sql);
+                stmt(std::forward<Args>(args) ...);
+            });
+        }
+
+        /**
+         * @brief run a query on all shards in parallel and concatenate the rows (in shard order)
+         * 
+         * @tparam Ts column types (owning types such as std::string, not views)
+         */
+        template <typename ... Ts, typename ... Args>
+        std::vector<std::tuple<Ts...>> query(const char * sql, Args && ... args)
+        {
+            auto parts = this->_gather<Ts...>(sql, args ...);
+            std::size_t total = 0;
+            for (auto & p: parts)
+                total += p.size();
+
+            std::vector<std::tuple<Ts...>> rows;
+            rows.reserve(total);
+            for (auto & p: parts)
+                std::move(p.begin(), p.end(), std::back_inserter(rows));
+            return rows;
+        }
+
+        /**
+         * @brief run a query on all shards in parallel and k-way merge the rows
+         * 
+         * @tparam KeyCol index of the column each shard's result is ordered by (ascending)
+         * @tparam Ts column types (owning types such as std::string, not views)
+         */
+        template <std::size_t KeyCol, typename ... Ts, typename ... Args>
+        std::vector<std::tuple<Ts...>> queryMerged(const char * sql, Args && ... args)
+        {
+            auto parts = this->_gather<Ts...>(sql, args ...);
+
+            // heap of (shard, position), smallest key on top; ties keep shard order
+            using Head = std::pair<std::size_t, std::size_t>;
+            auto greater = [&parts](const Head & a, const Head & b)
+            {
+                const auto & ka = std::get<KeyCol>(parts[a.first][a.second]);
+                const auto & kb = std::get<KeyCol>(parts[b.first][b.second]);
+                return kb < ka || (!(ka < kb) && a.first > b.first);
+            };
+            std::priority_queue<Head, std::vector<Head>, decltype(greater)> heap(greater);
+
+            std::size_t total = 0;
+            for (std::size_t i = 0; i < parts.size(); i++)
+            {
+                total += parts[i].size();
+                if (!parts[i].empty())
+                    heap.emplace(i, 0);
+            }
+
+            std::vector<std::tuple<Ts...>> rows;
+            rows.reserve(total);
+            while (!heap.empty())
+            {
+                const auto [shard, pos] = heap.top();
+                heap.pop();
+                rows.push_back(std::move(parts[shard][pos]));
+                if (pos + 1 < parts[shard].size())
+                    heap.emplace(shard, pos + 1);
+            }
+            return rows;
+        }
+    };
+
+} // namespace hgl
@@ -0,0 +1,197 @@
+#include <sqlite3w_async.h>
+
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+
+using namespace hgl;
+
+struct SQLite3Async::Internals
+{
+    SQLite3              db;
+    Options              opts;
+    std::atomic<Job *>   head;     ///< Treiber stack of submitted jobs, newest first
+    std::atomic<bool>    stopping;
+    std::atomic<std::uint64_t> jobs, writes, commits;
+    std::thread          worker;
+
+    Internals(const char * filename, Options && o):
+        db(filename), opts(std::move(o)), head(nullptr), stopping(false),
+        jobs(0), writes(0), commits(0) { }
+
+    void loop();
+    Job * runGroup(Job * first);
+
+    /// value of `head` once the worker has stopped; never a real job
+    Job * closedMark() noexcept { return reinterpret_cast<Job *>(this); }
+};
+
+SQLite3Async::SQLite3Async(const char * filename, Options opts):
+    internals(new Internals(filename, std::move(opts)))
+{
+    if (this->internals->opts.max_group == 0)
+        this->internals->opts.max_group = 1;
+
+    try
+    {
+        this->internals->worker = std::thread(&Internals::loop, this->internals);
+    }
+    catch (...)
+    {
+        delete this->internals;
+        throw;
+    }
+}
+
+SQLite3Async::~SQLite3Async()
+{
+    // queued behind every job submitted so far, so those still run
+    this->submit([in = this->internals](SQLite3 &) { in->stopping.store(true, std::memory_order_relaxed); });
+    this->internals->worker.join();
+
+    // jobs that came in after the worker had stopped never run
+    auto late = this->internals->head.exchange(this->internals->closedMark(), std::memory_order_acquire);
+    while (late != nullptr)
+    {
+        auto next = late->next;
+        late->fail(std::make_exception_ptr(SQLite3Error(SQLITE_MISUSE, "SQLite3Async is shut down")));
+        delete late;
+        late = next;
+    }
+
+    delete this->internals;
+}
+
+void SQLite3Async::_push(Job * job) noexcept
+{
+    auto & head = this->internals->head;
+    auto old = head.load(std::memory_order_relaxed);
+    do
+    {
+        if (old == this->internals->closedMark())
+        {
+            job->fail(std::make_exception_ptr(SQLite3Error(SQLITE_MISUSE, "SQLite3Async is shut down")));
+            delete job;
+            return;
+        }
+        job->next = old;
+    }
+    while (!head.compare_exchange_weak(old, job, std::memory_order_release, std::memory_order_relaxed));
+
+    if (old == nullptr)
+        head.notify_one();
+}
+
+const std::function<void(std::coroutine_handle<>)> * SQLite3Async::_resumer() const noexcept
+{
+    return &this->internals->opts.resume;
+}
+
+SQLite3Async::Stats SQLite3Async::getStats() const noexcept
+{
+    const auto & in = *this->internals;
+    return Stats{
+        in.jobs.load(std::memory_order_relaxed),
+        in.writes.load(std::memory_order_relaxed),
+        in.commits.load(std::memory_order_relaxed),
+    };
+}
+
+void SQLite3Async::Internals::loop()
+{
+    for (;;)
+    {
+        auto list = this->head.exchange(nullptr, std::memory_order_acquire);
+        if (list == nullptr)
+        {
+            if (this->stopping.load(std::memory_order_relaxed))
+                break;
+            this->head.wait(nullptr, std::memory_order_acquire);
+            continue;
+        }
+
+        // the stack holds the newest job first; restore submission order
+        Job * fifo = nullptr;
+        while (list != nullptr)
+        {
+            auto next = list->next;
+            list->next = fifo;
+            fifo = list;
+            list = next;
+        }
+
+        while (fifo != nullptr)
+        {
+            if (fifo->write)
+            {
+                fifo = this->runGroup(fifo);
+                continue;
+            }
+
+            auto job = fifo;
+            fifo = job->next;
+            try
+            {
+                job->run(this->db);
+                job->finish();
+            }
+            catch (...)
+            {
+                job->fail(std::current_exception());
+            }
+            delete job;
+            this->jobs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+SQLite3Async::Job * SQLite3Async::Internals::runGroup(Job * first)
+{
+    std::vector<std::pair<Job *, std::exception_ptr>> group;
+    auto job = first;
+    while (job != nullptr && job->write && group.size() < this->opts.max_group)
+    {
+        group.emplace_back(job, nullptr);
+        job = job->next;
+    }
+
+    std::exception_ptr group_error;
+    try
+    {
+        SQLite3::Transaction txn(this->db, SQLite3::TransactionMode::Immediate);
+        for (auto & [j, error]: group)
+        {
+            try
+            {
+                SQLite3::Savepoint sp(this->db);
+                j->run(this->db);
+                sp.commit();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+        txn.commit();
+        this->commits.fetch_add(1, std::memory_order_relaxed);
+    }
+    catch (...)
+    {
+        group_error = std::current_exception();
+    }
+
+    for (auto & [j, error]: group)
+    {
+        if (group_error)
+            j->fail(group_error);
+        else if (error)
+            j->fail(std::move(error));
+        else
+            j->finish();
+        delete j;
+    }
+
+    this->jobs.fetch_add(group.size(), std::memory_order_relaxed);
+    this->writes.fetch_add(group.size(), std::memory_order_relaxed);
+    return job;
+}
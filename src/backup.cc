@@ -0,0 +1,96 @@
+#include "internal.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace hgl;
+
+SQLite3::BackupStats SQLite3::backup(SQLite3 & to, const SQLite3 & from, const BackupOptions & opts)
+{
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+
+    auto dst = reinterpret_cast<sqlite3*>(to.handle);
+    auto bak = sqlite3_backup_init(dst, opts.to_schema,
+        reinterpret_cast<sqlite3*>(from.handle), opts.from_schema);
+    if (bak == nullptr)
+        throw SQLite3Error(to);
+
+    BackupStats stats{false, 0, 0, 0.0};
+    const auto step_pages = opts.pages_per_step == 0 ? -1 : opts.pages_per_step;
+    auto locked_since = clock::time_point();
+    int res;
+
+    for (;;)
+    {
+        res = to.internals->busy.settle(sqlite3_backup_step(bak, step_pages));
+        stats.steps++;
+
+        if (res == SQLITE_DONE)
+        {
+            stats.complete = true;
+            break;
+        }
+
+        if (res == SQLITE_BUSY || res == SQLITE_LOCKED)
+        {
+            const auto now = clock::now();
+            if (locked_since == clock::time_point())
+                locked_since = now;
+            else if (now - locked_since > opts.busy_timeout)
+                break;
+            std::this_thread::sleep_for(std::max(opts.pause, std::chrono::milliseconds(1)));
+            continue;
+        }
+        if (res != SQLITE_OK)
+            break;
+        locked_since = clock::time_point();
+
+        if (opts.progress)
+        {
+            bool go_on;
+            try
+            {
+                go_on = opts.progress(sqlite3_backup_remaining(bak), sqlite3_backup_pagecount(bak));
+            }
+            catch (...)
+            {
+                sqlite3_backup_finish(bak);
+                to.internals->query_cache.clear();
+                throw;
+            }
+            if (!go_on)
+                break;
+        }
+
+        // let other connections at the databases between steps
+        if (opts.pause.count() > 0)
+            std::this_thread::sleep_for(opts.pause);
+        else
+            std::this_thread::yield();
+    }
+
+    stats.pages = static_cast<std::uint64_t>(sqlite3_backup_pagecount(bak));
+    sqlite3_backup_finish(bak);
+    // pages are copied under the update hook
+    to.internals->query_cache.clear();
+    stats.seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    if (res != SQLITE_DONE && res != SQLITE_OK)
+        throw SQLite3Error(res);
+    return stats;
+}
+
+SQLite3::BackupStats SQLite3::loadFrom(const char * filename, const BackupOptions & opts)
+{
+    OpenOptions open_opts;
+    open_opts.flags = OpenOptions::ReadOnly;
+    const SQLite3 src(filename, open_opts);
+    return backup(*this, src, opts);
+}
+
+SQLite3::BackupStats SQLite3::saveTo(const char * filename, const BackupOptions & opts) const
+{
+    SQLite3 dst(filename);
+    return backup(dst, *this, opts);
+}
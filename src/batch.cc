@@ -0,0 +1,228 @@
+#include "internal.h"
+
+#include <cstring>
+
+using namespace hgl;
+
+using Column = SQLite3Stmt::ColumnBatch::Column;
+
+void SQLite3Stmt::ColumnBatch::clear() noexcept
+{
+    for (auto & c: this->columns)
+    {
+        c.ints.clear();
+        c.floats.clear();
+        c.arena.clear();
+        c.offsets.clear();
+        c.nulls.clear();
+    }
+    this->rows = 0;
+}
+
+static SQLite3Stmt::Type _value_storage(int type) noexcept
+{
+    switch (type)
+    {
+    case SQLITE_INTEGER: return SQLite3Stmt::Type::Integer;
+    case SQLITE_FLOAT:   return SQLite3Stmt::Type::Float;
+    case SQLITE_BLOB:    return SQLite3Stmt::Type::Blob;
+    case SQLITE_TEXT:    return SQLite3Stmt::Type::Text;
+    default:             return SQLite3Stmt::Type::Null;
+    }
+}
+
+static SQLite3Stmt::Type _column_storage(sqlite3_stmt * stmt, int col)
+{
+    if (const auto t = _value_storage(sqlite3_column_type(stmt, col)); t != SQLite3Stmt::Type::Null)
+        return t;
+
+    // NULL: fall back to the affinity of the declared type
+    std::string_view decl;
+    if (auto const t = sqlite3_column_decltype(stmt, col); t != nullptr)
+        decl = t;
+
+    auto has = [decl](const char * s)
+    {
+        for (std::size_t i = 0; i + std::strlen(s) <= decl.size(); i++)
+        {
+            if (sqlite3_strnicmp(decl.data() + i, s, std::strlen(s)) == 0)
+                return true;
+        }
+        return false;
+    };
+
+    if (has("INT"))
+        return SQLite3Stmt::Type::Integer;
+    if (has("CHAR") || has("CLOB") || has("TEXT"))
+        return SQLite3Stmt::Type::Text;
+    if (has("BLOB"))
+        return SQLite3Stmt::Type::Blob;
+    if (has("REAL") || has("FLOA") || has("DOUB"))
+        return SQLite3Stmt::Type::Float;
+    return SQLite3Stmt::Type::Text;
+}
+
+static void _reserve(Column & c, std::size_t n)
+{
+    switch (c.type)
+    {
+    case SQLite3Stmt::Type::Integer: c.ints.reserve(n); break;
+    case SQLite3Stmt::Type::Float:   c.floats.reserve(n); break;
+    default:                         c.offsets.reserve(n + 1); break;
+    }
+    c.nulls.reserve((n + 63) / 64);
+}
+
+static bool _numeric(SQLite3Stmt::Type t) noexcept
+{
+    return t == SQLite3Stmt::Type::Integer || t == SQLite3Stmt::Type::Float;
+}
+
+/// whether the first `rows` values of `c` are all NULL
+static bool _all_null(const Column & c, std::size_t rows) noexcept
+{
+    for (std::size_t i = 0; i < rows / 64; i++)
+    {
+        if (c.nulls[i] != ~std::uint64_t(0))
+            return false;
+    }
+    const auto mask = (std::uint64_t(1) << (rows % 64)) - 1;
+    return rows % 64 == 0 || (c.nulls[rows / 64] & mask) == mask;
+}
+
+/// change the type of a column holding `rows` values, converting Integer to Float or NULLs to anything
+static void _retype(Column & c, SQLite3Stmt::Type t, std::size_t rows)
+{
+    if (c.type == SQLite3Stmt::Type::Integer && t == SQLite3Stmt::Type::Float)
+        c.floats.assign(c.ints.begin(), c.ints.end());
+    else if (t == SQLite3Stmt::Type::Integer)
+        c.ints.assign(rows, 0);
+    else if (t == SQLite3Stmt::Type::Float)
+        c.floats.assign(rows, 0.0);
+    else
+        c.offsets.assign(rows + 1, 0);
+
+    if (t != SQLite3Stmt::Type::Integer)
+        c.ints.clear();
+    if (t != SQLite3Stmt::Type::Float)
+        c.floats.clear();
+    if (_numeric(t))
+        c.offsets.clear();
+    c.arena.clear();
+    c.type = t;
+}
+
+static void _append(Column & c, sqlite3_stmt * stmt, int col, std::size_t row, bool exact)
+{
+    if (row % 64 == 0)
+        c.nulls.push_back(0);
+
+    const auto storage = _value_storage(sqlite3_column_type(stmt, col));
+    const bool is_null = storage == SQLite3Stmt::Type::Null;
+    if (is_null)
+        c.nulls.back() |= std::uint64_t(1) << (row % 64);
+    else if (exact && storage != c.type && !(storage == SQLite3Stmt::Type::Integer && c.type == SQLite3Stmt::Type::Float))
+    {
+        if (c.type == SQLite3Stmt::Type::Integer && storage == SQLite3Stmt::Type::Float)
+            _retype(c, storage, row);
+        else if (_all_null(c, row))
+            _retype(c, storage, row);
+        else if (_numeric(storage) || _numeric(c.type)) // text and blobs keep their bytes either way
+        {
+            const char * name = sqlite3_column_name(stmt, col);
+            throw SQLite3Error(SQLITE_MISMATCH, ("column \"" + std::string(name == nullptr ? "" : name) +
+                "\" holds values of different storage classes").c_str());
+        }
+    }
+
+    switch (c.type)
+    {
+    case SQLite3Stmt::Type::Integer:
+        c.ints.push_back(is_null ? 0 : sqlite3_column_int64(stmt, col));
+        break;
+
+    case SQLite3Stmt::Type::Float:
+        c.floats.push_back(is_null ? 0.0 : sqlite3_column_double(stmt, col));
+        break;
+
+    default:
+        if (c.offsets.empty())
+            c.offsets.push_back(0);
+        if (!is_null)
+        {
+            auto const p = static_cast<const char *>(c.type == SQLite3Stmt::Type::Blob ?
+                sqlite3_column_blob(stmt, col) :
+                static_cast<const void *>(sqlite3_column_text(stmt, col)));
+            auto const n = sqlite3_column_bytes(stmt, col);
+            if (p != nullptr)
+                c.arena.insert(c.arena.end(), p, p + n);
+        }
+        c.offsets.push_back(c.arena.size());
+        break;
+    }
+}
+
+std::size_t SQLite3Stmt::fetchBatch(ColumnBatch & batch, std::size_t n)
+{
+    return this->_fetch_batch(batch, n, false);
+}
+
+std::size_t SQLite3Stmt::_fetch_batch(ColumnBatch & batch, std::size_t n, bool exact)
+{
+    batch.clear();
+    if (n == 0 || !this->_has_row())
+        return 0;
+
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    const int col_num = sqlite3_column_count(stmt);
+
+    if (batch.columns.size() != static_cast<std::size_t>(col_num))
+        batch.columns.resize(col_num);
+
+    for (int col = 0; col < col_num; col++)
+    {
+        auto & c = batch.columns[col];
+        if (c.type == Type::Unknown || c.type == Type::Null)
+        {
+            c.type = _column_storage(stmt, col);
+            c.inferred = true;
+        }
+        _reserve(c, n);
+    }
+
+    while (batch.rows < n)
+    {
+        try
+        {
+            for (int col = 0; col < col_num; col++)
+            {
+                auto & c = batch.columns[col];
+                _append(c, stmt, col, batch.rows, exact || c.inferred);
+            }
+        }
+        catch (...)
+        {
+            // the columns before the failing one hold a value more than the others
+            batch.clear();
+            throw;
+        }
+        batch.rows++;
+
+        if (!this->_step())
+        {
+            this->reset();
+            break;
+        }
+    }
+
+    return batch.rows;
+}
+
+const SQLite3Stmt::ColumnBatch & SQLite3Stmt::fetchBatch(std::size_t n)
+{
+    if (this->internals == nullptr)
+        this->internals = new Internals;
+
+    this->fetchBatch(this->internals->batch, n);
+    return this->internals->batch;
+}
@@ -0,0 +1,105 @@
+#include "internal.h"
+
+#include <algorithm>
+
+using namespace hgl;
+
+SQLite3::BlobStream::BlobStream(const SQLite3 & db, const char * table, const char * column,
+    std::int64_t rowid, bool writable, const char * schema):
+    db(&db), handle(nullptr), length(0), position(0)
+{
+    sqlite3_blob * blob;
+    if (db.internals->busy.settle(sqlite3_blob_open(reinterpret_cast<sqlite3*>(db.handle),
+            schema, table, column, rowid, writable ? 1 : 0, &blob)) != SQLITE_OK)
+        throw SQLite3Error(db);
+
+    this->handle = blob;
+    this->length = sqlite3_blob_bytes(blob);
+}
+
+SQLite3::BlobStream::BlobStream(BlobStream && other) noexcept:
+    db(other.db), handle(other.handle), length(other.length), position(other.position)
+{
+    other.handle = nullptr;
+    other.length = 0;
+    other.position = 0;
+}
+
+SQLite3::BlobStream::~BlobStream()
+{
+    this->close();
+}
+
+SQLite3::BlobStream & SQLite3::BlobStream::operator=(BlobStream && other) noexcept
+{
+    if (this != &other)
+    {
+        this->close();
+        std::swap(this->db, other.db);
+        std::swap(this->handle, other.handle);
+        std::swap(this->length, other.length);
+        std::swap(this->position, other.position);
+    }
+    return *this;
+}
+
+void SQLite3::BlobStream::seek(std::size_t pos)
+{
+    if (pos > this->length)
+        throw std::out_of_range("BlobStream::seek(): offset past the end");
+    this->position = pos;
+}
+
+std::size_t SQLite3::BlobStream::read(std::span<std::byte> buf)
+{
+    const auto n = std::min(buf.size(), this->length - this->position);
+    if (n == 0)
+        return 0;
+
+    if (sqlite3_blob_read(reinterpret_cast<sqlite3_blob*>(this->handle),
+            buf.data(), static_cast<int>(n), static_cast<int>(this->position)) != SQLITE_OK)
+        throw SQLite3Error(*this->db);
+
+    this->position += n;
+    return n;
+}
+
+void SQLite3::BlobStream::write(std::span<const std::byte> data)
+{
+    if (data.size() > this->length - this->position)
+        throw SQLite3Error(SQLITE_RANGE, "BlobStream::write(): cannot grow the value");
+    if (data.empty())
+        return;
+
+    if (sqlite3_blob_write(reinterpret_cast<sqlite3_blob*>(this->handle),
+            data.data(), static_cast<int>(data.size()), static_cast<int>(this->position)) != SQLITE_OK)
+        throw SQLite3Error(*this->db);
+    // incremental writes do not call the update hook
+    this->db->internals->query_cache.clear();
+
+    this->position += data.size();
+}
+
+void SQLite3::BlobStream::reopen(std::int64_t rowid)
+{
+    this->position = 0;
+    if (this->db->internals->busy.settle(
+            sqlite3_blob_reopen(reinterpret_cast<sqlite3_blob*>(this->handle), rowid)) != SQLITE_OK)
+    {
+        // the handle is aborted now; only closing it is still valid
+        this->length = 0;
+        throw SQLite3Error(*this->db);
+    }
+    this->length = sqlite3_blob_bytes(reinterpret_cast<sqlite3_blob*>(this->handle));
+}
+
+void SQLite3::BlobStream::close() noexcept
+{
+    if (this->handle == nullptr)
+        return;
+
+    sqlite3_blob_close(reinterpret_cast<sqlite3_blob*>(this->handle));
+    this->handle = nullptr;
+    this->length = 0;
+    this->position = 0;
+}
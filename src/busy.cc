@@ -0,0 +1,190 @@
+#include "internal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+
+using namespace hgl;
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using clock_type = std::chrono::steady_clock;
+
+BusyHandler::BusyHandler() noexcept:
+    policy(SQLite3::BusyPolicy::backoff(milliseconds(1), milliseconds(250), milliseconds(4000))),
+    events(0), retries(0), failures(0), wait_us(0), waiting_since_us(-1), waited_until_us(-1)
+{
+    for (auto & h: this->histogram)
+        h.store(0, std::memory_order_relaxed);
+}
+
+void BusyHandler::install(sqlite3 * db) noexcept
+{
+    if (this->policy.mode == SQLite3::BusyPolicy::Mode::Timeout)
+        sqlite3_busy_handler(db, &BusyHandler::onBusy, this);
+    else
+        sqlite3_busy_handler(db, nullptr, nullptr);
+}
+
+void BusyHandler::setPolicy(sqlite3 * db, const SQLite3::BusyPolicy & p) noexcept
+{
+    this->policy = p;
+    if (this->policy.min_delay < milliseconds(1))
+        this->policy.min_delay = milliseconds(1);
+    if (this->policy.max_delay < this->policy.min_delay)
+        this->policy.max_delay = this->policy.min_delay;
+
+    if (db != nullptr)
+        this->install(db);
+}
+
+void BusyHandler::record(std::uint64_t waited_us, bool failed) noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    this->events.fetch_add(1, relaxed);
+    this->wait_us.fetch_add(waited_us, relaxed);
+    if (failed)
+        this->failures.fetch_add(1, relaxed);
+
+    std::size_t bucket = 0;
+    for (auto ms = waited_us / 1000; ms != 0 && bucket + 1 < SQLite3::BusyStats::buckets; ms >>= 1)
+        bucket++;
+    this->histogram[bucket].fetch_add(1, relaxed);
+}
+
+static std::int64_t _now_us() noexcept
+{
+    return std::chrono::duration_cast<microseconds>(
+        clock_type::now().time_since_epoch()).count();
+}
+
+int BusyHandler::onBusy(void * handler, int count) noexcept
+{
+    auto & self = *static_cast<BusyHandler *>(handler);
+    const auto now_us = _now_us();
+    if (count == 0 || self.waiting_since_us < 0)
+    {
+        // a new episode: the previous one, if nobody settled it, got its lock
+        if (self.waiting_since_us >= 0)
+            self.finishWait(false);
+        self.waiting_since_us = self.waited_until_us = now_us;
+    }
+
+    const auto left_us = self.waiting_since_us +
+        std::chrono::duration_cast<microseconds>(self.policy.deadline).count() - now_us;
+    if (left_us <= 0)
+    {
+        self.waited_until_us = now_us;
+        self.finishWait(true);
+        return 0;
+    }
+
+    // fixed steps: SQLite retries the lock itself, so there is no retry storm to spread out
+    std::this_thread::sleep_for(microseconds(std::min<std::int64_t>(left_us,
+        std::chrono::duration_cast<microseconds>(self.policy.min_delay).count())));
+    self.waited_until_us = _now_us();
+    self.retries.fetch_add(1, std::memory_order_relaxed);
+    return 1;
+}
+
+void BusyHandler::finishWait(bool failed) noexcept
+{
+    this->record(static_cast<std::uint64_t>(this->waited_until_us - this->waiting_since_us), failed);
+    this->waiting_since_us = -1;
+}
+
+BusyHandler::Episode::Episode(BusyHandler & h) noexcept:
+    handler(h), start_us(_now_us()),
+    delay_us(std::chrono::duration_cast<microseconds>(h.policy.min_delay).count())
+{
+}
+
+bool BusyHandler::Episode::sleep() noexcept
+{
+    auto const & policy = this->handler.policy;
+    if (policy.mode != SQLite3::BusyPolicy::Mode::Backoff)
+        return false;
+
+    thread_local std::minstd_rand rng(static_cast<unsigned int>(
+        std::hash<std::thread::id>()(std::this_thread::get_id())));
+
+    const auto deadline_us = this->start_us +
+        std::chrono::duration_cast<microseconds>(policy.deadline).count();
+    const auto now_us = _now_us();
+    if (now_us >= deadline_us)
+        return false;
+
+    // "equal jitter": sleep somewhere in [delay/2, delay]
+    const auto half = this->delay_us / 2;
+    auto sleep_us = half + std::uniform_int_distribution<std::int64_t>(0, this->delay_us - half)(rng);
+    sleep_us = std::min(sleep_us, deadline_us - now_us);
+
+    std::this_thread::sleep_for(microseconds(sleep_us));
+    this->handler.retries.fetch_add(1, std::memory_order_relaxed);
+
+    this->delay_us = std::min<std::int64_t>(this->delay_us * 2,
+        std::chrono::duration_cast<microseconds>(policy.max_delay).count());
+    return true;
+}
+
+void BusyHandler::Episode::finish(bool failed) noexcept
+{
+    this->handler.record(static_cast<std::uint64_t>(_now_us() - this->start_us), failed);
+}
+
+int BusyHandler::exec(sqlite3 * db, const char * sql) noexcept
+{
+    auto run = [db, sql] { return sqlite3_exec(db, sql, nullptr, nullptr, nullptr); };
+    const auto res = run();
+    return this->settle(res == SQLITE_BUSY ? this->retry(run) : res);
+}
+
+SQLite3::BusyStats BusyHandler::stats() const noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    SQLite3::BusyStats s;
+    s.events = this->events.load(relaxed);
+    s.retries = this->retries.load(relaxed);
+    s.failures = this->failures.load(relaxed);
+    s.wait_us = this->wait_us.load(relaxed);
+    for (std::size_t i = 0; i < SQLite3::BusyStats::buckets; i++)
+        s.histogram[i] = this->histogram[i].load(relaxed);
+    return s;
+}
+
+void BusyHandler::reset() noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    this->events.store(0, relaxed);
+    this->retries.store(0, relaxed);
+    this->failures.store(0, relaxed);
+    this->wait_us.store(0, relaxed);
+    for (auto & h: this->histogram)
+        h.store(0, relaxed);
+}
+
+
+void SQLite3::setBusyPolicy(const BusyPolicy & policy) noexcept
+{
+    this->internals->busy.setPolicy(reinterpret_cast<sqlite3*>(this->handle), policy);
+}
+
+SQLite3::BusyPolicy SQLite3::getBusyPolicy() const noexcept
+{
+    return this->internals->busy.getPolicy();
+}
+
+SQLite3::BusyStats SQLite3::getBusyStats() const noexcept
+{
+    return this->internals->busy.stats();
+}
+
+void SQLite3::resetBusyStats() noexcept
+{
+    this->internals->busy.reset();
+}
@@ -0,0 +1,330 @@
+#include "internal.h"
+
+#include <bit>
+#include <cstring>
+
+using namespace hgl;
+
+ChangeStream::ChangeStream(std::size_t capacity):
+    head(0), tail(0), epoch(0), published_count(0), dropped_count(0), is_closed(false)
+{
+    capacity = std::bit_ceil(capacity < 2 ? std::size_t(2) : capacity);
+    this->cells = new Cell[capacity];
+    this->mask = capacity - 1;
+    for (std::size_t i = 0; i < capacity; i++)
+        this->cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+ChangeStream::~ChangeStream()
+{
+    delete[] this->cells;
+}
+
+bool ChangeStream::_push(const ChangeEvent & ev) noexcept
+{
+    auto pos = this->head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        auto & cell = this->cells[pos & this->mask];
+        const auto seq = cell.seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::int64_t>(seq - pos);
+        if (diff == 0)
+        {
+            if (this->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.event = ev;
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = this->head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::size_t ChangeStream::drain(std::span<ChangeEvent> out) noexcept
+{
+    std::size_t n = 0;
+    auto pos = this->tail.load(std::memory_order_relaxed);
+    while (n < out.size())
+    {
+        auto & cell = this->cells[pos & this->mask];
+        const auto seq = cell.seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::int64_t>(seq - (pos + 1));
+        if (diff == 0)
+        {
+            if (this->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                out[n++] = cell.event;
+                cell.seq.store(pos + this->mask + 1, std::memory_order_release);
+                pos++;
+            }
+        }
+        else if (diff < 0)
+        {
+            break; // empty
+        }
+        else
+        {
+            pos = this->tail.load(std::memory_order_relaxed);
+        }
+    }
+    return n;
+}
+
+void ChangeStream::_publish(const ChangeEvent * events, std::size_t n) noexcept
+{
+    std::uint64_t pushed = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if (this->_push(events[i]))
+            pushed++;
+    }
+
+    this->published_count.fetch_add(pushed, std::memory_order_relaxed);
+    if (pushed != n)
+        this->dropped_count.fetch_add(n - pushed, std::memory_order_relaxed);
+
+    this->epoch.fetch_add(1, std::memory_order_release);
+    this->epoch.notify_all();
+}
+
+bool ChangeStream::wait() const noexcept
+{
+    for (;;)
+    {
+        const auto e = this->epoch.load(std::memory_order_acquire);
+        if (this->head.load(std::memory_order_acquire) != this->tail.load(std::memory_order_acquire))
+            return true;
+        if (this->closed())
+            return false;
+        this->epoch.wait(e, std::memory_order_acquire);
+    }
+}
+
+const char * ChangeStream::_intern(const char * table)
+{
+    // few distinct tables: a linear scan beats hashing, and only new names allocate
+    for (const auto & name: this->tables)
+    {
+        if (std::strcmp(name.c_str(), table) == 0)
+            return name.c_str();
+    }
+    return this->tables.emplace_back(table).c_str();
+}
+
+void ChangeStream::_close() noexcept
+{
+    this->is_closed.store(true, std::memory_order_release);
+    this->epoch.fetch_add(1, std::memory_order_release);
+    this->epoch.notify_all();
+}
+
+
+void ChangeLog::record(int op, const char * table, sqlite3_int64 rowid) noexcept
+{
+    if (this->stream == nullptr)
+        return;
+
+    ChangeEvent ev;
+    ev.op = op == SQLITE_INSERT ? ChangeEvent::Op::Insert :
+        op == SQLITE_DELETE ? ChangeEvent::Op::Delete : ChangeEvent::Op::Update;
+    ev.rowid = rowid;
+
+    try
+    {
+        ev.table = this->stream->_intern(table);
+        this->pending.push_back(ev);
+    }
+    catch (...)
+    {
+        this->stream->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ChangeLog::stepFailed(sqlite3 * db, const StepMark & m) noexcept
+{
+    if (sqlite3_total_changes64(db) == m.total_changes && m.pending < this->pending.size())
+        this->pending.resize(m.pending);
+}
+
+void ChangeLog::publish(sqlite3 * db, int res) noexcept
+{
+    this->committing = false;
+    if (!sqlite3_get_autocommit(db))
+        return; // the commit failed and the transaction is still open: wait for ROLLBACK or another COMMIT
+
+    if ((res == SQLITE_OK || res == SQLITE_DONE) && this->stream != nullptr && !this->pending.empty())
+        this->stream->_publish(this->pending.data(), this->pending.size());
+    this->pending.clear(); // keeps its capacity
+    this->marks.clear();
+}
+
+int ChangeLog::onCommit(void * ctx)
+{
+    auto self = static_cast<ChangeLog *>(ctx);
+    self->committing = !self->pending.empty();
+    return 0;
+}
+
+void ChangeLog::onRollback(void * ctx)
+{
+    auto self = static_cast<ChangeLog *>(ctx);
+    self->pending.clear();
+    self->marks.clear();
+    self->committing = false;
+}
+
+std::shared_ptr<ChangeStream> ChangeLog::watch(std::size_t capacity)
+{
+    if (this->stream == nullptr)
+        this->stream = std::make_shared<ChangeStream>(capacity);
+    return this->stream;
+}
+
+void ChangeLog::unwatch(sqlite3 * db) noexcept
+{
+    if (this->stream == nullptr)
+        return;
+
+    this->stream->_close();
+    this->stream.reset();
+    this->pending.clear();
+    this->marks.clear();
+    this->savepoint_stmts.clear();
+    this->authorized.reset();
+    this->listening = false;
+    this->committing = false;
+    this->install(db);
+}
+
+void ChangeLog::install(sqlite3 * db) noexcept
+{
+    if (db == nullptr)
+        return;
+
+    const bool on = this->stream != nullptr;
+    sqlite3_commit_hook(db, on ? &ChangeLog::onCommit : nullptr, this);
+    sqlite3_rollback_hook(db, on ? &ChangeLog::onRollback : nullptr, this);
+}
+
+void ChangeLog::savepoint(SavepointOp op, const char * name) noexcept
+{
+    if (this->stream == nullptr)
+        return;
+
+    if (op == SavepointOp::Begin)
+    {
+        try
+        {
+            this->marks.emplace_back(name, this->pending.size());
+        }
+        catch (...)
+        {
+            this->marks.clear();
+        }
+        return;
+    }
+
+    // names are case-insensitive and may repeat: the innermost one counts
+    auto it = this->marks.end();
+    for (auto i = this->marks.begin(); i != this->marks.end(); ++i)
+    {
+        if (sqlite3_stricmp(i->first.c_str(), name) == 0)
+            it = i;
+    }
+    if (it == this->marks.end())
+        return; // not tracked, e.g. begun before watchChanges()
+
+    if (op == SavepointOp::Rollback)
+    {
+        // ROLLBACK TO keeps the savepoint open
+        if (it->second < this->pending.size())
+            this->pending.resize(it->second);
+        ++it;
+    }
+    this->marks.erase(it, this->marks.end());
+}
+
+void ChangeLog::authorize(int action, const char * arg1, const char * arg2) noexcept
+{
+    if (action != SQLITE_SAVEPOINT || !this->listening || arg1 == nullptr || arg2 == nullptr)
+        return;
+
+    const auto op =
+        std::strcmp(arg1, "BEGIN") == 0 ? SavepointOp::Begin :
+        std::strcmp(arg1, "RELEASE") == 0 ? SavepointOp::Release : SavepointOp::Rollback;
+    try
+    {
+        this->authorized = SavepointStmt{nullptr, op, arg2};
+    }
+    catch (...)
+    {
+        this->authorized.reset();
+    }
+}
+
+void ChangeLog::prepared(sqlite3_stmt * stmt) noexcept
+{
+    this->listening = false;
+    if (stmt != nullptr && !this->savepoint_stmts.empty())
+        this->forget(stmt); // a finalized statement's address reused
+    if (!this->authorized)
+        return;
+
+    if (stmt != nullptr)
+    {
+        this->authorized->stmt = stmt;
+        try
+        {
+            this->savepoint_stmts.push_back(std::move(*this->authorized));
+        }
+        catch (...)
+        {
+        }
+    }
+    this->authorized.reset();
+}
+
+void ChangeLog::stepped(sqlite3_stmt * stmt, int res) noexcept
+{
+    if (this->authorized)
+        this->prepared(stmt); // re-prepared by the step
+    this->listening = false;
+
+    if (res != SQLITE_DONE)
+        return;
+    for (const auto & s: this->savepoint_stmts)
+    {
+        if (s.stmt == stmt)
+        {
+            this->savepoint(s.op, s.name.c_str());
+            return;
+        }
+    }
+}
+
+void ChangeLog::forget(sqlite3_stmt * stmt) noexcept
+{
+    std::erase_if(this->savepoint_stmts, [stmt](const SavepointStmt & s) { return s.stmt == stmt; });
+}
+
+
+std::shared_ptr<ChangeStream> SQLite3::watchChanges(std::size_t capacity)
+{
+    auto stream = this->internals->changes.watch(capacity);
+    this->internals->installHooks(reinterpret_cast<sqlite3*>(this->handle));
+    return stream;
+}
+
+void SQLite3::unwatchChanges() noexcept
+{
+    this->internals->changes.unwatch(reinterpret_cast<sqlite3*>(this->handle));
+    this->internals->installHooks(reinterpret_cast<sqlite3*>(this->handle));
+}
@@ -0,0 +1,501 @@
+#include "internal.h"
+
+#include <sqlite3w_columnar.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+using namespace hgl;
+
+// File layout, all integers 64-bit in the writer's byte order, all
+// sections 8-byte aligned:
+//
+//   header   magic[8], byte order mark (u32), version (u32)
+//   groups   per column: null bitmap words, then values or offsets + heap
+//   footer   column count, group count, row count;
+//            per column: type (Unknown if the groups differ), name length, name (padded);
+//            per group: rows, per column: type, nulls, data, heap, heap size
+//   trailer  footer position, magic[8]
+
+static constexpr char          _magic[8] = {'H', 'G', 'L', 'C', 'O', 'L', '\0', '\0'}; // versioned by _version
+static constexpr std::uint32_t _bom = 0x01020304;
+static constexpr std::uint32_t _version = 2;
+static constexpr std::size_t   _header_size = 16, _trailer_size = 16;
+
+namespace
+{
+    /// sequential file writer tracking the position
+    class _Output
+    {
+    private:
+        std::FILE   * file;
+        std::string   name;
+        std::uint64_t pos;
+
+    public:
+        explicit _Output(std::string filename): file(nullptr), name(std::move(filename)), pos(0)
+        {
+            this->file = std::fopen(this->name.c_str(), "wb");
+            if (this->file == nullptr)
+                throw std::system_error(errno, std::generic_category(), this->name);
+        }
+
+        _Output(const _Output &) = delete;
+
+        ~_Output()
+        {
+            if (this->file != nullptr)
+            {
+                std::fclose(this->file);
+                std::remove(this->name.c_str());
+            }
+        }
+
+        std::uint64_t tell() const noexcept { return pos; }
+
+        void put(const void * p, std::size_t n)
+        {
+            if (n != 0 && std::fwrite(p, 1, n, this->file) != n)
+                throw std::system_error(errno, std::generic_category(), this->name);
+            this->pos += n;
+        }
+
+        void put64(std::uint64_t v) { this->put(&v, sizeof v); }
+
+        void align()
+        {
+            static const char zeros[8] = {};
+            this->put(zeros, (8 - this->pos % 8) % 8);
+        }
+
+        /// close and move over `target`
+        void commit(const char * target)
+        {
+            const auto f = this->file;
+            this->file = nullptr;
+            if (std::fclose(f) != 0)
+            {
+                const int err = errno;
+                std::remove(this->name.c_str());
+                throw std::system_error(err, std::generic_category(), this->name);
+            }
+#ifdef _WIN32
+            std::remove(target); // rename() does not replace on Windows
+#endif
+            if (std::rename(this->name.c_str(), target) != 0)
+            {
+                const int err = errno;
+                std::remove(this->name.c_str());
+                throw std::system_error(err, std::generic_category(), target);
+            }
+        }
+    };
+}
+
+ColumnarFile::WriteStats ColumnarFile::write(SQLite3Stmt & stmt, const char * filename, const WriteOptions & opts)
+{
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    const std::size_t group_rows = opts.group_rows == 0 ? 1 : opts.group_rows;
+
+    _Output out(std::string(filename) + ".tmp");
+    out.put(_magic, sizeof _magic);
+    out.put(&_bom, sizeof _bom);
+    out.put(&_version, sizeof _version);
+
+    auto handle = reinterpret_cast<sqlite3_stmt*>(stmt.handle);
+    const int col_num = sqlite3_column_count(handle);
+
+    SQLite3Stmt::ColumnBatch batch;
+    std::vector<std::uint64_t> groups; ///< per group: rows, then 5 values per column
+    std::vector<SQLite3Stmt::Type> types; ///< per column: common type of the groups
+    std::uint64_t total_rows = 0;
+
+    bool more = stmt._start();
+    if (!more)
+        stmt.reset();
+    while (more)
+    {
+        // each group picks its own types, so a value cannot be coerced to those of the first row
+        for (auto & c: batch.columns)
+            c.type = SQLite3Stmt::Type::Unknown;
+        const auto rows = stmt._fetch_batch(batch, group_rows, true);
+        if (rows == 0)
+            break;
+        more = stmt._has_row();
+
+        groups.push_back(rows);
+        for (const auto & c: batch.columns)
+        {
+            const auto nulls_pos = out.tell();
+            out.put(c.nulls.data(), c.nulls.size() * sizeof(std::uint64_t));
+
+            const auto data_pos = out.tell();
+            std::uint64_t heap_pos = 0, heap_size = 0;
+            switch (c.type)
+            {
+            case SQLite3Stmt::Type::Integer:
+                out.put(c.ints.data(), c.ints.size() * sizeof(std::int64_t));
+                break;
+
+            case SQLite3Stmt::Type::Float:
+                out.put(c.floats.data(), c.floats.size() * sizeof(double));
+                break;
+
+            default:
+                if constexpr (sizeof(std::size_t) == sizeof(std::uint64_t))
+                    out.put(c.offsets.data(), c.offsets.size() * sizeof(std::uint64_t));
+                else
+                    for (const auto off: c.offsets)
+                        out.put64(off);
+                heap_pos = out.tell();
+                heap_size = c.arena.size();
+                out.put(c.arena.data(), c.arena.size());
+                out.align();
+                break;
+            }
+
+            groups.insert(groups.end(), {static_cast<std::uint64_t>(c.type), nulls_pos, data_pos, heap_pos, heap_size});
+        }
+        if (types.empty())
+        {
+            for (const auto & c: batch.columns)
+                types.push_back(c.type);
+        }
+        for (std::size_t col = 0; col < types.size(); col++)
+        {
+            if (types[col] != batch.columns[col].type)
+                types[col] = SQLite3Stmt::Type::Unknown;
+        }
+        total_rows += rows;
+    }
+
+    const auto group_num = groups.size() / (1 + 5 * static_cast<std::size_t>(col_num));
+    const auto footer_pos = out.tell();
+    out.put64(col_num);
+    out.put64(group_num);
+    out.put64(total_rows);
+    for (int col = 0; col < col_num; col++)
+    {
+        const auto type = types.empty() ? SQLite3Stmt::Type::Null : types[col];
+        const char * name = sqlite3_column_name(handle, col);
+        const std::size_t len = name == nullptr ? 0 : std::strlen(name);
+        out.put64(static_cast<std::uint64_t>(type));
+        out.put64(len);
+        out.put(name, len);
+        out.align();
+    }
+    out.put(groups.data(), groups.size() * sizeof(std::uint64_t));
+    out.put64(footer_pos);
+    out.put(_magic, sizeof _magic);
+
+    const auto bytes = out.tell();
+    out.commit(filename);
+
+    return WriteStats{total_rows, group_num, bytes,
+        std::chrono::duration<double>(clock::now() - t0).count()};
+}
+
+
+struct ColumnarFile::Internals
+{
+    struct Column
+    {
+        std::string_view  name;
+        SQLite3Stmt::Type type;
+    };
+
+    std::vector<Column>        columns;
+    std::vector<std::uint64_t> groups; ///< footer group table, see write()
+    std::uint64_t              rows = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+    std::size_t stride() const noexcept { return 1 + 5 * columns.size(); }
+};
+
+/// footer reader with bounds checks
+namespace
+{
+    class _Input
+    {
+    private:
+        const char  * data;
+        std::size_t   size, pos;
+
+    public:
+        _Input(const char * d, std::size_t n, std::size_t at) noexcept: data(d), size(n), pos(at) { }
+
+        static void fail() { throw std::runtime_error("not a valid columnar file"); }
+
+        std::uint64_t get64()
+        {
+            if (this->size - this->pos < 8)
+                fail();
+            std::uint64_t v;
+            std::memcpy(&v, this->data + this->pos, sizeof v);
+            this->pos += sizeof v;
+            return v;
+        }
+
+        std::string_view bytes(std::uint64_t n)
+        {
+            if (this->size - this->pos < n)
+                fail();
+            const std::string_view v(this->data + this->pos, n);
+            this->pos += (n + 7) / 8 * 8;
+            if (this->pos > this->size)
+                fail();
+            return v;
+        }
+    };
+}
+
+ColumnarFile::ColumnarFile(const char * filename):
+    data(nullptr), size(0), internals(new Internals)
+{
+    try
+    {
+#ifdef _WIN32
+        auto & in = *this->internals;
+        in.file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (in.file == INVALID_HANDLE_VALUE)
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), filename);
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(in.file, &file_size))
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), filename);
+        this->size = static_cast<std::size_t>(file_size.QuadPart);
+        if (this->size < _header_size + _trailer_size)
+            _Input::fail();
+        in.mapping = CreateFileMappingA(in.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (in.mapping == nullptr)
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), filename);
+        this->data = static_cast<const char *>(MapViewOfFile(in.mapping, FILE_MAP_READ, 0, 0, 0));
+        if (this->data == nullptr)
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), filename);
+#else
+        const int fd = ::open(filename, O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), filename);
+        }
+        this->size = static_cast<std::size_t>(st.st_size);
+        if (this->size < _header_size + _trailer_size)
+        {
+            ::close(fd);
+            _Input::fail();
+        }
+        void * p = ::mmap(nullptr, this->size, PROT_READ, MAP_SHARED, fd, 0);
+        const int err = errno;
+        ::close(fd); // the mapping keeps the file open
+        if (p == MAP_FAILED)
+            throw std::system_error(err, std::generic_category(), filename);
+        this->data = static_cast<const char *>(p);
+#endif
+
+        std::uint32_t bom, version;
+        std::memcpy(&bom, this->data + 8, sizeof bom);
+        std::memcpy(&version, this->data + 12, sizeof version);
+        if (std::memcmp(this->data, _magic, sizeof _magic) != 0 ||
+                std::memcmp(this->data + this->size - 8, _magic, sizeof _magic) != 0 ||
+                bom != _bom || version != _version)
+            _Input::fail();
+
+        std::uint64_t footer_pos;
+        std::memcpy(&footer_pos, this->data + this->size - _trailer_size, sizeof footer_pos);
+        if (footer_pos < _header_size || footer_pos > this->size - _trailer_size)
+            _Input::fail();
+
+        auto & in = *this->internals;
+        _Input footer(this->data, this->size - _trailer_size, footer_pos);
+        const auto col_num = footer.get64();
+        const auto group_num = footer.get64();
+        in.rows = footer.get64();
+        if (col_num > this->size / 16 || group_num > this->size / 8)
+            _Input::fail();
+
+        in.columns.resize(col_num);
+        for (auto & c: in.columns)
+        {
+            const auto type = footer.get64();
+            if (type > static_cast<std::uint64_t>(SQLite3Stmt::Type::Blob))
+                _Input::fail();
+            c.type = static_cast<SQLite3Stmt::Type>(type);
+            c.name = footer.bytes(footer.get64());
+        }
+
+        // check every chunk lies in the file; of the data, only text and blob offsets are read
+        in.groups.resize(group_num * in.stride());
+        std::uint64_t rows = 0;
+        auto inside = [this](std::uint64_t pos, std::uint64_t n)
+            { return pos % 8 == 0 && pos <= this->size && n <= (this->size - pos) / 8; };
+        for (std::size_t g = 0; g < group_num; g++)
+        {
+            auto slot = in.groups.data() + g * in.stride();
+            const auto n = slot[0] = footer.get64();
+            rows += n;
+            for (std::size_t col = 0; col < col_num; col++)
+            {
+                auto pos = slot + 1 + 5 * col;
+                for (int i = 0; i < 5; i++)
+                    pos[i] = footer.get64();
+
+                if (pos[0] < static_cast<std::uint64_t>(SQLite3Stmt::Type::Integer) ||
+                        pos[0] > static_cast<std::uint64_t>(SQLite3Stmt::Type::Blob))
+                    _Input::fail();
+                const auto type = static_cast<SQLite3Stmt::Type>(pos[0]);
+                if (in.columns[col].type != SQLite3Stmt::Type::Unknown && in.columns[col].type != type)
+                    _Input::fail();
+                const bool variable = type == SQLite3Stmt::Type::Text || type == SQLite3Stmt::Type::Blob;
+                if (!inside(pos[1], (n + 63) / 64) || !inside(pos[2], variable ? n + 1 : n) ||
+                        (variable && (pos[3] > this->size || pos[4] > this->size - pos[3])))
+                    _Input::fail();
+
+                // Chunk::text() and blob() trust the offsets
+                if (variable)
+                {
+                    std::uint64_t prev = 0;
+                    for (std::size_t i = 0; i <= n; i++)
+                    {
+                        std::uint64_t off;
+                        std::memcpy(&off, this->data + pos[2] + 8 * i, sizeof off);
+                        if (off < prev || off > pos[4])
+                            _Input::fail();
+                        prev = off;
+                    }
+                }
+            }
+        }
+        if (rows != in.rows)
+            _Input::fail();
+    }
+    catch (...)
+    {
+        this->_close();
+        throw;
+    }
+}
+
+ColumnarFile::~ColumnarFile()
+{
+    this->_close();
+}
+
+void ColumnarFile::_close() noexcept
+{
+    if (this->internals == nullptr)
+        return;
+
+#ifdef _WIN32
+    if (this->data != nullptr)
+        UnmapViewOfFile(this->data);
+    if (this->internals->mapping != nullptr)
+        CloseHandle(this->internals->mapping);
+    if (this->internals->file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->internals->file);
+#else
+    if (this->data != nullptr)
+        ::munmap(const_cast<char *>(this->data), this->size);
+#endif
+
+    delete this->internals;
+    this->internals = nullptr;
+    this->data = nullptr;
+}
+
+std::size_t ColumnarFile::columnCount() const noexcept
+{
+    return this->internals->columns.size();
+}
+
+std::string_view ColumnarFile::columnName(std::size_t col) const noexcept
+{
+    return this->internals->columns[col].name;
+}
+
+SQLite3Stmt::Type ColumnarFile::columnType(std::size_t col) const noexcept
+{
+    return this->internals->columns[col].type;
+}
+
+int ColumnarFile::columnIndex(std::string_view name) const noexcept
+{
+    const auto & cols = this->internals->columns;
+    for (std::size_t i = 0; i < cols.size(); i++)
+    {
+        if (cols[i].name == name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::uint64_t ColumnarFile::rowCount() const noexcept
+{
+    return this->internals->rows;
+}
+
+std::size_t ColumnarFile::groupCount() const noexcept
+{
+    const auto & in = *this->internals;
+    return in.groups.size() / in.stride();
+}
+
+std::size_t ColumnarFile::groupRows(std::size_t group) const noexcept
+{
+    const auto & in = *this->internals;
+    return in.groups[group * in.stride()];
+}
+
+ColumnarFile::Chunk ColumnarFile::chunk(std::size_t group, std::size_t col) const noexcept
+{
+    const auto & in = *this->internals;
+    const auto slot = in.groups.data() + group * in.stride();
+    const std::size_t rows = slot[0];
+    const auto pos = slot + 2 + 5 * col;
+
+    Chunk c{static_cast<SQLite3Stmt::Type>(pos[-1]), rows, {}, {}, {}, {}, nullptr};
+    c.nulls = std::span<const std::uint64_t>(
+        reinterpret_cast<const std::uint64_t *>(this->data + pos[0]), (rows + 63) / 64);
+    switch (c.type)
+    {
+    case SQLite3Stmt::Type::Integer:
+        c.ints = std::span<const std::int64_t>(reinterpret_cast<const std::int64_t *>(this->data + pos[1]), rows);
+        break;
+
+    case SQLite3Stmt::Type::Float:
+        c.floats = std::span<const double>(reinterpret_cast<const double *>(this->data + pos[1]), rows);
+        break;
+
+    case SQLite3Stmt::Type::Text:
+    case SQLite3Stmt::Type::Blob:
+        c.offsets = std::span<const std::uint64_t>(
+            reinterpret_cast<const std::uint64_t *>(this->data + pos[1]), rows + 1);
+        c.heap = this->data + pos[2];
+        break;
+
+    default:
+        break;
+    }
+    return c;
+}
@@ -1,34 +1,189 @@
-#include <sqlite3w.h>
+#include "internal.h"
 
+#include <algorithm>
 #include <cstring>
-#include <sqlite3.h>
 
 using namespace hgl;
 
-static constexpr auto bufsize = 1024;
+static constexpr std::size_t init_bufsize = 256;
 
-SQLite3::SQLite3(const char * filename):
-    handle(nullptr), buffer(reinterpret_cast<char*>(::operator new(bufsize)))
+static_assert(SQLite3::OpenOptions::ReadOnly == SQLITE_OPEN_READONLY);
+static_assert(SQLite3::OpenOptions::ReadWrite == SQLITE_OPEN_READWRITE);
+static_assert(SQLite3::OpenOptions::Create == SQLITE_OPEN_CREATE);
+static_assert(SQLite3::OpenOptions::Uri == SQLITE_OPEN_URI);
+static_assert(SQLite3::OpenOptions::Memory == SQLITE_OPEN_MEMORY);
+static_assert(SQLite3::OpenOptions::NoMutex == SQLITE_OPEN_NOMUTEX);
+static_assert(SQLite3::OpenOptions::FullMutex == SQLITE_OPEN_FULLMUTEX);
+static_assert(SQLite3::OpenOptions::SharedCache == SQLITE_OPEN_SHAREDCACHE);
+static_assert(SQLite3::OpenOptions::PrivateCache == SQLITE_OPEN_PRIVATECACHE);
+static_assert(SQLite3::OpenOptions::NoFollow == SQLITE_OPEN_NOFOLLOW);
+
+SQLite3::SQLite3(const char * filename): SQLite3(filename, OpenOptions())
+{
+}
+
+SQLite3::SQLite3(const char * filename, const OpenOptions & opts):
+    handle(nullptr), buffer(reinterpret_cast<char*>(::operator new(init_bufsize))),
+    buffer_size(init_bufsize), internals(new Internals)
 {
     if (filename != nullptr)
-        this->open(filename);
+    {
+        try
+        {
+            this->open(filename, opts);
+        }
+        catch (...)
+        {
+            delete this->internals;
+            ::operator delete(this->buffer);
+            throw;
+        }
+    }
 }
 
 SQLite3::~SQLite3()
 {
     this->close();
+    delete this->internals;
     ::operator delete(this->buffer);
 }
 
+void SQLite3::Internals::installHooks(sqlite3 * db) noexcept
+{
+    if (db == nullptr)
+        return;
+
+    const bool on = this->changes.enabled() || this->query_cache.enabled();
+    sqlite3_update_hook(db, on ? &Internals::onUpdate : nullptr, this);
+    sqlite3_set_authorizer(db, on ? &Internals::onAuthorize : nullptr, this);
+    this->changes.install(db);
+}
+
+void SQLite3::Internals::onUpdate(void * ctx, int op, const char *, const char * table, sqlite3_int64 rowid)
+{
+    auto self = static_cast<Internals *>(ctx);
+    self->changes.record(op, table, rowid);
+    self->query_cache.invalidate(table);
+}
+
+int SQLite3::Internals::onAuthorize(void * ctx, int action, const char * arg1, const char * arg2,
+    const char *, const char *)
+{
+    auto self = static_cast<Internals *>(ctx);
+    self->query_cache.authorize(action, arg1);
+    self->changes.authorize(action, arg1, arg2);
+
+    const auto last = self->last_auth_action;
+    self->last_auth_action = action;
+
+    // SQLITE_IGNORE turns off the truncate optimization of "DELETE FROM t",
+    // which would remove the rows without calling the update hook. DROP
+    // checks SQLITE_DELETE on the schema table and on the dropped table,
+    // where ignoring it would make the DROP a silent no-op.
+    if (action != SQLITE_DELETE || arg1 == nullptr || std::strncmp(arg1, "sqlite_", 7) == 0)
+        return SQLITE_OK;
+    switch (last)
+    {
+    case SQLITE_DROP_TABLE: case SQLITE_DROP_TEMP_TABLE:
+    case SQLITE_DROP_VIEW: case SQLITE_DROP_TEMP_VIEW: case SQLITE_DROP_VTABLE:
+        return SQLITE_OK;
+    default:
+        return SQLITE_IGNORE;
+    }
+}
+
 void SQLite3::open(const char * filename)
+{
+    this->open(filename, OpenOptions());
+}
+
+static void _pragma(const SQLite3 & db, sqlite3 * handle, const char * name, const char * value)
+{
+    const auto sql = std::string("PRAGMA ") + name + '=' + value + ';';
+    if (sqlite3_exec(handle, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+        throw SQLite3Error(db);
+}
+
+static void _configure(const SQLite3 & db, sqlite3 * handle, const SQLite3::OpenOptions & opts)
+{
+    using Opts = SQLite3::OpenOptions;
+
+    // lookaside memory can only be changed while no connection memory is in use
+    if (opts.lookaside_slot_size > 0 && opts.lookaside_slots > 0)
+    {
+        if (sqlite3_db_config(handle, SQLITE_DBCONFIG_LOOKASIDE,
+                nullptr, opts.lookaside_slot_size, opts.lookaside_slots) != SQLITE_OK)
+            throw SQLite3Error(db);
+    }
+
+    // page size first: it has no effect once WAL mode is on
+    if (opts.page_size)
+        _pragma(db, handle, "page_size", std::to_string(*opts.page_size).c_str());
+
+    static const char * const journal_modes[] = {
+        nullptr, "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF" };
+    if (opts.journal_mode != Opts::Journal::Default)
+    {
+        // the pragma returns the mode in effect, which is the old one if the switch failed
+        // (WAL on an in-memory database, or while another connection has the file open)
+        const char * const mode = journal_modes[static_cast<int>(opts.journal_mode)];
+        const auto sql = std::string("PRAGMA journal_mode=") + mode + ';';
+        std::string result;
+        auto on_row = [](void * out, int, char ** vals, char **)
+        {
+            *static_cast<std::string *>(out) = vals[0] != nullptr ? vals[0] : "";
+            return 0;
+        };
+        if (sqlite3_exec(handle, sql.c_str(), on_row, &result, nullptr) != SQLITE_OK)
+            throw SQLite3Error(db);
+        if (sqlite3_stricmp(result.c_str(), mode) != 0)
+            throw SQLite3Error(SQLITE_ERROR, ("cannot set journal_mode to " + std::string(mode) +
+                ", it is still " + result).c_str());
+    }
+
+    static const char * const sync_modes[] = { nullptr, "OFF", "NORMAL", "FULL", "EXTRA" };
+    if (opts.synchronous != Opts::Synchronous::Default)
+        _pragma(db, handle, "synchronous", sync_modes[static_cast<int>(opts.synchronous)]);
+
+    if (opts.cache_size)
+        _pragma(db, handle, "cache_size", std::to_string(*opts.cache_size).c_str());
+
+    if (opts.mmap_size)
+        _pragma(db, handle, "mmap_size", std::to_string(*opts.mmap_size).c_str());
+
+    static const char * const temp_stores[] = { nullptr, "FILE", "MEMORY" };
+    if (opts.temp_store != Opts::TempStore::Default)
+        _pragma(db, handle, "temp_store", temp_stores[static_cast<int>(opts.temp_store)]);
+}
+
+void SQLite3::open(const char * filename, const OpenOptions & opts)
 {
     if (this->handle != nullptr)
         this->close();
 
-    if (sqlite3_open(filename, reinterpret_cast<sqlite3**>(&this->handle)) != SQLITE_OK)
+    sqlite3 * db = nullptr;
+    const auto res = sqlite3_open_v2(filename, &db, opts.flags, nullptr);
+    if (res != SQLITE_OK)
+    {
+        SQLite3Error error(res, db != nullptr ? sqlite3_errmsg(db) : nullptr);
+        sqlite3_close(db);
+        throw error;
+    }
+    this->handle = db;
+
+    this->internals->busy.install(db);
+    this->internals->profiler.install(db);
+    this->internals->installHooks(db);
+
+    // all or nothing: a half-configured connection is never handed out
+    try
     {
-        this->handle = nullptr;
-        throw SQLite3Error(*this);
+        _configure(*this, db, opts);
+    }
+    catch (...)
+    {
+        this->close();
+        throw;
     }
 }
 
@@ -37,29 +192,92 @@ void SQLite3::close() noexcept
     if (this->handle == nullptr)
         return;
 
+    this->internals->stmt_cache.clear();
     sqlite3_close(reinterpret_cast<sqlite3*>(this->handle));
     this->handle = nullptr;
 }
 
 void SQLite3::operator()(const char * stmts)
 {
-    char * errmsg;
-    const auto ret = sqlite3_exec(reinterpret_cast<sqlite3*>(this->handle),
-        stmts, nullptr, nullptr, &errmsg);
+    this->tryExec(stmts).check();
+}
 
-    if (ret != SQLITE_OK)
+/**
+ * @brief sqlite3_exec() one statement at a time, for a connection whose changes are watched
+ * 
+ * A failing statement then drops only its own changes, and savepoint
+ * statements reach the change log when they have run.
+ */
+static int _exec_each(sqlite3 * db, BusyHandler & busy, ChangeLog & changes, const char * stmts,
+    SQLite3::exec_callback_type cb, void * cb_param) noexcept
+{
+    std::vector<char *> row; // column values, then column names
+
+    for (const char * rest = stmts; rest != nullptr && *rest != '\0'; )
     {
-        SQLite3Error error(ret, errmsg);
-        sqlite3_free(errmsg);
-        throw error;
+        sqlite3_stmt * stmt;
+        changes.preparing();
+        auto ret = busy.settle(sqlite3_prepare_v2(db, rest, -1, &stmt, &rest));
+        changes.prepared(stmt);
+        if (ret != SQLITE_OK)
+            return ret;
+        if (stmt == nullptr)
+            continue; // whitespace or comment
+
+        const auto mark = changes.markStep(db);
+        while ((ret = sqlite3_step(stmt)) == SQLITE_ROW && cb != nullptr)
+        {
+            const int n = sqlite3_column_count(stmt);
+            try
+            {
+                row.resize(2 * static_cast<std::size_t>(n));
+            }
+            catch (...)
+            {
+                ret = SQLITE_NOMEM;
+                break;
+            }
+            for (int col = 0; col < n; col++)
+            {
+                row[col] = const_cast<char *>(reinterpret_cast<const char *>(sqlite3_column_text(stmt, col)));
+                row[n + col] = const_cast<char *>(sqlite3_column_name(stmt, col));
+            }
+            if (cb(cb_param, n, row.data(), row.data() + n) != 0)
+            {
+                ret = SQLITE_ABORT;
+                break;
+            }
+        }
+        while (ret == SQLITE_ROW)
+            ret = sqlite3_step(stmt);
+        busy.settle(ret);
+        changes.settle(db, ret);
+        changes.stepped(stmt, ret);
+        if (ret != SQLITE_DONE)
+            changes.stepFailed(db, mark);
+        changes.forget(stmt);
+        sqlite3_finalize(stmt);
+        if (ret != SQLITE_DONE)
+            return ret;
     }
+    return SQLITE_OK;
 }
 
 void SQLite3::operator()(const char * stmts, exec_callback_type cb, void * cb_param)
 {
+    auto db = reinterpret_cast<sqlite3*>(this->handle);
+    auto & changes = this->internals->changes;
+    if (changes.enabled())
+    {
+        const auto ret = _exec_each(db, this->internals->busy, changes, stmts, cb, cb_param);
+        if (ret != SQLITE_OK)
+            throw ret == SQLITE_ABORT ? SQLite3Error(ret) : SQLite3Error(*this);
+        return;
+    }
+
     char * errmsg;
-    const auto ret = sqlite3_exec(reinterpret_cast<sqlite3*>(this->handle),
-        stmts, cb, cb_param, &errmsg);
+    const auto ret = this->internals->busy.settle(sqlite3_exec(db, stmts, cb, cb_param, &errmsg));
+    changes.settle(db, ret);
 
     if (ret != SQLITE_OK)
     {
@@ -69,125 +287,137 @@ void SQLite3::operator()(const char * stmts, exec_callback_type cb, void * cb_pa
     }
 }
 
+SQLite3Status SQLite3::tryExec(const char * stmts) noexcept
+{
+    auto db = reinterpret_cast<sqlite3*>(this->handle);
+    auto & changes = this->internals->changes;
+    auto & busy = this->internals->busy;
+    if (!changes.enabled())
+        return SQLite3Status(busy.settle(sqlite3_exec(db, stmts, nullptr, nullptr, nullptr)), this);
+    return SQLite3Status(_exec_each(db, busy, changes, stmts, nullptr, nullptr), this);
+}
+
 const char * SQLite3::getErrMsg() noexcept
 {
     const auto msg = sqlite3_errmsg(reinterpret_cast<sqlite3*>(this->handle));
     return msg;
 }
 
-static const char _text_delete_from[] = "DELETE FROM ";
-static const char _text_insert_into[] = "INSERT INTO ";
-static const char _text_select[] = "SELECT ";
-static const char _text_update[] = "UPDATE ";
-
-static const char _text_from[] = " FROM ";
-static const char _text_set[] = " SET ";
-static const char _text_values[] = " VALUES ";
-static const char _text_where[] = " WHERE ";
-
-#define PUT_PTEXT(PTR, TEXT) \
-    std::memcpy(p, _text_ ##TEXT, sizeof(_text_ ##TEXT) - 1); \
-    p += (sizeof(_text_ ##TEXT) - 1); \
-// PUT_PTEXT
+void SQLite3::setStmtCacheCapacity(std::size_t capacity) noexcept
+{
+    this->internals->stmt_cache.setCapacity(capacity);
+}
 
-#define PUT_CSTR(PTR, STR) { \
-    auto const _len = std::strlen(STR); \
-    std::memcpy(PTR, STR, _len); \
-    PTR += _len; } \
-// PUT_CSTR
+SQLite3::StmtCacheStats SQLite3::getStmtCacheStats() const noexcept
+{
+    return this->internals->stmt_cache.stats();
+}
 
-#define PUT_CHAR(PTR, CH) *(PTR++) = (CH)
+void SQLite3::clearStmtCache() noexcept
+{
+    this->internals->stmt_cache.clear();
+}
 
-#define PUT_END(PTR) { PUT_CHAR(PTR, ';'); *PTR = '\0'; }
+namespace
+{
+    /// appends SQL text to a connection's growable buffer
+    class SqlWriter
+    {
+    private:
+        char *&       buf;
+        std::size_t & cap;
+        std::size_t   len;
+
+        void reserve(std::size_t n)
+        {
+            if (n <= this->cap)
+                return;
+
+            auto const new_cap = std::max(n, this->cap * 2);
+            auto const new_buf = reinterpret_cast<char*>(::operator new(new_cap));
+            std::memcpy(new_buf, this->buf, this->len);
+            ::operator delete(this->buf);
+            this->buf = new_buf;
+            this->cap = new_cap;
+        }
+
+    public:
+        SqlWriter(char *& buf, std::size_t & cap): buf(buf), cap(cap), len(0) { }
+
+        SqlWriter & operator<<(std::string_view s)
+        {
+            this->reserve(this->len + s.size() + 1);
+            std::memcpy(this->buf + this->len, s.data(), s.size());
+            this->len += s.size();
+            return *this;
+        }
+
+        SqlWriter & operator<<(char c)
+        {
+            this->reserve(this->len + 2);
+            this->buf[this->len++] = c;
+            return *this;
+        }
+
+        const char * c_str()
+        {
+            *this << ';';
+            this->buf[this->len] = '\0';
+            return this->buf;
+        }
+    };
+}
 
 SQLite3Stmt SQLite3::makeInsert(
     const char * table, const char * names, const char * values)
 {
-    char * p = this->buffer;
-
-    PUT_PTEXT(p, insert_into); PUT_CSTR(p, table);
-
-    PUT_CHAR(p, '('); PUT_CSTR(p, names); PUT_CHAR(p, ')');
-
-    PUT_PTEXT(p, values); PUT_CHAR(p, '('); PUT_CSTR(p, values); PUT_CHAR(p, ')');
-
-    PUT_END(p);
-
-    return SQLite3Stmt(*this, this->buffer);
+    SqlWriter w(this->buffer, this->buffer_size);
+    w << "INSERT INTO " << table << '(' << names << ')' << " VALUES (" << values << ')';
+    return SQLite3Stmt(*this, w.c_str());
 }
 
 SQLite3Stmt SQLite3::makeInsert(const char * table, const char * values)
 {
-    char * p = this->buffer;
-
-    PUT_PTEXT(p, insert_into); PUT_CSTR(p, table);
-
-    PUT_PTEXT(p, values); PUT_CHAR(p, '('); PUT_CSTR(p, values); PUT_CHAR(p, ')');
-
-    PUT_END(p);
-
-    return SQLite3Stmt(*this, this->buffer);
+    SqlWriter w(this->buffer, this->buffer_size);
+    w << "INSERT INTO " << table << " VALUES (" << values << ')';
+    return SQLite3Stmt(*this, w.c_str());
 }
 
 SQLite3Stmt SQLite3::makeSelect(
     const char * table, const char * names, const char * where)
 {
-    char * p = this->buffer;
-
-    PUT_PTEXT(p, select);
-
-    if (names == nullptr)
-    {
-        PUT_CHAR(p, '*');
-    }
-    else
-    {
-        PUT_CSTR(p, names);
-    }
-
-    PUT_PTEXT(p, from); PUT_CSTR(p, table);
-
+    SqlWriter w(this->buffer, this->buffer_size);
+    w << "SELECT " << (names == nullptr ? "*" : names) << " FROM " << table;
     if (where != nullptr)
-    {
-        PUT_PTEXT(p, where); PUT_CSTR(p, where);
-    }
-
-    PUT_END(p);
-
-    return SQLite3Stmt(*this, this->buffer);
+        w << " WHERE " << where;
+    return SQLite3Stmt(*this, w.c_str());
 }
 
 SQLite3Stmt SQLite3::makeUpdate(const char * table,
     std::initializer_list<std::pair<const char*, const char*>> name_vals, const char * where)
 {
+    SqlWriter w(this->buffer, this->buffer_size);
+    w << "UPDATE " << table << " SET ";
 
-    char * p = this->buffer;
-
-    PUT_PTEXT(p, update); PUT_CSTR(p, table);
-
-    PUT_PTEXT(p, set);
-
+    bool first = true;
     for (auto & [name, val]: name_vals)
     {
-        PUT_CSTR(p, name); PUT_CHAR(p, '='); PUT_CSTR(p, val);
+        if (!first)
+            w << ',';
+        w << name << '=' << val;
+        first = false;
     }
 
-    PUT_PTEXT(p, where); PUT_CSTR(p, where);
-
-    PUT_END(p);
-
-    return SQLite3Stmt(*this, this->buffer);
+    if (where != nullptr)
+        w << " WHERE " << where;
+    return SQLite3Stmt(*this, w.c_str());
 }
 
 SQLite3Stmt SQLite3::makeDelete(const char * table, const char * where)
 {
-    char * p = this->buffer;
-
-    PUT_PTEXT(p, delete_from); PUT_CSTR(p, table);
-
-    PUT_PTEXT(p, where); PUT_CSTR(p, where);
-
-    PUT_END(p);
-
-    return SQLite3Stmt(*this, this->buffer);
+    SqlWriter w(this->buffer, this->buffer_size);
+    w << "DELETE FROM " << table;
+    if (where != nullptr)
+        w << " WHERE " << where;
+    return SQLite3Stmt(*this, w.c_str());
 }
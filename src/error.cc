@@ -43,3 +43,23 @@ SQLite3Error::~SQLite3Error()
         this->msg = nullptr;
     }
 }
+
+
+const char * SQLite3Status::message() const noexcept
+{
+    if (this->code == SQLITE_OK)
+        return sqlite3_errstr(SQLITE_OK);
+
+    if (this->db != nullptr && this->db->handle != nullptr)
+    {
+        auto handle = reinterpret_cast<sqlite3*>(this->db->handle);
+        if (sqlite3_extended_errcode(handle) == this->code || sqlite3_errcode(handle) == this->code)
+            return sqlite3_errmsg(handle);
+    }
+    return sqlite3_errstr(this->code);
+}
+
+void SQLite3Status::_raise() const
+{
+    throw SQLite3Error(this->code, this->message());
+}
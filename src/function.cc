@@ -0,0 +1,193 @@
+#include "internal.h"
+
+using namespace hgl;
+
+static_assert(SQLite3::Deterministic == SQLITE_DETERMINISTIC);
+static_assert(SQLite3::DirectOnly == SQLITE_DIRECTONLY);
+static_assert(SQLite3::Innocuous == SQLITE_INNOCUOUS);
+
+void _SqlFn::args(void ** argv, const Type * types, Value * out, int n) noexcept
+{
+    auto values = reinterpret_cast<sqlite3_value**>(argv);
+
+    for (int i = 0; i < n; i++)
+    {
+        auto & v = out[i];
+        auto arg = values[i];
+        v.i = 0;
+        v.f = 0.0;
+        v.p = nullptr;
+        v.n = 0;
+
+        if (sqlite3_value_type(arg) == SQLITE_NULL)
+        {
+            v.type = Type::Null;
+            continue;
+        }
+
+        v.type = types[i];
+        switch (v.type)
+        {
+        case Type::Integer:
+            v.i = sqlite3_value_int64(arg);
+            break;
+
+        case Type::Float:
+            v.f = sqlite3_value_double(arg);
+            break;
+
+        case Type::Blob:
+            v.p = sqlite3_value_blob(arg);
+            v.n = sqlite3_value_bytes(arg);
+            break;
+
+        default:
+            v.p = sqlite3_value_text(arg);
+            v.n = sqlite3_value_bytes(arg);
+            break;
+        }
+    }
+}
+
+void _SqlFn::arg(void ** argv, int i, Value & out) noexcept
+{
+    auto arg = reinterpret_cast<sqlite3_value**>(argv)[i];
+    Type type;
+    switch (sqlite3_value_type(arg))
+    {
+    case SQLITE_INTEGER: type = Type::Integer; break;
+    case SQLITE_FLOAT:   type = Type::Float; break;
+    case SQLITE_BLOB:    type = Type::Blob; break;
+    default:             type = Type::Text; break; // NULL is detected by args()
+    }
+    args(argv + i, &type, &out, 1);
+}
+
+void _SqlFn::result(void * ctx, const Value & v, bool copy) noexcept
+{
+    auto context = reinterpret_cast<sqlite3_context*>(ctx);
+
+    switch (v.type)
+    {
+    case Type::Integer:
+        sqlite3_result_int64(context, v.i);
+        break;
+
+    case Type::Float:
+        sqlite3_result_double(context, v.f);
+        break;
+
+    case Type::Text:
+        sqlite3_result_text64(context, v.p == nullptr ? "" : static_cast<const char *>(v.p),
+            v.n, copy ? SQLITE_TRANSIENT : SQLITE_STATIC, SQLITE_UTF8);
+        break;
+
+    case Type::Blob:
+        sqlite3_result_blob64(context, v.p == nullptr ? "" : v.p, v.n,
+            copy ? SQLITE_TRANSIENT : SQLITE_STATIC);
+        break;
+
+    default:
+        sqlite3_result_null(context);
+        break;
+    }
+}
+
+void _SqlFn::error(void * ctx, const char * msg, int code) noexcept
+{
+    auto context = reinterpret_cast<sqlite3_context*>(ctx);
+    sqlite3_result_error(context, msg, -1);
+    sqlite3_result_error_code(context, code);
+}
+
+void _SqlFn::noMemory(void * ctx) noexcept
+{
+    sqlite3_result_error_nomem(reinterpret_cast<sqlite3_context*>(ctx));
+}
+
+
+static _SqlFunction * _function(sqlite3_context * ctx) noexcept
+{
+    return static_cast<_SqlFunction*>(sqlite3_user_data(ctx));
+}
+
+static void _x_func(sqlite3_context * ctx, int argc, sqlite3_value ** argv)
+{
+    _function(ctx)->call(ctx, argc, reinterpret_cast<void**>(argv));
+}
+
+static void _x_step(sqlite3_context * ctx, int argc, sqlite3_value ** argv)
+{
+    auto state = static_cast<void**>(sqlite3_aggregate_context(ctx, sizeof(void*)));
+    if (state == nullptr)
+        sqlite3_result_error_nomem(ctx);
+    else
+        _function(ctx)->step(ctx, state, argc, reinterpret_cast<void**>(argv));
+}
+
+static void _x_inverse(sqlite3_context * ctx, int argc, sqlite3_value ** argv)
+{
+    auto state = static_cast<void**>(sqlite3_aggregate_context(ctx, sizeof(void*)));
+    if (state == nullptr)
+        sqlite3_result_error_nomem(ctx);
+    else
+        _function(ctx)->inverse(ctx, state, argc, reinterpret_cast<void**>(argv));
+}
+
+static void _x_value(sqlite3_context * ctx)
+{
+    auto state = static_cast<void**>(sqlite3_aggregate_context(ctx, sizeof(void*)));
+    if (state == nullptr)
+        sqlite3_result_error_nomem(ctx);
+    else
+        _function(ctx)->value(ctx, state);
+}
+
+static void _x_final(sqlite3_context * ctx)
+{
+    // no allocation: a null slot means the aggregate saw no rows
+    auto state = static_cast<void**>(sqlite3_aggregate_context(ctx, 0));
+    _function(ctx)->final(ctx, state);
+}
+
+static void _x_destroy(void * fn)
+{
+    delete static_cast<_SqlFunction*>(fn);
+}
+
+void SQLite3::_define(const char * name, int nargs, int flags, _FnKind kind, _SqlFunction * fn)
+{
+    auto db = reinterpret_cast<sqlite3*>(this->handle);
+    flags |= SQLITE_UTF8;
+
+    // SQLite calls _x_destroy itself, even when defining fails
+    int res;
+    switch (kind)
+    {
+    case _FnKind::Scalar:
+        res = sqlite3_create_function_v2(db, name, nargs, flags, fn,
+            _x_func, nullptr, nullptr, _x_destroy);
+        break;
+
+    case _FnKind::Aggregate:
+        res = sqlite3_create_function_v2(db, name, nargs, flags, fn,
+            nullptr, _x_step, _x_final, _x_destroy);
+        break;
+
+    default:
+        res = sqlite3_create_window_function(db, name, nargs, flags, fn,
+            _x_step, _x_final, _x_value, _x_inverse, _x_destroy);
+        break;
+    }
+
+    if (res != SQLITE_OK)
+        throw SQLite3Error(*this);
+}
+
+void SQLite3::removeFunction(const char * name, int nargs)
+{
+    auto const res = sqlite3_create_function_v2(reinterpret_cast<sqlite3*>(this->handle),
+        name, nargs, SQLITE_UTF8, nullptr, nullptr, nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK)
+        throw SQLite3Error(*this);
+}
@@ -0,0 +1,546 @@
+/**
+ * @file internal.h
+ * @brief library-private declarations
+ */
+
+#pragma once
+
+#include <sqlite3w.h>
+#include <sqlite3w_changes.h>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sqlite3.h>
+
+namespace hgl
+{
+    /// parameter and column name lookup tables of one prepared statement
+    class NameIndex
+    {
+    private:
+        struct Slot
+        {
+            std::uint64_t hash;  ///< SQLite3Stmt::Name::_hash() of the name
+            std::string   name;
+            int           index; ///< parameter index (1 based) or column (0 based)
+        };
+
+        std::vector<Slot> params, columns; ///< sorted by hash
+        int  reprepares;      ///< SQLITE_STMTSTATUS_REPREPARE when `columns` was built
+        bool params_built, columns_built;
+
+        static void add(std::vector<Slot> & slots, const char * name, int index);
+        static int find(const std::vector<Slot> & slots, const SQLite3Stmt::Name & name) noexcept;
+
+    public:
+        NameIndex() noexcept: reprepares(0), params_built(false), columns_built(false) { }
+        NameIndex(const NameIndex &) = delete;
+
+        /**
+         * @brief find a parameter, building the table on first use
+         * @return 1 based index, or 0 if there is no such parameter
+         */
+        int param(sqlite3_stmt * stmt, const SQLite3Stmt::Name & name);
+
+        /**
+         * @brief find a result column, rebuilding the table after a schema change
+         * @return 0 based column, or -1 if there is no such column
+         */
+        int column(sqlite3_stmt * stmt, const SQLite3Stmt::Name & name);
+    };
+
+    class ChangeLog;
+
+    /// LRU cache of prepared statements, keyed by normalized SQL text
+    class StmtCache
+    {
+    private:
+        struct Entry
+        {
+            std::string    key;
+            sqlite3_stmt * stmt;
+            bool           in_use; ///< handed out to a SQLite3Stmt object
+            std::unique_ptr<NameIndex> names; ///< kept with the statement while idle
+        };
+
+        std::list<Entry> entries; ///< most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        std::unordered_map<sqlite3_stmt *, std::list<Entry>::iterator> owners; ///< entries by statement
+        std::string      key_buf; ///< scratch buffer for normalized keys
+        std::size_t      capacity;
+        std::uint64_t    hits, misses, evictions;
+        ChangeLog      & changes; ///< told about every statement finalized here
+
+        void normalize(const char * sql);
+        void shrink() noexcept;
+        void finalize(sqlite3_stmt * stmt) noexcept;
+
+    public:
+        StmtCache(std::size_t cap, ChangeLog & changes) noexcept:
+            capacity(cap), hits(0), misses(0), evictions(0), changes(changes) { }
+        StmtCache(const StmtCache &) = delete;
+        ~StmtCache() { this->clear(); }
+
+        bool enabled() const noexcept { return capacity != 0; }
+
+        /**
+         * @brief take an idle statement out of the cache
+         * 
+         * @param names receives the name tables kept with the statement, if any
+         * @return the statement, or nullptr on a miss
+         */
+        sqlite3_stmt * take(const char * sql, std::unique_ptr<NameIndex> & names) noexcept;
+
+        /**
+         * @brief register a statement just prepared after a take() miss, as in use
+         * 
+         * @param sql the text given to take(), which stays the key of the statement
+         */
+        void adopt(sqlite3_stmt * stmt, const char * sql) noexcept;
+
+        /**
+         * @brief give a statement back to the cache
+         * 
+         * @param names name tables to keep with the statement
+         * @return false if the statement was not adopted and must be finalized
+         */
+        bool put(sqlite3_stmt * stmt, std::unique_ptr<NameIndex> names) noexcept;
+
+        /**
+         * @brief finalize all idle statements and forget those in use
+         */
+        void clear() noexcept;
+
+        void setCapacity(std::size_t cap) noexcept;
+        SQLite3::StmtCacheStats stats() const noexcept;
+    };
+
+    /// SQLITE_BUSY handling of a connection
+    class BusyHandler
+    {
+    private:
+        SQLite3::BusyPolicy        policy;
+        std::atomic<std::uint64_t> events, retries, failures, wait_us;
+        std::atomic<std::uint64_t> histogram[SQLite3::BusyStats::buckets];
+        std::int64_t               waiting_since_us; ///< Timeout: start of the episode in progress, or -1
+        std::int64_t               waited_until_us;  ///< Timeout: end of its last sleep, so a late settle() adds no time
+
+        void record(std::uint64_t waited_us, bool failed) noexcept;
+        void finishWait(bool failed) noexcept;
+
+        /// sqlite3_busy_handler() callback of the Timeout mode
+        static int onBusy(void * handler, int count) noexcept;
+
+        /// one SQLITE_BUSY episode
+        class Episode
+        {
+        private:
+            BusyHandler & handler;
+            std::int64_t  start_us, delay_us;
+
+        public:
+            explicit Episode(BusyHandler & h) noexcept;
+
+            /**
+             * @brief wait before the next retry
+             * @return false to give up
+             */
+            bool sleep() noexcept;
+
+            void finish(bool failed) noexcept;
+        };
+
+    public:
+        BusyHandler() noexcept;
+        BusyHandler(const BusyHandler &) = delete;
+
+        /**
+         * @brief apply the policy to a newly opened connection
+         */
+        void install(sqlite3 * db) noexcept;
+
+        void setPolicy(sqlite3 * db, const SQLite3::BusyPolicy & p) noexcept;
+        const SQLite3::BusyPolicy & getPolicy() const noexcept { return policy; }
+
+        /**
+         * @brief handle a SQLITE_BUSY result according to the policy
+         * 
+         * @param op retries the failed operation, returning a SQLite result code
+         * @return result of the last attempt
+         */
+        template <typename Op> int retry(Op && op) noexcept
+        {
+            // SQLite has waited already, in onBusy(); settle() records the episode
+            if (this->policy.mode == SQLite3::BusyPolicy::Mode::Timeout)
+                return SQLITE_BUSY;
+
+            Episode ep(*this);
+            int res = SQLITE_BUSY;
+            while (res == SQLITE_BUSY && ep.sleep())
+                res = op();
+            ep.finish(res == SQLITE_BUSY);
+            return res;
+        }
+
+        /**
+         * @brief sqlite3_exec() with the same SQLITE_BUSY handling as statement steps
+         * 
+         * For transaction control (BEGIN, COMMIT, SAVEPOINT, RELEASE), which
+         * does not go through SQLite3Stmt.
+         */
+        int exec(sqlite3 * db, const char * sql) noexcept;
+
+        /**
+         * @brief record the episode the Timeout mode waited through, once the operation returned
+         * 
+         * @param res result of the operation (after retry())
+         * @return `res`
+         */
+        int settle(int res) noexcept
+        {
+            if (this->waiting_since_us >= 0)
+                this->finishWait(res == SQLITE_BUSY);
+            return res;
+        }
+
+        SQLite3::BusyStats stats() const noexcept;
+        void reset() noexcept;
+    };
+
+    /// per-statement profiler fed by sqlite3_trace_v2
+    class Profiler
+    {
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, StmtProfile> profiles; ///< by SQL text
+        bool           enabled;
+        sqlite3_stmt * last_stmt; ///< memo of the last traced statement...
+        const char   * last_sql;
+        StmtProfile  * last_profile; ///< ...and its profile
+
+        StmtProfile & lookup(sqlite3_stmt * stmt);
+        static int callback(unsigned int type, void * ctx, void * p, void * x);
+
+    public:
+        Profiler() noexcept:
+            enabled(false), last_stmt(nullptr), last_sql(nullptr), last_profile(nullptr) { }
+        Profiler(const Profiler &) = delete;
+
+        /**
+         * @brief install or remove the trace callback on a connection
+         */
+        void install(sqlite3 * db) noexcept;
+
+        void enable(sqlite3 * db, bool on) noexcept { enabled = on; install(db); }
+        bool isEnabled() const noexcept { return enabled; }
+
+        /**
+         * @brief record the latency of one sqlite3_step() call
+         */
+        void recordStep(sqlite3_stmt * stmt, std::uint64_t ns) noexcept;
+
+        StmtProfile get(const char * sql) const;
+        std::vector<StmtProfile> snapshot() const;
+        void reset() noexcept;
+    };
+
+    /// connection side of SQLite3::watchChanges(): changes of the open transaction
+    class ChangeLog
+    {
+    public:
+        /// what a SAVEPOINT, RELEASE or ROLLBACK TO statement does
+        enum class SavepointOp { Begin, Release, Rollback };
+
+    private:
+        /// a prepared SAVEPOINT, RELEASE or ROLLBACK TO statement
+        struct SavepointStmt
+        {
+            sqlite3_stmt * stmt;
+            SavepointOp    op;
+            std::string    name;
+        };
+
+        std::shared_ptr<ChangeStream> stream;
+        std::vector<ChangeEvent>      pending; ///< recorded, not yet committed
+        /// open savepoints, innermost last, with pending.size() when each began
+        std::vector<std::pair<std::string, std::size_t>> marks;
+        std::vector<SavepointStmt>    savepoint_stmts; ///< by prepared(), applied by stepped()
+        std::optional<SavepointStmt>  authorized; ///< SQLITE_SAVEPOINT action of the statement being prepared
+        bool                          listening = false;  ///< a prepare or step is on, see authorize()
+        bool                          committing = false; ///< the commit hook has run, the COMMIT has not returned yet
+
+        void publish(sqlite3 * db, int res) noexcept;
+
+        static int onCommit(void * ctx);
+        static void onRollback(void * ctx);
+
+    public:
+        ChangeLog() = default;
+        ChangeLog(const ChangeLog &) = delete;
+        ~ChangeLog() { this->unwatch(nullptr); }
+
+        bool enabled() const noexcept { return stream != nullptr; }
+
+        std::shared_ptr<ChangeStream> watch(std::size_t capacity);
+
+        /**
+         * @brief remove the commit and rollback hooks and close the stream
+         * @param db connection, or nullptr if already closed
+         */
+        void unwatch(sqlite3 * db) noexcept;
+
+        /**
+         * @brief install or remove the commit and rollback hooks
+         */
+        void install(sqlite3 * db) noexcept;
+
+        /// state taken before a statement step, see stepFailed()
+        struct StepMark
+        {
+            std::size_t   pending;
+            sqlite3_int64 total_changes;
+        };
+
+        /// take a StepMark and listen to the authorizer, in case SQLite re-prepares the statement
+        StepMark markStep(sqlite3 * db) noexcept
+        {
+            this->preparing();
+            return StepMark{pending.size(), sqlite3_total_changes64(db)};
+        }
+
+        /**
+         * @brief a statement step failed: drop what it recorded if SQLite undid it
+         *
+         * A failing statement is rolled back on its own (no rollback hook)
+         * unless its conflict clause is FAIL, which keeps the rows changed so
+         * far and counts them in sqlite3_total_changes().
+         */
+        void stepFailed(sqlite3 * db, const StepMark & m) noexcept;
+
+        /**
+         * @brief publish the pending events once a commit has succeeded
+         * 
+         * The commit hook runs before SQLite commits, and the commit may
+         * still fail (SQLITE_BUSY waiting for readers), leaving the
+         * transaction open. So the hook only flags the events, and every
+         * step, reset or exec that may have committed reports its result
+         * here afterwards.
+         * 
+         * @param res result of the step, reset or exec
+         */
+        void settle(sqlite3 * db, int res) noexcept
+        {
+            if (committing)
+                this->publish(db, res);
+            else if (!marks.empty() && sqlite3_get_autocommit(db))
+                marks.clear(); // the transaction has ended without changes to publish
+        }
+
+        /// a row has changed (update hook)
+        void record(int op, const char * table, sqlite3_int64 rowid) noexcept;
+
+        /**
+         * @brief a savepoint has begun, been released or been rolled back to
+         * 
+         * Called by SQLite3::Savepoint, which runs its statements through
+         * sqlite3_exec(), and by stepped() for savepoint statements in SQL.
+         */
+        void savepoint(SavepointOp op, const char * name) noexcept;
+
+        /**
+         * @brief a statement is about to be prepared by the wrapper
+         * 
+         * Only then does authorize() take note of savepoint statements;
+         * sqlite3_exec() of transaction control must not be mistaken for them.
+         */
+        void preparing() noexcept { listening = true; authorized.reset(); }
+
+        /// an authorizer action (SQLITE_SAVEPOINT: `arg1` is the verb, `arg2` the name)
+        void authorize(int action, const char * arg1, const char * arg2) noexcept;
+
+        /**
+         * @brief a statement announced by preparing() has been prepared
+         * @param stmt the statement, nullptr if the prepare failed
+         */
+        void prepared(sqlite3_stmt * stmt) noexcept;
+
+        /**
+         * @brief a statement step has returned: apply its savepoint verb if it succeeded
+         * 
+         * Savepoints in plain SQL ("SAVEPOINT a; ... ROLLBACK TO a") drop
+         * the events recorded since, as SQLite3::Savepoint does.
+         */
+        void stepped(sqlite3_stmt * stmt, int res) noexcept;
+
+        /// a statement has been finalized
+        void forget(sqlite3_stmt * stmt) noexcept;
+    };
+
+    /// result cache of SQLite3::cachedQuery(), invalidated per table
+    class QueryCache
+    {
+    private:
+        struct Table
+        {
+            std::string   name;
+            std::uint64_t generation; ///< bumped on every change to the table
+            signed char   without_rowid; ///< -1 until looked up, see cacheable()
+        };
+
+        struct Entry
+        {
+            std::string key;  ///< SQL, column types and parameters
+            std::string rows; ///< encoded values, see encode()
+            std::size_t row_count;
+            std::vector<std::pair<std::size_t, std::uint64_t>> deps; ///< table ids and their generation
+        };
+
+        std::list<Entry> entries; ///< most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        std::vector<Table> tables; ///< by id
+        std::unordered_map<std::string, std::vector<std::size_t>> plans; ///< tables read, by SQL text
+        std::vector<std::size_t> * capture; ///< receives tables read while preparing a statement
+        bool          capture_ok;
+        std::size_t   budget, bytes;
+        std::uint64_t hits, misses, stores, stale, evictions;
+
+        std::size_t tableId(const char * name);
+        void erase(std::list<Entry>::iterator it) noexcept;
+        void shrink() noexcept;
+        static std::size_t footprint(const Entry & e) noexcept;
+
+    public:
+        QueryCache() noexcept:
+            capture(nullptr), capture_ok(true), budget(0), bytes(0), hits(0), misses(0), stores(0), stale(0), evictions(0) { }
+        QueryCache(const QueryCache &) = delete;
+
+        bool enabled() const noexcept { return budget != 0; }
+        void setBudget(std::size_t b) noexcept;
+        void clear() noexcept;
+
+        /**
+         * @brief look up a result and pass its rows to `sink`
+         * @return false on a miss or a stale entry
+         */
+        bool find(const std::string & key, int columns,
+            void (*sink)(void *, const SQLite3Stmt::Value *), void * ctx);
+
+        /// tables read by a statement, or nullptr if not known yet
+        const std::vector<std::size_t> * plan(const char * sql) const;
+        /// collect the tables read by statements prepared until endCapture()
+        void beginCapture(std::vector<std::size_t> & out) noexcept { capture = &out; capture_ok = true; }
+        /// @return false if some table could not be recorded
+        bool endCapture() noexcept;
+        void setPlan(const char * sql, std::vector<std::size_t> && tables);
+
+        /// append one row of `columns` values to an encoded buffer
+        static void encode(std::string & rows, const SQLite3Stmt::Value * vals, int columns);
+
+        void store(std::string && key, std::string && rows, std::size_t row_count,
+            const std::vector<std::size_t> & plan);
+        /// @return false if a table in `plan` is a WITHOUT ROWID one, whose changes the update hook misses
+        bool cacheable(sqlite3 * db, const std::vector<std::size_t> & plan) noexcept;
+
+        /// a row of `table` has changed (update hook)
+        void invalidate(const char * table) noexcept;
+        /// a statement is about to be prepared with the given authorizer action
+        void authorize(int action, const char * arg) noexcept;
+
+        SQLite3::QueryCacheStats stats() const noexcept;
+    };
+
+    /// SQLite3::setPlanCheck(): analyzer of newly prepared statements
+    class PlanChecker
+    {
+    private:
+        SQLite3::PlanCheck     mode;
+        unsigned               kinds;  ///< PlanIssue::Kind flags to look for
+        std::vector<PlanIssue> issues; ///< collected by PlanCheck::Report
+        std::unordered_set<std::string> reported; ///< SQL text and detail of `issues`
+
+    public:
+        /// one row of EXPLAIN QUERY PLAN
+        struct Node
+        {
+            int         id, parent;
+            std::string detail;
+        };
+
+        PlanChecker() noexcept: mode(SQLite3::PlanCheck::Off), kinds(0) { }
+        PlanChecker(const PlanChecker &) = delete;
+
+        bool enabled() const noexcept { return mode != SQLite3::PlanCheck::Off; }
+
+        void setMode(SQLite3::PlanCheck m, unsigned k) noexcept { mode = m; kinds = k; }
+        SQLite3::PlanCheck getMode() const noexcept { return mode; }
+
+        /**
+         * @brief run EXPLAIN QUERY PLAN on a statement text
+         * @return SQLite result code
+         */
+        static int explain(sqlite3 * db, const char * sql, std::vector<Node> & out);
+
+        /// shell-style tree of a plan
+        static std::string dump(const std::vector<Node> & plan);
+
+        /// PlanIssue::Kind of a plan node, or 0
+        static unsigned classify(std::string_view detail) noexcept;
+
+        /**
+         * @brief analyze a newly prepared statement
+         * @throw QueryPlanError in PlanCheck::Throw mode
+         */
+        void check(sqlite3 * db, sqlite3_stmt * stmt);
+
+        std::vector<PlanIssue> get() const { return issues; }
+        void clear() noexcept { issues.clear(); reported.clear(); }
+    };
+
+    /// private state of SQLite3Stmt, allocated on first use
+    struct SQLite3Stmt::Internals
+    {
+        std::vector<std::string> owned; ///< moved-in parameter values, by 0 based index
+        ColumnBatch              batch; ///< buffer for fetchBatch(std::size_t)
+        std::unique_ptr<NameIndex> names; ///< built by paramIndex() / columnIndex()
+    };
+
+    /// connection-private state of SQLite3
+    struct SQLite3::Internals
+    {
+        /// execScript() splits kept in `scripts` before it is emptied
+        static constexpr std::size_t script_cache_capacity = 64;
+
+        StmtCache    stmt_cache;
+        BusyHandler  busy;
+        Profiler     profiler;
+        unsigned int savepoint_level; ///< number of active Savepoint objects
+        std::unordered_map<std::string, std::vector<std::string>> scripts; ///< execScript() splits, by script text
+        ChangeLog    changes;
+        QueryCache   query_cache;
+        int          last_auth_action; ///< previous action seen by onAuthorize()
+        PlanChecker  plan_check;
+
+        Internals():
+            stmt_cache(SQLite3::default_stmt_cache_capacity, changes), savepoint_level(0), last_auth_action(0) { }
+
+        /**
+         * @brief install or remove the update hook and authorizer shared by
+         *        `changes` and `query_cache`, and the hooks of `changes`
+         */
+        void installHooks(sqlite3 * db) noexcept;
+
+        static void onUpdate(void * ctx, int op, const char * schema, const char * table, sqlite3_int64 rowid);
+        static int onAuthorize(void * ctx, int action, const char * arg1, const char * arg2,
+            const char * schema, const char * trigger);
+    };
+
+} // namespace hgl
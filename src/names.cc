@@ -0,0 +1,88 @@
+#include "internal.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace hgl;
+
+void NameIndex::add(std::vector<Slot> & slots, const char * name, int index)
+{
+    if (name == nullptr) // anonymous "?" parameter
+        return;
+
+    const auto hash = SQLite3Stmt::Name::_hash(name);
+    const auto pos = std::upper_bound(slots.begin(), slots.end(), hash,
+        [](std::uint64_t h, const Slot & s) { return h < s.hash; });
+    slots.insert(pos, Slot{hash, name, index});
+}
+
+int NameIndex::find(const std::vector<Slot> & slots, const SQLite3Stmt::Name & name) noexcept
+{
+    auto it = std::lower_bound(slots.begin(), slots.end(), name.hash,
+        [](const Slot & s, std::uint64_t h) { return s.hash < h; });
+    for (; it != slots.end() && it->hash == name.hash; ++it)
+    {
+        if (it->name == name.text)
+            return it->index;
+    }
+    return -1;
+}
+
+int NameIndex::param(sqlite3_stmt * stmt, const SQLite3Stmt::Name & name)
+{
+    if (!this->params_built)
+    {
+        const int count = sqlite3_bind_parameter_count(stmt);
+        for (int i = 1; i <= count; i++)
+            add(this->params, sqlite3_bind_parameter_name(stmt, i), i);
+        this->params_built = true;
+    }
+
+    const auto index = find(this->params, name);
+    return index < 0 ? 0 : index;
+}
+
+int NameIndex::column(sqlite3_stmt * stmt, const SQLite3Stmt::Name & name)
+{
+    // "SELECT *" picks up new columns when the statement is recompiled
+    const int reprepares = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+    if (!this->columns_built || reprepares != this->reprepares)
+    {
+        this->columns.clear();
+        const int count = sqlite3_column_count(stmt);
+        for (int i = 0; i < count; i++)
+            add(this->columns, sqlite3_column_name(stmt, i), i);
+        this->reprepares = reprepares;
+        this->columns_built = true;
+    }
+
+    return find(this->columns, name);
+}
+
+NameIndex & SQLite3Stmt::_names()
+{
+    if (this->internals == nullptr)
+        this->internals = new Internals;
+    auto & names = this->internals->names;
+    if (names == nullptr)
+        names = std::make_unique<NameIndex>();
+    return *names;
+}
+
+int SQLite3Stmt::paramIndex(Name name)
+{
+    return this->_names().param(reinterpret_cast<sqlite3_stmt*>(this->handle), name);
+}
+
+int SQLite3Stmt::columnIndex(Name name)
+{
+    return this->_names().column(reinterpret_cast<sqlite3_stmt*>(this->handle), name);
+}
+
+SQLite3Stmt::RowReader::Field SQLite3Stmt::RowReader::operator[](Name name)
+{
+    const int col = *this ? this->cur->stmt->columnIndex(name) : -1;
+    if (col < 0)
+        throw std::out_of_range("no such column: " + std::string(name.text));
+    return Field{this, col};
+}
@@ -0,0 +1,175 @@
+#include "internal.h"
+
+#include <algorithm>
+
+using namespace hgl;
+
+static std::string _plan_error_message(const std::vector<PlanIssue> & issues)
+{
+    std::string msg = "query plan:";
+    for (const auto & i: issues)
+    {
+        msg += ' ';
+        msg += i.detail;
+        msg += ';';
+    }
+    if (!issues.empty())
+    {
+        msg += " in: ";
+        msg += issues.front().sql;
+    }
+    return msg;
+}
+
+QueryPlanError::QueryPlanError(std::vector<PlanIssue> issues):
+    std::runtime_error(_plan_error_message(issues)), found(std::move(issues))
+{
+}
+
+int PlanChecker::explain(sqlite3 * db, const char * sql, std::vector<Node> & out)
+{
+    const std::string eqp = std::string("EXPLAIN QUERY PLAN ") + sql;
+
+    sqlite3_stmt * stmt;
+    auto ret = sqlite3_prepare_v2(db, eqp.c_str(), -1, &stmt, nullptr);
+    if (ret != SQLITE_OK)
+        return ret;
+
+    // columns: id, parent, notused, detail
+    while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const auto detail = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 3));
+        out.push_back(Node{sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1),
+            detail == nullptr ? std::string() : std::string(detail)});
+    }
+    sqlite3_finalize(stmt);
+    return ret == SQLITE_DONE ? SQLITE_OK : ret;
+}
+
+std::string PlanChecker::dump(const std::vector<Node> & plan)
+{
+    std::string out = "QUERY PLAN\n";
+
+    // rows come in depth-first order, children after their parent
+    auto render = [&plan, &out](auto & self, int parent, const std::string & prefix) -> void
+    {
+        for (std::size_t i = 0; i < plan.size(); i++)
+        {
+            if (plan[i].parent != parent)
+                continue;
+
+            bool last = true;
+            for (std::size_t j = i + 1; j < plan.size() && last; j++)
+                last = plan[j].parent != parent;
+
+            out += prefix;
+            out += last ? "`--" : "|--";
+            out += plan[i].detail;
+            out += '\n';
+            self(self, plan[i].id, prefix + (last ? "   " : "|  "));
+        }
+    };
+    render(render, 0, std::string());
+    return out;
+}
+
+unsigned PlanChecker::classify(std::string_view detail) noexcept
+{
+    using namespace std::string_view_literals;
+
+    if (detail.starts_with("USE TEMP B-TREE"sv))
+        return PlanIssue::TempBTree;
+    if (detail.find("AUTOMATIC "sv) != std::string_view::npos)
+        return PlanIssue::AutoIndex;
+    if (detail.starts_with("SCAN "sv))
+    {
+        // not flagged: one-row selects, subqueries and virtual tables
+        const auto what = detail.substr(5);
+        if (what.starts_with("CONSTANT ROW"sv) || what.starts_with("("sv) ||
+                what.find(" VIRTUAL TABLE"sv) != std::string_view::npos)
+            return 0;
+        // a full pass over an index, sorted or narrower than the table, but still every entry
+        if (what.find(" USING "sv) != std::string_view::npos)
+            return PlanIssue::IndexScan;
+        return PlanIssue::FullScan;
+    }
+    return 0;
+}
+
+void PlanChecker::check(sqlite3 * db, sqlite3_stmt * stmt)
+{
+    const char * sql = sqlite3_sql(stmt);
+    if (this->mode == SQLite3::PlanCheck::Off || sql == nullptr || sqlite3_stmt_isexplain(stmt) != 0)
+        return;
+
+    // no plan (the schema is locked, for instance) is no reason to fail the statement
+    std::vector<Node> plan;
+    if (explain(db, sql, plan) != SQLITE_OK)
+        return;
+
+    // scans of common table expressions read rows the plan has just produced
+    std::vector<std::string_view> produced;
+    for (const auto & node: plan)
+    {
+        std::string_view d = node.detail;
+        for (const auto prefix: {std::string_view("CO-ROUTINE "), std::string_view("MATERIALIZE ")})
+        {
+            if (d.starts_with(prefix))
+                produced.push_back(d.substr(prefix.size()));
+        }
+    }
+    auto is_produced = [&produced](std::string_view detail)
+    {
+        const auto what = detail.substr(5, detail.find(' ', 5) - 5);
+        return std::find(produced.begin(), produced.end(), what) != produced.end();
+    };
+
+    std::vector<PlanIssue> found;
+    for (auto & node: plan)
+    {
+        const auto kind = classify(node.detail) & this->kinds;
+        if (kind == 0 || (kind == PlanIssue::FullScan && is_produced(node.detail)))
+            continue;
+        found.push_back(PlanIssue{static_cast<PlanIssue::Kind>(kind), sql, node.detail});
+    }
+    if (found.empty())
+        return;
+
+    if (this->mode == SQLite3::PlanCheck::Throw)
+        throw QueryPlanError(std::move(found));
+
+    for (auto & issue: found)
+    {
+        if (this->reported.insert(issue.sql + '\0' + issue.detail).second)
+            this->issues.push_back(std::move(issue));
+    }
+}
+
+void SQLite3::setPlanCheck(PlanCheck mode, unsigned kinds) noexcept
+{
+    this->internals->plan_check.setMode(mode, kinds);
+}
+
+SQLite3::PlanCheck SQLite3::getPlanCheck() const noexcept
+{
+    return this->internals->plan_check.getMode();
+}
+
+std::vector<PlanIssue> SQLite3::getPlanIssues() const
+{
+    return this->internals->plan_check.get();
+}
+
+void SQLite3::clearPlanIssues() noexcept
+{
+    this->internals->plan_check.clear();
+}
+
+std::string SQLite3::explainPlan(const char * sql) const
+{
+    std::vector<PlanChecker::Node> plan;
+    const auto ret = PlanChecker::explain(reinterpret_cast<sqlite3*>(this->handle), sql, plan);
+    if (ret != SQLITE_OK)
+        throw SQLite3Error(*this);
+    return PlanChecker::dump(plan);
+}
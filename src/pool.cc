@@ -0,0 +1,142 @@
+#include <sqlite3w_pool.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace hgl;
+
+struct SQLite3Pool::Internals
+{
+    std::vector<std::unique_ptr<SQLite3>> conns; ///< readers, then the writer
+    std::vector<bool>       in_use;
+    std::size_t             free_readers;
+    bool                    affinity;
+    std::mutex              mutex;
+    std::condition_variable reader_cv, writer_cv;
+
+    std::size_t writerSlot() const noexcept { return conns.size() - 1; }
+};
+
+SQLite3Pool::SQLite3Pool(const char * filename, std::size_t readers, bool thread_affinity):
+    internals(new Internals)
+{
+    auto & in = *this->internals;
+    in.affinity = thread_affinity;
+    in.free_readers = readers;
+
+    try
+    {
+        // reader() would hand out the writer instead and could deadlock its holder
+        if (readers == 0)
+            throw std::invalid_argument("SQLite3Pool: no readers");
+
+        // a lease gives one thread exclusive use, so SQLite's own mutexes are not needed
+        SQLite3::OpenOptions writer_opts;
+        writer_opts.flags |= SQLite3::OpenOptions::NoMutex;
+        writer_opts.journal_mode = SQLite3::OpenOptions::Journal::Wal;
+
+        // the writer is opened first so that WAL mode is on before any reader attaches
+        auto writer = std::make_unique<SQLite3>(filename, writer_opts);
+
+        in.conns.reserve(readers + 1);
+        for (std::size_t i = 0; i < readers; i++)
+            in.conns.push_back(std::make_unique<SQLite3>(filename, SQLite3::OpenOptions::readOnly()));
+        in.conns.push_back(std::move(writer));
+        in.in_use.assign(in.conns.size(), false);
+    }
+    catch (...)
+    {
+        delete this->internals;
+        throw;
+    }
+}
+
+SQLite3Pool::~SQLite3Pool()
+{
+    delete this->internals;
+}
+
+SQLite3Pool::Lease SQLite3Pool::reader()
+{
+    auto & in = *this->internals;
+    const auto n = in.conns.size() - 1;
+    const auto pref = in.affinity ?
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % n : 0;
+
+    std::unique_lock<std::mutex> lock(in.mutex);
+    in.reader_cv.wait(lock, [&in] { return in.free_readers != 0; });
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const auto slot = (pref + i) % n;
+        if (!in.in_use[slot])
+        {
+            in.in_use[slot] = true;
+            in.free_readers--;
+            return Lease(this, in.conns[slot].get(), slot);
+        }
+    }
+
+    return Lease(); // unreachable
+}
+
+SQLite3Pool::Lease SQLite3Pool::tryReader()
+{
+    auto & in = *this->internals;
+    const auto n = in.conns.size() - 1;
+
+    const auto pref = in.affinity ?
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % n : 0;
+
+    std::lock_guard<std::mutex> lock(in.mutex);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const auto slot = (pref + i) % n;
+        if (!in.in_use[slot])
+        {
+            in.in_use[slot] = true;
+            in.free_readers--;
+            return Lease(this, in.conns[slot].get(), slot);
+        }
+    }
+
+    return Lease();
+}
+
+SQLite3Pool::Lease SQLite3Pool::writer()
+{
+    auto & in = *this->internals;
+    const auto slot = in.writerSlot();
+
+    std::unique_lock<std::mutex> lock(in.mutex);
+    in.writer_cv.wait(lock, [&in, slot] { return !in.in_use[slot]; });
+    in.in_use[slot] = true;
+    return Lease(this, in.conns[slot].get(), slot);
+}
+
+std::size_t SQLite3Pool::readerCount() const noexcept
+{
+    return this->internals->conns.size() - 1;
+}
+
+void SQLite3Pool::_release(std::size_t slot) noexcept
+{
+    auto & in = *this->internals;
+
+    {
+        std::lock_guard<std::mutex> lock(in.mutex);
+        in.in_use[slot] = false;
+        if (slot != in.writerSlot())
+            in.free_readers++;
+    }
+
+    if (slot == in.writerSlot())
+        in.writer_cv.notify_one();
+    else
+        in.reader_cv.notify_one();
+}
@@ -0,0 +1,226 @@
+#include "internal.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace hgl;
+
+static void _add_status(std::uint64_t & counter, sqlite3_stmt * stmt, int op)
+{
+    counter += static_cast<std::uint64_t>(sqlite3_stmt_status(stmt, op, 1));
+}
+
+StmtProfile & Profiler::lookup(sqlite3_stmt * stmt)
+{
+    const char * sql = sqlite3_sql(stmt);
+    // a finalized statement's addresses may be reused by another one: confirm by text
+    if (stmt == this->last_stmt && sql == this->last_sql &&
+            (sql == nullptr || std::strcmp(sql, this->last_profile->sql.c_str()) == 0))
+        return *this->last_profile;
+
+    auto & prof = this->profiles[sql == nullptr ? std::string() : std::string(sql)];
+    if (prof.sql.empty() && sql != nullptr)
+        prof.sql = sql;
+
+    this->last_stmt = stmt;
+    this->last_sql = sql;
+    this->last_profile = &prof;
+    return prof;
+}
+
+int Profiler::callback(unsigned int type, void * ctx, void * p, void *)
+{
+    auto self = static_cast<Profiler *>(ctx);
+    auto stmt = static_cast<sqlite3_stmt *>(p);
+    if (sqlite3_stmt_isexplain(stmt) == 2) // EXPLAIN QUERY PLAN, e.g. of SQLite3::setPlanCheck()
+        return 0;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        auto & prof = self->lookup(stmt);
+
+        if (type == SQLITE_TRACE_ROW)
+        {
+            prof.rows++;
+            return 0;
+        }
+
+        // SQLITE_TRACE_PROFILE; its run time has only millisecond resolution,
+        // so latencies are measured by recordStep() instead
+        prof.runs++;
+        _add_status(prof.fullscan_steps, stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP);
+        _add_status(prof.sorts, stmt, SQLITE_STMTSTATUS_SORT);
+        _add_status(prof.autoindexes, stmt, SQLITE_STMTSTATUS_AUTOINDEX);
+        _add_status(prof.vm_steps, stmt, SQLITE_STMTSTATUS_VM_STEP);
+    }
+    catch (...)
+    {
+    }
+
+    return 0;
+}
+
+void Profiler::recordStep(sqlite3_stmt * stmt, std::uint64_t ns) noexcept
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto & prof = this->lookup(stmt);
+
+        prof.steps++;
+        prof.total_ns += ns;
+        if (ns > prof.max_ns)
+            prof.max_ns = ns;
+
+        std::size_t bucket = 0;
+        for (auto us = ns / 1000; us != 0 && bucket + 1 < StmtProfile::buckets; us >>= 1)
+            bucket++;
+        prof.histogram[bucket]++;
+    }
+    catch (...)
+    {
+    }
+}
+
+void Profiler::install(sqlite3 * db) noexcept
+{
+    if (db == nullptr)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->last_stmt = nullptr; // statement addresses of another connection
+    }
+
+    if (this->enabled)
+        sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &Profiler::callback, this);
+    else
+        sqlite3_trace_v2(db, 0, nullptr, nullptr);
+}
+
+StmtProfile Profiler::get(const char * sql) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (sql != nullptr)
+    {
+        auto const it = this->profiles.find(sql);
+        if (it != this->profiles.end())
+            return it->second;
+    }
+
+    StmtProfile prof{};
+    if (sql != nullptr)
+        prof.sql = sql;
+    return prof;
+}
+
+std::vector<StmtProfile> Profiler::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::vector<StmtProfile> result;
+    result.reserve(this->profiles.size());
+    for (auto & [sql, prof]: this->profiles)
+        result.push_back(prof);
+    return result;
+}
+
+void Profiler::reset() noexcept
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->profiles.clear();
+    this->last_stmt = nullptr;
+}
+
+
+static void _json_string(std::string & out, std::string_view s)
+{
+    out.push_back('"');
+    for (const char c: s)
+    {
+        switch (c)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char esc[8];
+                std::snprintf(esc, sizeof esc, "\\u%04x", c);
+                out += esc;
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void SQLite3::setProfiling(bool enable) noexcept
+{
+    this->internals->profiler.enable(reinterpret_cast<sqlite3*>(this->handle), enable);
+}
+
+bool SQLite3::isProfiling() const noexcept
+{
+    return this->internals->profiler.isEnabled();
+}
+
+std::vector<StmtProfile> SQLite3::getProfile() const
+{
+    return this->internals->profiler.snapshot();
+}
+
+std::string SQLite3::getProfileJSON() const
+{
+    std::string out = "[";
+
+    bool first = true;
+    for (auto & prof: this->getProfile())
+    {
+        if (!first)
+            out.push_back(',');
+        first = false;
+
+        out += "{\"sql\":";
+        _json_string(out, prof.sql);
+        out += ",\"runs\":" + std::to_string(prof.runs);
+        out += ",\"rows\":" + std::to_string(prof.rows);
+        out += ",\"steps\":" + std::to_string(prof.steps);
+        out += ",\"total_ns\":" + std::to_string(prof.total_ns);
+        out += ",\"max_ns\":" + std::to_string(prof.max_ns);
+        out += ",\"fullscan_steps\":" + std::to_string(prof.fullscan_steps);
+        out += ",\"sorts\":" + std::to_string(prof.sorts);
+        out += ",\"autoindexes\":" + std::to_string(prof.autoindexes);
+        out += ",\"vm_steps\":" + std::to_string(prof.vm_steps);
+        out += ",\"histogram_us\":[";
+        for (std::size_t i = 0; i < StmtProfile::buckets; i++)
+        {
+            if (i != 0)
+                out.push_back(',');
+            out += std::to_string(prof.histogram[i]);
+        }
+        out += "]}";
+    }
+
+    out.push_back(']');
+    return out;
+}
+
+void SQLite3::resetProfile() noexcept
+{
+    this->internals->profiler.reset();
+}
+
+StmtProfile SQLite3Stmt::getProfile() const
+{
+    return this->database.internals->profiler.get(
+        sqlite3_sql(reinterpret_cast<sqlite3_stmt*>(this->handle)));
+}
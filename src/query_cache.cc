@@ -0,0 +1,399 @@
+#include "internal.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace hgl;
+
+std::size_t QueryCache::tableId(const char * name)
+{
+    for (std::size_t i = 0; i < this->tables.size(); i++)
+    {
+        if (this->tables[i].name == name)
+            return i;
+    }
+    this->tables.push_back(Table{name, 0, -1});
+    return this->tables.size() - 1;
+}
+
+std::size_t QueryCache::footprint(const Entry & e) noexcept
+{
+    return sizeof(Entry) + e.key.size() + e.rows.size() +
+        e.deps.size() * sizeof(e.deps[0]) + 4 * sizeof(void *); // list node and index slot
+}
+
+void QueryCache::erase(std::list<Entry>::iterator it) noexcept
+{
+    this->bytes -= footprint(*it);
+    this->index.erase(it->key);
+    this->entries.erase(it);
+}
+
+void QueryCache::shrink() noexcept
+{
+    while (this->bytes > this->budget && !this->entries.empty())
+    {
+        this->erase(std::prev(this->entries.end()));
+        this->evictions++;
+    }
+}
+
+void QueryCache::setBudget(std::size_t b) noexcept
+{
+    this->budget = b;
+    if (b == 0)
+        this->clear();
+    else
+        this->shrink();
+}
+
+void QueryCache::clear() noexcept
+{
+    this->index.clear();
+    this->entries.clear();
+    this->plans.clear();
+    this->bytes = 0;
+    for (auto & t: this->tables)
+        t.without_rowid = -1; // DDL may have replaced the table
+}
+
+bool QueryCache::find(const std::string & key, int columns,
+        void (*sink)(void *, const SQLite3Stmt::Value *), void * ctx)
+{
+    const auto found = this->index.find(key);
+    if (found == this->index.end())
+    {
+        this->misses++;
+        return false;
+    }
+
+    const auto it = found->second;
+    for (const auto & [table, generation]: it->deps)
+    {
+        if (this->tables[table].generation != generation)
+        {
+            this->erase(it);
+            this->stale++;
+            this->misses++;
+            return false;
+        }
+    }
+
+    this->entries.splice(this->entries.begin(), this->entries, it);
+    this->hits++;
+
+    SQLite3Stmt::Value small[16];
+    std::vector<SQLite3Stmt::Value> large;
+    auto vals = small;
+    if (columns > 16)
+    {
+        large.resize(columns);
+        vals = large.data();
+    }
+
+    const char * p = it->rows.data();
+    for (std::size_t r = 0; r < it->row_count; r++)
+    {
+        for (int c = 0; c < columns; c++)
+        {
+            auto & v = vals[c];
+            v = SQLite3Stmt::Value{static_cast<SQLite3Stmt::Type>(*p++), 0, 0.0, nullptr, 0};
+            switch (v.type)
+            {
+            case SQLite3Stmt::Type::Integer:
+                std::memcpy(&v.i, p, sizeof v.i);
+                p += sizeof v.i;
+                break;
+
+            case SQLite3Stmt::Type::Float:
+                std::memcpy(&v.f, p, sizeof v.f);
+                p += sizeof v.f;
+                break;
+
+            case SQLite3Stmt::Type::Text:
+            case SQLite3Stmt::Type::Blob:
+                std::memcpy(&v.n, p, sizeof v.n);
+                p += sizeof v.n;
+                v.p = p;
+                p += v.n + 1; // text is stored null-terminated
+                break;
+
+            default:
+                break;
+            }
+        }
+        sink(ctx, vals);
+    }
+    return true;
+}
+
+void QueryCache::encode(std::string & rows, const SQLite3Stmt::Value * vals, int columns)
+{
+    for (int c = 0; c < columns; c++)
+    {
+        const auto & v = vals[c];
+        rows.push_back(static_cast<char>(v.type));
+        switch (v.type)
+        {
+        case SQLite3Stmt::Type::Integer:
+            rows.append(reinterpret_cast<const char *>(&v.i), sizeof v.i);
+            break;
+
+        case SQLite3Stmt::Type::Float:
+            rows.append(reinterpret_cast<const char *>(&v.f), sizeof v.f);
+            break;
+
+        case SQLite3Stmt::Type::Text:
+        case SQLite3Stmt::Type::Blob:
+            rows.append(reinterpret_cast<const char *>(&v.n), sizeof v.n);
+            rows.append(v.n == 0 ? "" : static_cast<const char *>(v.p), v.n);
+            rows.push_back('\0');
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+const std::vector<std::size_t> * QueryCache::plan(const char * sql) const
+{
+    const auto found = this->plans.find(sql);
+    return found == this->plans.end() ? nullptr : &found->second;
+}
+
+void QueryCache::setPlan(const char * sql, std::vector<std::size_t> && tables)
+{
+    this->plans.insert_or_assign(sql, std::move(tables));
+}
+
+void QueryCache::store(std::string && key, std::string && rows, std::size_t row_count,
+        const std::vector<std::size_t> & plan)
+{
+    if (!this->enabled())
+        return;
+
+    Entry e{std::move(key), std::move(rows), row_count, {}};
+    e.deps.reserve(plan.size());
+    for (const auto table: plan)
+        e.deps.emplace_back(table, this->tables[table].generation);
+
+    const auto size = footprint(e);
+    if (size > this->budget)
+        return;
+
+    const auto found = this->index.find(e.key);
+    if (found != this->index.end())
+        this->erase(found->second);
+
+    this->entries.push_front(std::move(e));
+    this->index.emplace(this->entries.front().key, this->entries.begin());
+    this->bytes += size;
+    this->stores++;
+    this->shrink();
+}
+
+bool QueryCache::cacheable(sqlite3 * db, const std::vector<std::size_t> & plan) noexcept
+{
+    for (const auto id: plan)
+    {
+        auto & t = this->tables[id];
+        if (t.without_rowid < 0)
+        {
+            sqlite3_stmt * stmt;
+            if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_list WHERE name = ? AND wr",
+                    -1, &stmt, nullptr) != SQLITE_OK)
+                return false;
+            sqlite3_bind_text(stmt, 1, t.name.c_str(), static_cast<int>(t.name.size()), SQLITE_STATIC);
+            const auto res = sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+            if (res != SQLITE_ROW && res != SQLITE_DONE)
+                return false;
+            t.without_rowid = res == SQLITE_ROW;
+        }
+        if (t.without_rowid)
+            return false;
+    }
+    return true;
+}
+
+void QueryCache::invalidate(const char * table) noexcept
+{
+    for (auto & t: this->tables)
+    {
+        if (t.name == table)
+        {
+            t.generation++;
+            return;
+        }
+    }
+}
+
+bool QueryCache::endCapture() noexcept
+{
+    const bool ok = this->capture_ok;
+    this->capture = nullptr;
+    return ok;
+}
+
+void QueryCache::authorize(int action, const char * arg) noexcept
+{
+    if (!this->enabled())
+        return;
+
+    switch (action)
+    {
+    case SQLITE_READ:
+        if (this->capture != nullptr && arg != nullptr)
+        {
+            try
+            {
+                const auto id = this->tableId(arg);
+                if (std::find(this->capture->begin(), this->capture->end(), id) == this->capture->end())
+                    this->capture->push_back(id);
+            }
+            catch (...)
+            {
+                this->capture_ok = false;
+            }
+        }
+        break;
+
+    case SQLITE_CREATE_INDEX: case SQLITE_CREATE_TABLE: case SQLITE_CREATE_TEMP_INDEX:
+    case SQLITE_CREATE_TEMP_TABLE: case SQLITE_CREATE_TEMP_TRIGGER: case SQLITE_CREATE_TEMP_VIEW:
+    case SQLITE_CREATE_TRIGGER: case SQLITE_CREATE_VIEW: case SQLITE_DROP_INDEX:
+    case SQLITE_DROP_TABLE: case SQLITE_DROP_TEMP_INDEX: case SQLITE_DROP_TEMP_TABLE:
+    case SQLITE_DROP_TEMP_TRIGGER: case SQLITE_DROP_TEMP_VIEW: case SQLITE_DROP_TRIGGER:
+    case SQLITE_DROP_VIEW: case SQLITE_ATTACH: case SQLITE_DETACH: case SQLITE_ALTER_TABLE:
+    case SQLITE_CREATE_VTABLE: case SQLITE_DROP_VTABLE:
+        // checked when the DDL is compiled, which comes before it runs
+        this->clear();
+        break;
+
+    default:
+        break;
+    }
+}
+
+SQLite3::QueryCacheStats QueryCache::stats() const noexcept
+{
+    return SQLite3::QueryCacheStats{
+        this->hits, this->misses, this->stores, this->stale, this->evictions,
+        this->entries.size(), this->bytes, this->budget,
+    };
+}
+
+
+void SQLite3::_query_key(std::string & key, const char * sql, const SQLite3Stmt::Type * types, int columns)
+{
+    key.append(sql);
+    key.push_back('\0');
+    for (int c = 0; c < columns; c++)
+        key.push_back(static_cast<char>(types[c]));
+    key.push_back('\0');
+}
+
+void SQLite3::_cached_query(const char * sql, std::string & key, const SQLite3Stmt::Type * types, int columns,
+        void (*bind)(void * ctx, SQLite3Stmt & stmt), void * bind_ctx,
+        void (*sink)(void * ctx, const SQLite3Stmt::Value * vals), void * sink_ctx)
+{
+    auto & cache = this->internals->query_cache;
+
+    auto run = [=](SQLite3Stmt & stmt, std::string * rows, std::size_t * row_count)
+    {
+        if (stmt.handle == nullptr)
+            return; // no statement in `sql`
+
+        bind(bind_ctx, stmt);
+        std::vector<SQLite3Stmt::Value> vals(columns);
+        for (bool more = stmt._step(); more; more = stmt._step())
+        {
+            stmt._fetch_row(types, vals.data(), columns);
+            if (rows != nullptr)
+            {
+                QueryCache::encode(*rows, vals.data(), columns);
+                ++*row_count;
+            }
+            sink(sink_ctx, vals.data());
+        }
+    };
+
+    // uncommitted changes could still be rolled back, without update hook calls
+    if (!cache.enabled() || this->inTransaction())
+    {
+        SQLite3Stmt stmt(*this, sql);
+        run(stmt, nullptr, nullptr);
+        return;
+    }
+
+    if (cache.find(key, columns, sink, sink_ctx))
+        return;
+
+    auto run_and_store = [&](SQLite3Stmt & stmt, std::vector<std::size_t> tables)
+    {
+        if ((stmt.handle != nullptr && !sqlite3_stmt_readonly(reinterpret_cast<sqlite3_stmt*>(stmt.handle))) ||
+                !cache.cacheable(reinterpret_cast<sqlite3*>(this->handle), tables))
+        {
+            run(stmt, nullptr, nullptr);
+            return;
+        }
+
+        std::string rows;
+        std::size_t row_count = 0;
+        run(stmt, &rows, &row_count);
+        cache.store(std::move(key), std::move(rows), row_count, tables);
+    };
+
+    if (const auto plan = cache.plan(sql); plan != nullptr)
+    {
+        SQLite3Stmt stmt(*this, sql);
+        run_and_store(stmt, *plan);
+        return;
+    }
+
+    // compile afresh, whatever the statement cache holds, so that the
+    // authorizer reports the tables read
+    std::vector<std::size_t> tables;
+    cache.beginCapture(tables);
+    const char * tail = nullptr;
+    std::unique_ptr<SQLite3Stmt> stmt;
+    try
+    {
+        stmt.reset(new SQLite3Stmt(*this, sql, &tail, this->internals->stmt_cache.enabled()));
+    }
+    catch (...)
+    {
+        cache.endCapture();
+        throw;
+    }
+
+    if (!cache.endCapture())
+    {
+        run(*stmt, nullptr, nullptr);
+        return;
+    }
+    cache.setPlan(sql, std::vector<std::size_t>(tables));
+    run_and_store(*stmt, std::move(tables));
+}
+
+void SQLite3::enableQueryCache(std::size_t budget)
+{
+    this->internals->query_cache.setBudget(budget);
+    this->internals->installHooks(reinterpret_cast<sqlite3*>(this->handle));
+}
+
+void SQLite3::disableQueryCache() noexcept
+{
+    this->internals->query_cache.setBudget(0);
+    this->internals->installHooks(reinterpret_cast<sqlite3*>(this->handle));
+}
+
+void SQLite3::clearQueryCache() noexcept
+{
+    this->internals->query_cache.clear();
+}
+
+SQLite3::QueryCacheStats SQLite3::getQueryCacheStats() const noexcept
+{
+    return this->internals->query_cache.stats();
+}
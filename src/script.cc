@@ -0,0 +1,104 @@
+#include "internal.h"
+
+using namespace hgl;
+
+SQLite3Stmt::SQLite3Stmt(const SQLite3 & db, const char * sql, const char ** tail, bool persistent):
+    handle(nullptr), database(db), occupied(false), done(false), internals(nullptr)
+{
+    auto prepare = [&db, sql, tail, persistent, this]
+    {
+        return sqlite3_prepare_v3(
+            reinterpret_cast<sqlite3*>(db.handle), sql, -1,
+            persistent ? SQLITE_PREPARE_PERSISTENT : 0,
+            reinterpret_cast<sqlite3_stmt**>(&this->handle), tail);
+    };
+
+    db.internals->changes.preparing();
+    auto ret = prepare();
+    if (ret == SQLITE_BUSY) // schema locked by another connection
+        ret = db.internals->busy.retry(prepare);
+    db.internals->busy.settle(ret);
+    db.internals->changes.prepared(reinterpret_cast<sqlite3_stmt*>(this->handle));
+    if (ret != SQLITE_OK)
+    {
+        this->handle = nullptr;
+        throw SQLite3Error(this->database);
+    }
+
+    if (db.internals->plan_check.enabled())
+    {
+        try
+        {
+            db.internals->plan_check.check(reinterpret_cast<sqlite3*>(db.handle),
+                reinterpret_cast<sqlite3_stmt*>(this->handle));
+        }
+        catch (...)
+        {
+            db.internals->changes.forget(reinterpret_cast<sqlite3_stmt*>(this->handle));
+            sqlite3_finalize(reinterpret_cast<sqlite3_stmt*>(this->handle));
+            this->handle = nullptr;
+            throw;
+        }
+    }
+
+    // execScript() looks its statements up again by their own text
+    if (persistent && this->handle != nullptr)
+    {
+        auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+        db.internals->stmt_cache.adopt(stmt, sqlite3_sql(stmt));
+    }
+}
+
+void SQLite3::_exec_script(const char * script, bool cache, int columns,
+        void (*visit)(void * ctx, SQLite3Stmt & stmt), void * ctx)
+{
+    auto run = [columns, visit, ctx](SQLite3Stmt & stmt)
+    {
+        auto row = stmt._step();
+        if (row && visit != nullptr && (columns < 0 ||
+                sqlite3_column_count(reinterpret_cast<sqlite3_stmt*>(stmt.handle)) == columns))
+            visit(ctx, stmt);
+        else if (row)
+        {
+            while (stmt._step());
+            stmt.reset();
+        }
+    };
+
+    auto & scripts = this->internals->scripts;
+    if (cache)
+    {
+        // known script: its statements are looked up in the statement cache by text
+        const auto it = scripts.find(script);
+        if (it != scripts.end())
+        {
+            for (const auto & piece: it->second)
+            {
+                SQLite3Stmt stmt(*this, piece.c_str());
+                run(stmt);
+            }
+            return;
+        }
+    }
+
+    std::vector<std::string> pieces;
+    for (const char * rest = script; rest != nullptr && *rest != '\0'; )
+    {
+        const char * tail = nullptr;
+        SQLite3Stmt stmt(*this, rest, &tail, cache && this->internals->stmt_cache.enabled());
+        rest = tail;
+        if (stmt.handle == nullptr)
+            continue; // whitespace or comment
+
+        if (cache)
+            pieces.emplace_back(sqlite3_sql(reinterpret_cast<sqlite3_stmt*>(stmt.handle)));
+        run(stmt);
+    }
+
+    if (cache)
+    {
+        if (scripts.size() >= Internals::script_cache_capacity)
+            scripts.clear();
+        scripts.emplace(script, std::move(pieces));
+    }
+}
@@ -0,0 +1,144 @@
+#include <sqlite3w_shard.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <latch>
+#include <memory>
+#include <thread>
+
+using namespace hgl;
+
+struct _ShardSet::Internals
+{
+    std::vector<std::unique_ptr<SQLite3>> shards;
+    std::deque<std::mutex>                locks;   ///< one per shard
+
+    std::vector<std::thread>              workers;
+    std::deque<std::function<void()>>     jobs;
+    std::mutex                            jobs_mutex;
+    std::condition_variable               jobs_cv;
+    bool                                  stopping = false;
+
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(this->jobs_mutex);
+                this->jobs_cv.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+                if (this->jobs.empty())
+                    return;
+                job = std::move(this->jobs.front());
+                this->jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    void stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->jobs_mutex);
+            this->stopping = true;
+        }
+        this->jobs_cv.notify_all();
+        for (auto & th: this->workers)
+            th.join();
+        this->workers.clear();
+    }
+};
+
+_ShardSet::_ShardSet(const std::vector<std::string> & filenames, std::size_t threads,
+    const SQLite3::OpenOptions & opts):
+    internals(new Internals)
+{
+    auto & in = *this->internals;
+    try
+    {
+        if (filenames.empty())
+            throw std::invalid_argument("_ShardSet: no shards");
+
+        in.shards.reserve(filenames.size());
+        for (auto & name: filenames)
+        {
+            in.shards.push_back(std::make_unique<SQLite3>(name.c_str(), opts));
+            in.locks.emplace_back();
+        }
+
+        if (threads == 0)
+            threads = filenames.size();
+        for (std::size_t i = 0; i < threads; i++)
+            in.workers.emplace_back(&Internals::work, this->internals);
+    }
+    catch (...)
+    {
+        in.stop();
+        delete this->internals;
+        throw;
+    }
+}
+
+_ShardSet::~_ShardSet()
+{
+    this->internals->stop();
+    delete this->internals;
+}
+
+std::size_t _ShardSet::shardCount() const noexcept
+{
+    return this->internals->shards.size();
+}
+
+SQLite3 & _ShardSet::shard(std::size_t shard) const noexcept
+{
+    return *this->internals->shards[shard];
+}
+
+std::mutex & _ShardSet::_lock(std::size_t shard) const noexcept
+{
+    return this->internals->locks[shard];
+}
+
+void _ShardSet::_scatter(const std::function<void(std::size_t, SQLite3 &)> & job)
+{
+    auto & in = *this->internals;
+    const auto n = in.shards.size();
+
+    std::latch done(static_cast<std::ptrdiff_t>(n));
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    {
+        std::lock_guard<std::mutex> lock(in.jobs_mutex);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            in.jobs.emplace_back([&, i]
+            {
+                try
+                {
+                    std::lock_guard<std::mutex> shard_lock(in.locks[i]);
+                    job(i, *in.shards[i]);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> error_lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                done.count_down();
+            });
+        }
+    }
+    in.jobs_cv.notify_all();
+
+    done.wait();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void _ShardSet::executeAll(const char * stmts)
+{
+    this->_scatter([stmts](std::size_t, SQLite3 & db) { db(stmts); });
+}
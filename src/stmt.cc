@@ -1,85 +1,289 @@
-#include <sqlite3w.h>
+#include "internal.h"
 
 #include <chrono>
 #include <cstring>
-#include <thread>
-#include <sqlite3.h>
 
 using namespace hgl;
 
 SQLite3Stmt::SQLite3Stmt(const SQLite3 & db, const char * stmt):
-    database(db), occupied(false)
+    database(db), occupied(false), done(false), internals(nullptr)
 {
-    const auto ret = sqlite3_prepare_v2(
-        reinterpret_cast<sqlite3*>(db.handle), stmt, -1,
-        reinterpret_cast<sqlite3_stmt**>(&this->handle), nullptr);
+    auto & cache = db.internals->stmt_cache;
+
+    std::unique_ptr<NameIndex> names;
+    this->handle = cache.take(stmt, names);
+    if (this->handle != nullptr)
+    {
+        if (names != nullptr)
+        {
+            this->internals = new Internals;
+            this->internals->names = std::move(names);
+        }
+        return;
+    }
+
+    auto prepare = [&db, stmt, &cache, this]
+    {
+        return sqlite3_prepare_v3(
+            reinterpret_cast<sqlite3*>(db.handle), stmt, -1,
+            cache.enabled() ? SQLITE_PREPARE_PERSISTENT : 0,
+            reinterpret_cast<sqlite3_stmt**>(&this->handle), nullptr);
+    };
+
+    db.internals->changes.preparing();
+    auto ret = prepare();
+    if (ret == SQLITE_BUSY) // schema locked by another connection
+        ret = db.internals->busy.retry(prepare);
+    db.internals->busy.settle(ret);
+    db.internals->changes.prepared(reinterpret_cast<sqlite3_stmt*>(this->handle));
     if (ret != SQLITE_OK)
     {
         this->handle = nullptr;
         throw SQLite3Error(this->database);
     }
+
+    if (db.internals->plan_check.enabled())
+    {
+        try
+        {
+            db.internals->plan_check.check(reinterpret_cast<sqlite3*>(db.handle),
+                reinterpret_cast<sqlite3_stmt*>(this->handle));
+        }
+        catch (...)
+        {
+            db.internals->changes.forget(reinterpret_cast<sqlite3_stmt*>(this->handle));
+            sqlite3_finalize(reinterpret_cast<sqlite3_stmt*>(this->handle));
+            this->handle = nullptr;
+            throw;
+        }
+    }
+
+    if (this->handle != nullptr)
+        cache.adopt(reinterpret_cast<sqlite3_stmt*>(this->handle), stmt);
 }
 
 SQLite3Stmt::~SQLite3Stmt()
 {
     if (this->handle == nullptr)
+    {
+        delete this->internals;
         return;
+    }
 
-    sqlite3_finalize(reinterpret_cast<sqlite3_stmt*>(this->handle));
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    std::unique_ptr<NameIndex> names;
+    if (this->internals != nullptr)
+        names = std::move(this->internals->names);
+    if (sqlite3_db_handle(stmt) != this->database.handle ||
+            !this->database.internals->stmt_cache.put(stmt, std::move(names)))
+    {
+        this->database.internals->changes.forget(stmt);
+        sqlite3_finalize(stmt);
+    }
     this->handle = nullptr;
+
+    delete this->internals;
+    this->internals = nullptr;
 }
 
-void SQLite3Stmt::bindInteger(int col, std::int64_t v)
+SQLite3Status SQLite3Stmt::tryBindInteger(int col, std::int64_t v) noexcept
 {
     auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
-    auto const res = sqlite3_bind_int64(stmt, col, v);
-    if (res != SQLITE_OK) throw SQLite3Error(this->database);
+    return SQLite3Status(sqlite3_bind_int64(stmt, col, v), &this->database);
 }
 
-void SQLite3Stmt::bindFloat(int col, double v)
+SQLite3Status SQLite3Stmt::tryBindFloat(int col, double v) noexcept
 {
     auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
-    auto const res = sqlite3_bind_double(stmt, col, v);
-    if (res != SQLITE_OK) throw SQLite3Error(this->database);
+    return SQLite3Status(sqlite3_bind_double(stmt, col, v), &this->database);
 }
 
-void SQLite3Stmt::bindText(int col, const char * v)
+SQLite3Status SQLite3Stmt::tryBindNull(int col) noexcept
 {
     auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
-    auto const res = sqlite3_bind_text(stmt, col, v, std::strlen(v), SQLITE_STATIC);
-    if (res != SQLITE_OK) throw SQLite3Error(this->database);
+    return SQLite3Status(sqlite3_bind_null(stmt, col), &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindText(int col, const char * v) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    return SQLite3Status(sqlite3_bind_text(stmt, col, v, -1, SQLITE_STATIC), &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindText(int col, std::string_view v, Lifetime life) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    auto const res = sqlite3_bind_text64(stmt, col,
+        v.data() == nullptr ? "" : v.data(), v.size(),
+        life == Lifetime::Static ? SQLITE_STATIC : SQLITE_TRANSIENT, SQLITE_UTF8);
+    return SQLite3Status(res, &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindText(int col, std::string && v)
+{
+    auto slot = this->_owned_slot(col);
+    if (slot == nullptr)
+        return SQLite3Status(SQLITE_RANGE);
+    *slot = std::move(v);
+    return this->tryBindText(col, std::string_view(*slot), Lifetime::Static);
+}
+
+SQLite3Status SQLite3Stmt::tryBindText(int col, const char * v, std::size_t n, Destructor destructor) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    // SQLite calls the destructor itself, even when binding fails
+    return SQLite3Status(sqlite3_bind_text64(stmt, col, v, n, destructor, SQLITE_UTF8), &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindBlob(int col, std::span<const std::byte> v, Lifetime life) noexcept
+{
+    if (v.data() == nullptr)
+        return this->tryBindZeroBlob(col, 0); // a null pointer would bind NULL
+
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    auto const res = sqlite3_bind_blob64(stmt, col, v.data(), v.size(),
+        life == Lifetime::Static ? SQLITE_STATIC : SQLITE_TRANSIENT);
+    return SQLite3Status(res, &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindBlob(int col, std::string && v)
+{
+    auto slot = this->_owned_slot(col);
+    if (slot == nullptr)
+        return SQLite3Status(SQLITE_RANGE);
+    *slot = std::move(v);
+    return this->tryBindBlob(col, std::as_bytes(std::span<const char>(*slot)), Lifetime::Static);
+}
+
+SQLite3Status SQLite3Stmt::tryBindBlob(int col, const void * v, std::size_t n, Destructor destructor) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    return SQLite3Status(sqlite3_bind_blob64(stmt, col, v, n, destructor), &this->database);
+}
+
+SQLite3Status SQLite3Stmt::tryBindZeroBlob(int col, std::size_t n) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    return SQLite3Status(sqlite3_bind_zeroblob64(stmt, col, n), &this->database);
+}
+
+std::string * SQLite3Stmt::_owned_slot(int col)
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    const auto count = sqlite3_bind_parameter_count(stmt);
+    if (col < 1 || col > count)
+        return nullptr;
+
+    if (this->internals == nullptr)
+        this->internals = new Internals;
+    // sized once: the vector must never reallocate under bound pointers
+    auto & owned = this->internals->owned;
+    if (owned.empty())
+        owned.resize(count);
+    return &owned[col - 1];
+}
+
+void SQLite3Stmt::bindInteger(int col, std::int64_t v)
+{
+    this->tryBindInteger(col, v).check();
+}
+
+void SQLite3Stmt::bindFloat(int col, double v)
+{
+    this->tryBindFloat(col, v).check();
+}
+
+void SQLite3Stmt::bindNull(int col)
+{
+    this->tryBindNull(col).check();
+}
+
+void SQLite3Stmt::bindText(int col, const char * v)
+{
+    this->tryBindText(col, v).check();
+}
+
+void SQLite3Stmt::bindText(int col, std::string_view v, Lifetime life)
+{
+    this->tryBindText(col, v, life).check();
+}
+
+void SQLite3Stmt::bindText(int col, std::string && v)
+{
+    this->tryBindText(col, std::move(v)).check();
+}
+
+void SQLite3Stmt::bindText(int col, const char * v, std::size_t n, Destructor destructor)
+{
+    this->tryBindText(col, v, n, destructor).check();
+}
+
+void SQLite3Stmt::bindBlob(int col, std::span<const std::byte> v, Lifetime life)
+{
+    this->tryBindBlob(col, v, life).check();
+}
+
+void SQLite3Stmt::bindBlob(int col, std::string && v)
+{
+    this->tryBindBlob(col, std::move(v)).check();
+}
+
+void SQLite3Stmt::bindBlob(int col, const void * v, std::size_t n, Destructor destructor)
+{
+    this->tryBindBlob(col, v, n, destructor).check();
+}
+
+void SQLite3Stmt::bindZeroBlob(int col, std::size_t n)
+{
+    this->tryBindZeroBlob(col, n).check();
 }
 
 
 void SQLite3Stmt::reset() noexcept
 {
     this->occupied = false;
-    sqlite3_reset(reinterpret_cast<sqlite3_stmt*>(this->handle));
+    this->done = false;
+    // the commit of an autocommit statement left unfinished happens here
+    const auto res = sqlite3_reset(reinterpret_cast<sqlite3_stmt*>(this->handle));
+    this->database.internals->changes.settle(reinterpret_cast<sqlite3*>(this->database.handle), res);
 }
 
 
-bool SQLite3Stmt::_step()
+SQLite3Result<bool> SQLite3Stmt::tryStep()
 {
     if (!*this)
         return false;
 
-    int retry_cnt = 0, res;
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    auto db = reinterpret_cast<sqlite3*>(this->database.handle);
+    auto & profiler = this->database.internals->profiler;
+    auto & changes = this->database.internals->changes;
+    const auto changes_mark = changes.enabled() ? changes.markStep(db) : ChangeLog::StepMark{0, 0};
+    int res;
+
+    if (profiler.isEnabled())
+    {
+        using clock = std::chrono::steady_clock;
+        const auto t0 = clock::now();
+        res = sqlite3_step(stmt);
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0);
+        profiler.recordStep(stmt, static_cast<std::uint64_t>(ns.count()));
+    }
+    else
+    {
+        res = sqlite3_step(stmt);
+    }
 
-_L_START:
-    res = sqlite3_step(reinterpret_cast<sqlite3_stmt*>(this->handle));
+    if (res == SQLITE_BUSY)
+        res = this->database.internals->busy.retry([stmt] { return sqlite3_step(stmt); });
+    this->database.internals->busy.settle(res);
+    this->done = res == SQLITE_DONE;
+    changes.settle(db, res);
+    if (changes.enabled())
+        changes.stepped(stmt, res);
 
     switch (res)
     {
-    case SQLITE_BUSY:
-        if (++retry_cnt < 16)
-        {
-            using std::this_thread::sleep_for;
-            using std::chrono::milliseconds;
-            sleep_for(milliseconds(250));
-            goto _L_START;
-        }
-        throw SQLite3Error(this->database);
-
     case SQLITE_ROW:
         return true;
 
@@ -87,10 +291,134 @@ _L_START:
         return false;
 
     default:
-        throw SQLite3Error(this->database);
+        if (changes.enabled())
+            changes.stepFailed(db, changes_mark);
+        return SQLite3Status(res, &this->database);
     }
 }
 
+bool SQLite3Stmt::_step()
+{
+    auto const res = this->tryStep();
+    res.error().check();
+    return *res;
+}
+
+
+bool SQLite3Stmt::_has_row() const noexcept
+{
+    return sqlite3_stmt_busy(reinterpret_cast<sqlite3_stmt*>(this->handle));
+}
+
+bool SQLite3Stmt::_start()
+{
+    if (this->_has_row())
+        return true;
+    // already run to the end: stepping again would run the statement again
+    if (this->done)
+        return false;
+    return this->_step();
+}
+
+void SQLite3Stmt::_fetch_row(const Type * types, Value * out, int n) noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+
+    for (int col = 0; col < n; col++)
+    {
+        auto & v = out[col];
+        v.i = 0;
+        v.f = 0.0;
+        v.p = nullptr;
+        v.n = 0;
+
+        if (sqlite3_column_type(stmt, col) == SQLITE_NULL)
+        {
+            v.type = Type::Null;
+            continue;
+        }
+
+        v.type = types[col];
+        switch (v.type)
+        {
+        case Type::Integer:
+            v.i = sqlite3_column_int64(stmt, col);
+            break;
+
+        case Type::Float:
+            v.f = sqlite3_column_double(stmt, col);
+            break;
+
+        case Type::Blob:
+            v.p = sqlite3_column_blob(stmt, col);
+            v.n = sqlite3_column_bytes(stmt, col);
+            break;
+
+        default:
+            v.p = sqlite3_column_text(stmt, col);
+            v.n = sqlite3_column_bytes(stmt, col);
+            break;
+        }
+    }
+}
+
+bool SQLite3Stmt::_col_null(int col) const noexcept
+{
+    return sqlite3_column_type(reinterpret_cast<sqlite3_stmt*>(this->handle), col) == SQLITE_NULL;
+}
+
+std::int64_t SQLite3Stmt::_col_int(int col) const noexcept
+{
+    return sqlite3_column_int64(reinterpret_cast<sqlite3_stmt*>(this->handle), col);
+}
+
+double SQLite3Stmt::_col_float(int col) const noexcept
+{
+    return sqlite3_column_double(reinterpret_cast<sqlite3_stmt*>(this->handle), col);
+}
+
+const char * SQLite3Stmt::_col_text(int col, std::size_t & n) const noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    auto const p = sqlite3_column_text(stmt, col); // before sqlite3_column_bytes(), see its docs
+    n = sqlite3_column_bytes(stmt, col);
+    return reinterpret_cast<const char *>(p);
+}
+
+const void * SQLite3Stmt::_col_blob(int col, std::size_t & n) const noexcept
+{
+    auto stmt = reinterpret_cast<sqlite3_stmt*>(this->handle);
+    auto const p = sqlite3_column_blob(stmt, col);
+    n = sqlite3_column_bytes(stmt, col);
+    return p;
+}
+
+bool SQLite3Stmt::_bulk_begin()
+{
+    auto db = reinterpret_cast<sqlite3*>(this->database.handle);
+    if (!sqlite3_get_autocommit(db))
+        return false; // already inside the caller's transaction
+
+    auto const res = this->database.internals->busy.exec(db, "BEGIN");
+    if (res != SQLITE_OK) throw SQLite3Error(this->database);
+    return true;
+}
+
+void SQLite3Stmt::_bulk_commit()
+{
+    auto db = reinterpret_cast<sqlite3*>(this->database.handle);
+    auto const res = this->database.internals->busy.exec(db, "COMMIT");
+    this->database.internals->changes.settle(db, res);
+    if (res != SQLITE_OK) throw SQLite3Error(this->database);
+}
+
+void SQLite3Stmt::_bulk_rollback() noexcept
+{
+    auto db = reinterpret_cast<sqlite3*>(this->database.handle);
+    if (!sqlite3_get_autocommit(db))
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+}
+
 
 std::size_t SQLite3Stmt::RowReader::size() const noexcept
 {
@@ -0,0 +1,193 @@
+#include "internal.h"
+
+#include <cstring>
+
+using namespace hgl;
+
+static inline bool _is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Collapse whitespace outside quoted text and comments and drop trailing
+// semicolons, so that "SELECT  *\nFROM t;" and "SELECT * FROM t" share a
+// cache entry. Comments are kept verbatim: the newline ending a `--`
+// comment is what separates it from the rest of the statement.
+void StmtCache::normalize(const char * sql)
+{
+    auto & key = this->key_buf;
+    key.clear();
+
+    char quote = '\0';
+    bool pending_space = false;
+
+    for (const char * p = sql; *p != '\0'; p++)
+    {
+        const char c = *p;
+
+        if (quote != '\0')
+        {
+            key.push_back(c);
+            if (c == quote)
+                quote = '\0';
+            continue;
+        }
+
+        if (_is_space(c))
+        {
+            pending_space = !key.empty();
+            continue;
+        }
+
+        if (pending_space)
+        {
+            key.push_back(' ');
+            pending_space = false;
+        }
+
+        if ((c == '-' && p[1] == '-') || (c == '/' && p[1] == '*'))
+        {
+            const char * end = c == '-' ? std::strchr(p, '\n') : std::strstr(p + 2, "*/");
+            const char * stop = end == nullptr ? p + std::strlen(p) : end + (c == '-' ? 1 : 2);
+            key.append(p, stop);
+            p = stop - 1;
+            continue;
+        }
+
+        key.push_back(c);
+
+        if (c == '\'' || c == '"' || c == '`')
+            quote = c;
+        else if (c == '[')
+            quote = ']';
+    }
+
+    while (!key.empty() && (key.back() == ';' || key.back() == ' '))
+        key.pop_back();
+}
+
+void StmtCache::finalize(sqlite3_stmt * stmt) noexcept
+{
+    this->changes.forget(stmt);
+    sqlite3_finalize(stmt);
+}
+
+void StmtCache::shrink() noexcept
+{
+    auto it = this->entries.end();
+    while (this->entries.size() > this->capacity && it != this->entries.begin())
+    {
+        --it;
+        if (it->in_use)
+            continue;
+
+        this->finalize(it->stmt);
+        this->index.erase(it->key);
+        this->owners.erase(it->stmt);
+        it = this->entries.erase(it);
+        this->evictions++;
+    }
+}
+
+sqlite3_stmt * StmtCache::take(const char * sql, std::unique_ptr<NameIndex> & names) noexcept
+{
+    if (!this->enabled())
+        return nullptr;
+
+    try
+    {
+        this->normalize(sql);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+
+    auto const found = this->index.find(this->key_buf);
+    if (found == this->index.end() || found->second->in_use)
+    {
+        this->misses++;
+        return nullptr;
+    }
+
+    auto const it = found->second;
+    it->in_use = true;
+    names = std::move(it->names);
+    this->entries.splice(this->entries.begin(), this->entries, it);
+    this->hits++;
+    return it->stmt;
+}
+
+void StmtCache::adopt(sqlite3_stmt * stmt, const char * sql) noexcept
+{
+    if (!this->enabled())
+        return;
+
+    try
+    {
+        this->normalize(sql);
+        if (this->index.find(this->key_buf) != this->index.end())
+            return; // a twin is already cached
+
+        this->entries.push_front(Entry{this->key_buf, stmt, true, nullptr});
+        try
+        {
+            this->index.emplace(this->entries.front().key, this->entries.begin());
+            this->owners.emplace(stmt, this->entries.begin());
+        }
+        catch (...)
+        {
+            this->index.erase(this->entries.front().key);
+            this->entries.pop_front();
+            throw;
+        }
+    }
+    catch (...)
+    {
+        return;
+    }
+
+    this->shrink();
+}
+
+bool StmtCache::put(sqlite3_stmt * stmt, std::unique_ptr<NameIndex> names) noexcept
+{
+    auto const found = this->owners.find(stmt);
+    if (found == this->owners.end())
+        return false;
+
+    auto const it = found->second;
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    it->in_use = false;
+    it->names = std::move(names);
+    this->shrink();
+    return true;
+}
+
+void StmtCache::clear() noexcept
+{
+    for (auto & e: this->entries)
+    {
+        if (!e.in_use)
+            this->finalize(e.stmt);
+    }
+
+    this->index.clear();
+    this->owners.clear();
+    this->entries.clear();
+}
+
+void StmtCache::setCapacity(std::size_t cap) noexcept
+{
+    this->capacity = cap;
+    this->shrink();
+}
+
+SQLite3::StmtCacheStats StmtCache::stats() const noexcept
+{
+    return SQLite3::StmtCacheStats{
+        this->hits, this->misses, this->evictions,
+        this->entries.size(), this->capacity,
+    };
+}
@@ -0,0 +1,129 @@
+#include "internal.h"
+
+#include <cstdio>
+
+using namespace hgl;
+
+static void _exec(const SQLite3 & db, BusyHandler & busy, ChangeLog & changes, sqlite3 * handle, const char * sql)
+{
+    const auto res = busy.exec(handle, sql);
+    changes.settle(handle, res);
+    if (res != SQLITE_OK)
+        throw SQLite3Error(db);
+}
+
+bool SQLite3::inTransaction() const noexcept
+{
+    return this->handle != nullptr &&
+        !sqlite3_get_autocommit(reinterpret_cast<sqlite3*>(this->handle));
+}
+
+
+SQLite3::Transaction::Transaction(SQLite3 & db, TransactionMode mode):
+    db(db), active(false)
+{
+    const char * sql;
+    switch (mode)
+    {
+    case TransactionMode::Immediate: sql = "BEGIN IMMEDIATE"; break;
+    case TransactionMode::Exclusive: sql = "BEGIN EXCLUSIVE"; break;
+    default: sql = "BEGIN DEFERRED"; break;
+    }
+
+    _exec(db, db.internals->busy, db.internals->changes, reinterpret_cast<sqlite3*>(db.handle), sql);
+    this->active = true;
+}
+
+SQLite3::Transaction::~Transaction()
+{
+    this->rollback();
+}
+
+void SQLite3::Transaction::commit()
+{
+    if (!this->active)
+        return;
+
+    _exec(this->db, this->db.internals->busy, this->db.internals->changes,
+        reinterpret_cast<sqlite3*>(this->db.handle), "COMMIT");
+    this->active = false;
+}
+
+void SQLite3::Transaction::rollback() noexcept
+{
+    if (!this->active)
+        return;
+
+    this->active = false;
+    // SQLite may already have rolled back on its own (e.g. SQLITE_FULL)
+    if (this->db.inTransaction())
+        sqlite3_exec(reinterpret_cast<sqlite3*>(this->db.handle),
+            "ROLLBACK", nullptr, nullptr, nullptr);
+}
+
+
+SQLite3::Savepoint::Savepoint(SQLite3 & db): db(db), level(0)
+{
+    const auto lv = db.internals->savepoint_level + 1;
+    this->level = lv;
+    try
+    {
+        this->_exec("SAVEPOINT");
+    }
+    catch (...)
+    {
+        this->level = 0;
+        throw;
+    }
+    db.internals->savepoint_level = lv;
+}
+
+SQLite3::Savepoint::~Savepoint()
+{
+    this->rollback();
+}
+
+void SQLite3::Savepoint::_exec(const char * verb)
+{
+    char name[32], sql[64];
+    std::snprintf(name, sizeof name, "hgl_sp_%u", this->level);
+    std::snprintf(sql, sizeof sql, "%s %s", verb, name);
+    ::_exec(this->db, this->db.internals->busy, this->db.internals->changes,
+        reinterpret_cast<sqlite3*>(this->db.handle), sql);
+
+    // statements run by sqlite3_exec() do not reach ChangeLog::stepped()
+    using Op = ChangeLog::SavepointOp;
+    const auto op = verb[0] == 'S' ? Op::Begin : verb[1] == 'E' ? Op::Release : Op::Rollback;
+    this->db.internals->changes.savepoint(op, name);
+}
+
+void SQLite3::Savepoint::commit()
+{
+    if (this->level == 0)
+        return;
+
+    this->_exec("RELEASE");
+    this->db.internals->savepoint_level = this->level - 1;
+    this->level = 0;
+}
+
+void SQLite3::Savepoint::rollback() noexcept
+{
+    if (this->level == 0)
+        return;
+
+    try
+    {
+        if (this->db.inTransaction())
+        {
+            this->_exec("ROLLBACK TO");
+            this->_exec("RELEASE");
+        }
+    }
+    catch (...)
+    {
+    }
+
+    this->db.internals->savepoint_level = this->level - 1;
+    this->level = 0;
+}
@@ -0,0 +1,287 @@
+#include "internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace hgl;
+
+namespace
+{
+    struct VTab: sqlite3_vtab
+    {
+        const _VTableSource * src;
+    };
+
+    struct VCursor: sqlite3_vtab_cursor
+    {
+        std::size_t pos, end;
+    };
+
+    // idxNum bits
+    constexpr int idx_eq = 1, idx_lower = 2, idx_upper = 4, idx_lower_gt = 8, idx_upper_lt = 16;
+
+    const _VTableSource & source(sqlite3_vtab_cursor * cur) noexcept
+    {
+        return *static_cast<VTab*>(cur->pVtab)->src;
+    }
+
+    int x_connect(sqlite3 * db, void * aux, int, const char * const *, sqlite3_vtab ** out, char **)
+    {
+        auto src = static_cast<const _VTableSource*>(aux);
+        const auto res = sqlite3_declare_vtab(db, src->declaration());
+        if (res != SQLITE_OK)
+            return res;
+
+        auto vtab = static_cast<VTab*>(sqlite3_malloc(sizeof(VTab)));
+        if (vtab == nullptr)
+            return SQLITE_NOMEM;
+        *vtab = VTab{};
+        vtab->src = src;
+        *out = vtab;
+
+        sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+        return SQLITE_OK;
+    }
+
+    // a distinct function from x_connect, so that the module is not eponymous
+    int x_create(sqlite3 * db, void * aux, int argc, const char * const * argv, sqlite3_vtab ** out, char ** err)
+    {
+        return x_connect(db, aux, argc, argv, out, err);
+    }
+
+    int x_disconnect(sqlite3_vtab * vtab)
+    {
+        sqlite3_free(vtab);
+        return SQLITE_OK;
+    }
+
+    int x_best_index(sqlite3_vtab * vtab, sqlite3_index_info * info)
+    {
+        auto & src = *static_cast<VTab*>(vtab)->src;
+        const auto key = src.keyColumn();
+        const auto n = static_cast<double>(std::max<std::size_t>(src.size(), 1));
+
+        int eq = -1, lower = -1, upper = -1, flags = 0;
+        for (int i = 0; i < info->nConstraint; i++)
+        {
+            const auto & c = info->aConstraint[i];
+            if (!c.usable || key < 0 || c.iColumn != key)
+                continue;
+            // keys are ordered by binary comparison; under another collation
+            // (e.g. `= 'x' COLLATE NOCASE`) narrowing by them would lose rows
+            if (const char * coll = sqlite3_vtab_collation(info, i);
+                    coll != nullptr && sqlite3_stricmp(coll, "BINARY") != 0)
+                continue;
+
+            switch (c.op)
+            {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                eq = i;
+                break;
+
+            case SQLITE_INDEX_CONSTRAINT_GT:
+            case SQLITE_INDEX_CONSTRAINT_GE:
+                lower = i;
+                break;
+
+            case SQLITE_INDEX_CONSTRAINT_LT:
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                upper = i;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        // constraints are not omitted: SQLite re-checks each row, so a
+        // constraint value of another type only has to narrow conservatively
+        int argv_index = 0;
+        if (eq >= 0)
+        {
+            flags |= idx_eq;
+            info->aConstraintUsage[eq].argvIndex = ++argv_index;
+            info->estimatedCost = 1.0 + std::log2(n);
+            info->estimatedRows = 1;
+        }
+        else
+        {
+            double rows = n;
+            if (lower >= 0)
+            {
+                flags |= idx_lower;
+                if (info->aConstraint[lower].op == SQLITE_INDEX_CONSTRAINT_GT)
+                    flags |= idx_lower_gt;
+                info->aConstraintUsage[lower].argvIndex = ++argv_index;
+                rows /= 3;
+            }
+            if (upper >= 0)
+            {
+                flags |= idx_upper;
+                if (info->aConstraint[upper].op == SQLITE_INDEX_CONSTRAINT_LT)
+                    flags |= idx_upper_lt;
+                info->aConstraintUsage[upper].argvIndex = ++argv_index;
+                rows /= 3;
+            }
+            info->estimatedCost = (flags != 0 ? std::log2(n) : 0.0) + rows;
+            info->estimatedRows = static_cast<sqlite3_int64>(rows) + 1;
+        }
+        info->idxNum = flags;
+
+        // rows come out in key order
+        if (key >= 0 && info->nOrderBy == 1 &&
+                info->aOrderBy[0].iColumn == key && !info->aOrderBy[0].desc)
+            info->orderByConsumed = 1;
+
+        return SQLITE_OK;
+    }
+
+    int x_open(sqlite3_vtab *, sqlite3_vtab_cursor ** out)
+    {
+        auto cur = static_cast<VCursor*>(sqlite3_malloc(sizeof(VCursor)));
+        if (cur == nullptr)
+            return SQLITE_NOMEM;
+        *cur = VCursor{};
+        *out = cur;
+        return SQLITE_OK;
+    }
+
+    int x_close(sqlite3_vtab_cursor * cur)
+    {
+        sqlite3_free(cur);
+        return SQLITE_OK;
+    }
+
+    /// first position whose key is >= v (or > v if `after`)
+    std::size_t bound(const _VTableSource & src, const SQLite3Stmt::Value & v, bool after) noexcept
+    {
+        std::size_t lo = 0, hi = src.size();
+        while (lo < hi)
+        {
+            const auto mid = lo + (hi - lo) / 2;
+            const auto c = src.compare(src.rowAt(mid), v);
+            if (c < 0 || (after && c == 0))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    int x_filter(sqlite3_vtab_cursor * base, int flags, const char *, int argc, sqlite3_value ** argv)
+    {
+        auto cur = static_cast<VCursor*>(base);
+        auto & src = source(base);
+        cur->pos = 0;
+        cur->end = src.size();
+
+        auto args = reinterpret_cast<void**>(argv);
+        auto narrow = [&](int arg, bool lower, bool strict)
+        {
+            SQLite3Stmt::Value v;
+            _SqlFn::arg(args, arg, v);
+            if (v.type == SQLite3Stmt::Type::Null)
+            {
+                cur->end = cur->pos; // comparisons with NULL are never true
+                return;
+            }
+            if (!src.comparable(v))
+                return; // leave it to SQLite's re-check
+
+            if (lower)
+                cur->pos = std::max(cur->pos, bound(src, v, strict));
+            else
+                cur->end = std::min(cur->end, bound(src, v, !strict));
+        };
+
+        int arg = 0;
+        if ((flags & idx_eq) && arg < argc)
+        {
+            narrow(arg, true, false);
+            narrow(arg, false, false);
+            arg++;
+        }
+        if ((flags & idx_lower) && arg < argc)
+            narrow(arg++, true, flags & idx_lower_gt);
+        if ((flags & idx_upper) && arg < argc)
+            narrow(arg++, false, flags & idx_upper_lt);
+
+        if (cur->end < cur->pos)
+            cur->end = cur->pos;
+        return SQLITE_OK;
+    }
+
+    int x_next(sqlite3_vtab_cursor * base)
+    {
+        static_cast<VCursor*>(base)->pos++;
+        return SQLITE_OK;
+    }
+
+    int x_eof(sqlite3_vtab_cursor * base)
+    {
+        auto cur = static_cast<VCursor*>(base);
+        return cur->pos >= cur->end;
+    }
+
+    int x_column(sqlite3_vtab_cursor * base, sqlite3_context * ctx, int col)
+    {
+        auto cur = static_cast<VCursor*>(base);
+        auto & src = source(base);
+        SQLite3Stmt::Value v;
+        src.column(src.rowAt(cur->pos), col, v);
+        _SqlFn::result(ctx, v, false); // the container outlives the statement
+        return SQLITE_OK;
+    }
+
+    int x_rowid(sqlite3_vtab_cursor * base, sqlite3_int64 * rowid)
+    {
+        auto cur = static_cast<VCursor*>(base);
+        *rowid = static_cast<sqlite3_int64>(source(base).rowAt(cur->pos));
+        return SQLITE_OK;
+    }
+
+    sqlite3_module make_module(bool eponymous) noexcept
+    {
+        sqlite3_module m{};
+        m.iVersion = 0;
+        m.xCreate = eponymous ? nullptr : x_create;
+        m.xConnect = x_connect;
+        m.xBestIndex = x_best_index;
+        m.xDisconnect = x_disconnect;
+        m.xDestroy = x_disconnect;
+        m.xOpen = x_open;
+        m.xClose = x_close;
+        m.xFilter = x_filter;
+        m.xNext = x_next;
+        m.xEof = x_eof;
+        m.xColumn = x_column;
+        m.xRowid = x_rowid;
+        return m;
+    }
+
+    const sqlite3_module eponymous_module = make_module(true);
+    const sqlite3_module named_module = make_module(false);
+
+    void destroy_source(void * src)
+    {
+        delete static_cast<_VTableSource*>(src);
+    }
+}
+
+void SQLite3::_define_table(const char * name, _VTableSource * src, bool eponymous)
+{
+    auto db = reinterpret_cast<sqlite3*>(this->handle);
+
+    // SQLite calls destroy_source itself, even when registering fails
+    if (sqlite3_create_module_v2(db, name, eponymous ? &eponymous_module : &named_module,
+            src, destroy_source) != SQLITE_OK)
+        throw SQLite3Error(*this);
+
+    if (!eponymous)
+    {
+        std::string sql = "CREATE VIRTUAL TABLE temp.\"";
+        sql.append(name).append("\" USING \"").append(name).append("\"");
+        (*this)(sql.c_str());
+    }
+}
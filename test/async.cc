@@ -0,0 +1,133 @@
+#include <sqlite3w_async.h>
+
+#include <atomic>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char db_file[] = "test_async.db";
+
+static void remove_db()
+{
+    std::remove(db_file);
+    std::remove("test_async.db-journal");
+}
+
+/// fire-and-forget coroutine
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept { }
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+static Task coro(SQLite3Async & db, std::atomic<int> & out)
+{
+    co_await db.execute("INSERT INTO T (K, V) VALUES (?, ?)", 1000, std::string("coroutine"));
+    auto rows = co_await db.query<std::string>("SELECT V FROM T WHERE K = ?", 1000);
+    out = (rows.size() == 1 && std::get<0>(rows[0]) == "coroutine") ? 1 : -1;
+    out.notify_all();
+}
+
+int main(int argc, char const *argv[])
+{
+    remove_db();
+
+    {
+        SQLite3Async db(db_file);
+
+        db.execute("CREATE TABLE T (K INTEGER PRIMARY KEY, V TEXT);").get();
+
+        // hold the worker so that the following writes queue up behind it;
+        // wait until it runs the gate, or it may pick up some writes with it
+        std::atomic<bool> started(false), go(false);
+        auto gate = db.submit([&started, &go](SQLite3 &)
+        {
+            started = true;
+            started.notify_all();
+            go.wait(false);
+            return 1;
+        });
+        started.wait(false);
+
+        std::vector<SQLite3Async::Result<void>> writes;
+        for (int i = 0; i < 100; i++)
+        {
+            const std::string text = "v" + std::to_string(i);
+            writes.push_back(db.execute("INSERT INTO T (K, V) VALUES (?, ?)", i, std::string_view(text)));
+        }
+        // views into buffers that are gone before the worker binds them
+        {
+            std::string text = "optional view";
+            std::vector<std::byte> bytes(4, std::byte{0x5a});
+            writes.push_back(db.execute("INSERT INTO T (K, V) VALUES (?, ?)", 200,
+                std::optional<std::string_view>(text)));
+            writes.push_back(db.execute("INSERT INTO T (K, V) VALUES (?, ?)", 201,
+                std::span<const std::byte>(bytes)));
+            text.assign(text.size(), '-');
+            bytes.assign(bytes.size(), std::byte{0});
+        }
+        auto dup = db.execute("INSERT INTO T (K, V) VALUES (?, ?)", 0, "duplicate");
+        auto after = db.execute("INSERT INTO T (K, V) VALUES (?, ?)", 100, nullptr);
+
+        const auto before = db.getStats();
+        go = true;
+        go.notify_all();
+        CHECK(gate.get() == 1);
+
+        for (auto & w: writes)
+            w.get();
+        after.get();
+
+        // the failing statement only rolled back its own savepoint
+        bool thrown = false;
+        try
+        {
+            dup.get();
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        const auto stats = db.getStats();
+        CHECK(stats.writes - before.writes == 104);
+        CHECK(stats.commits - before.commits == 1);
+
+        auto rows = db.query<std::int64_t, std::optional<std::string>>(
+            "SELECT K, V FROM T WHERE K IN (?, ?, ?) ORDER BY K", 0, 99, 100).get();
+        CHECK(rows.size() == 3);
+        CHECK(std::get<1>(rows[0]) == "v0");
+        CHECK(std::get<1>(rows[1]) == "v99");
+        CHECK(!std::get<1>(rows[2]));
+
+        auto copied = db.query<std::string>(
+            "SELECT V FROM T WHERE K IN (200, 201) ORDER BY K").get();
+        CHECK(copied.size() == 2);
+        CHECK(std::get<0>(copied[0]) == "optional view");
+        CHECK(std::get<0>(copied[1]) == "ZZZZ");
+
+        // coroutine resumed on the worker thread
+        std::atomic<int> done(0);
+        coro(db, done);
+        done.wait(0);
+        CHECK(done == 1);
+    }
+
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <sqlite3w.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char src_file[] = "test_backup_src.db";
+static const char dst_file[] = "test_backup_dst.db";
+
+static void remove_db()
+{
+    std::remove(src_file);
+    std::remove("test_backup_src.db-journal");
+    std::remove(dst_file);
+    std::remove("test_backup_dst.db-journal");
+}
+
+static std::int64_t count(SQLite3 & db)
+{
+    SQLite3Stmt stmt(db, "SELECT count(*) FROM T");
+    stmt();
+    return stmt.begin()->readInteger(0);
+}
+
+int main(int argc, char const *argv[])
+{
+    remove_db();
+
+    {
+        SQLite3 file(src_file);
+        file("CREATE TABLE T (K INTEGER PRIMARY KEY, V TEXT);");
+        file("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 5000) "
+            "INSERT INTO T SELECT i, hex(randomblob(64)) FROM n;");
+    }
+
+    // warm-start an in-memory replica, in small steps
+    SQLite3 mem;
+    {
+        SQLite3::BackupOptions opts;
+        opts.pages_per_step = 16;
+        int calls = 0;
+        opts.progress = [&](int remaining, int total)
+        {
+            calls++;
+            return remaining < total;
+        };
+        const auto stats = mem.loadFrom(src_file, opts);
+        CHECK(stats.complete);
+        CHECK(stats.pages > 16);
+        CHECK(calls == static_cast<int>(stats.steps) - 1); // not called after the last step
+        CHECK(count(mem) == 5000);
+    }
+
+    // checkpoint the replica to disk
+    mem("DELETE FROM T WHERE K > 1000;");
+    CHECK(mem.saveTo(dst_file).complete);
+    {
+        SQLite3 file(dst_file);
+        CHECK(count(file) == 1000);
+    }
+
+    // stopped by the progress callback
+    {
+        SQLite3 other;
+        SQLite3::BackupOptions opts;
+        opts.pages_per_step = 1;
+        opts.progress = [](int, int) { return false; };
+        const auto stats = SQLite3::backup(other, mem, opts);
+        CHECK(!stats.complete && stats.steps == 1);
+    }
+
+    // source written through another connection between steps
+    {
+        SQLite3 src(src_file), writer(src_file), copy;
+        SQLite3::BackupOptions opts;
+        opts.pages_per_step = 8;
+        bool written = false;
+        opts.progress = [&](int, int)
+        {
+            if (!written)
+            {
+                writer("INSERT INTO T VALUES (100000, 'late');");
+                written = true;
+            }
+            return true;
+        };
+        CHECK(SQLite3::backup(copy, src, opts).complete);
+        CHECK(count(copy) == 5001);
+    }
+
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE M (Id INTEGER PRIMARY KEY, V REAL, Tag TEXT);");
+    {
+        SQLite3::Transaction txn(db);
+        SQLite3Stmt ins(db, "INSERT INTO M (Id, V, Tag) VALUES (?, ?, ?)");
+        for (int i = 0; i < 1000; i++)
+        {
+            if (i % 10 == 0)
+                ins(i, nullptr, nullptr);
+            else
+                ins(i, i * 0.5, i % 2 ? "odd" : "even");
+            ins.reset();
+        }
+        txn.commit();
+    }
+
+    SQLite3Stmt sel(db, "SELECT Id, V, Tag FROM M ORDER BY Id");
+    CHECK(sel());
+
+    SQLite3Stmt::ColumnBatch batch;
+    std::size_t total = 0, batches = 0, nulls = 0, odd = 0;
+    std::int64_t id_sum = 0;
+    double v_sum = 0;
+
+    while (auto const n = sel.fetchBatch(batch, 256))
+    {
+        CHECK(batch.rows == n);
+        CHECK(batch.columns.size() == 3);
+        CHECK(batch.columns[0].type == SQLite3Stmt::Type::Integer);
+        CHECK(batch.columns[1].type == SQLite3Stmt::Type::Float);
+        CHECK(batch.columns[2].type == SQLite3Stmt::Type::Text);
+
+        auto & ids = batch.columns[0].ints;
+        auto & vs = batch.columns[1].floats;
+        id_sum += std::accumulate(ids.begin(), ids.end(), std::int64_t(0));
+        v_sum += std::accumulate(vs.begin(), vs.end(), 0.0);
+
+        for (std::size_t r = 0; r < n; r++)
+        {
+            if (batch.columns[1].isNull(r))
+                nulls++;
+            if (batch.columns[2].text(r) == "odd")
+                odd++;
+        }
+
+        total += n;
+        batches++;
+    }
+
+    CHECK(total == 1000);
+    CHECK(batches == 4);
+    CHECK(id_sum == 999 * 1000 / 2);
+    CHECK(nulls == 100);
+    CHECK(odd == 500);
+
+    double expect = 0;
+    for (int i = 0; i < 1000; i++)
+        if (i % 10 != 0)
+            expect += i * 0.5;
+    CHECK(v_sum == expect);
+
+    // pooled buffer; a leading NULL takes the declared column type
+    SQLite3Stmt sel2(db, "SELECT V FROM M WHERE Id < 5 ORDER BY Id");
+    CHECK(sel2());
+    auto & b = sel2.fetchBatch(100);
+    CHECK(b.rows == 5);
+    CHECK(b.columns[0].type == SQLite3Stmt::Type::Float);
+    CHECK(b.columns[0].isNull(0));
+    CHECK(b.columns[0].floats[4] == 2.0);
+    CHECK(sel2.fetchBatch(100).rows == 0);
+
+    // mixed storage classes: inferred types widen or throw, caller types convert
+    db("CREATE TABLE X (V);");
+    db("INSERT INTO X (V) VALUES (3), (2.5), ('n/a');");
+
+    SQLite3Stmt sel3(db, "SELECT V FROM X WHERE typeof(V) <> 'text' ORDER BY rowid");
+    CHECK(sel3());
+    SQLite3Stmt::ColumnBatch b3;
+    CHECK(sel3.fetchBatch(b3, 10) == 2);
+    CHECK(b3.columns[0].type == SQLite3Stmt::Type::Float);
+    CHECK(b3.columns[0].floats[0] == 3.0 && b3.columns[0].floats[1] == 2.5);
+
+    SQLite3Stmt sel4(db, "SELECT V FROM X ORDER BY rowid");
+    CHECK(sel4());
+    SQLite3Stmt::ColumnBatch b4;
+    bool mismatch = false;
+    try { sel4.fetchBatch(b4, 10); }
+    catch (const SQLite3Error & e) { mismatch = e.errcode() == 20; } // SQLITE_MISMATCH
+    CHECK(mismatch);
+    CHECK(b4.rows == 0 && b4.columns[0].floats.empty());
+
+    // failing in the middle of a row leaves no column longer than the others
+    SQLite3Stmt sel6(db, "SELECT rowid, V FROM X ORDER BY rowid");
+    CHECK(sel6());
+    SQLite3Stmt::ColumnBatch b6;
+    mismatch = false;
+    try { sel6.fetchBatch(b6, 10); }
+    catch (const SQLite3Error &) { mismatch = true; }
+    CHECK(mismatch);
+    CHECK(b6.rows == 0 && b6.columns[0].ints.empty() && b6.columns[1].floats.empty());
+
+    sel4.reset();
+    CHECK(sel4());
+    SQLite3Stmt::ColumnBatch b5;
+    b5.columns.resize(1);
+    b5.columns[0].type = SQLite3Stmt::Type::Integer;
+    CHECK(sel4.fetchBatch(b5, 10) == 3);
+    CHECK(b5.columns[0].type == SQLite3Stmt::Type::Integer);
+    CHECK(b5.columns[0].ints[0] == 3 && b5.columns[0].ints[1] == 2 && b5.columns[0].ints[2] == 0);
+
+    return 0;
+}
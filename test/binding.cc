@@ -0,0 +1,111 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static int freed = 0;
+
+static void free_buffer(void * p)
+{
+    delete[] static_cast<char *>(p);
+    freed++;
+}
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE T (Id INTEGER PRIMARY KEY, S TEXT, B BLOB);");
+
+    SQLite3Stmt ins(db, "INSERT INTO T (Id, S, B) VALUES (?, ?, ?)");
+
+    // variadic binding of text, owned strings, views, blobs and nulls
+    const std::string json(4096, 'j');
+    std::vector<std::byte> proto(3000, std::byte{0x5a});
+
+    ins(1, "literal", nullptr);
+    ins.reset();
+    ins(2, std::string(json), std::span<const std::byte>(proto));
+    ins.reset();
+    ins(3, std::string_view(json).substr(0, 10), std::optional<int>());
+    ins.reset();
+    ins(4, json, proto);
+    ins.reset();
+
+    // explicit policies
+    {
+        std::string temp = "transient";
+        ins.bindInteger(1, 5);
+        ins.bindText(2, std::string_view(temp), SQLite3Stmt::Lifetime::Transient);
+        temp.assign(temp.size(), '#'); // SQLite already has its own copy
+        ins.bindZeroBlob(3, 16);
+        ins();
+        ins.reset();
+    }
+    {
+        auto buf = new char[5]{'o', 'w', 'n', 'e', 'd'};
+        ins.bindInteger(1, 6);
+        ins.bindText(2, buf, 5, free_buffer);
+        ins.bindBlob(3, std::string(1000, '\x01'));
+        ins();
+        ins.reset();
+        ins.bindNull(2); // SQLite drops its reference
+        CHECK(freed == 1);
+    }
+
+    SQLite3Stmt sel(db, "SELECT length(S), typeof(B), length(B), S FROM T WHERE Id=?");
+
+    CHECK(sel(1));
+    {
+        auto row = sel.begin();
+        CHECK(row->readInteger(0) == 7);
+        CHECK(row->type(1) == SQLite3Stmt::Type::Text);
+        CHECK(std::string(row->readText(1)) == "null");
+    }
+
+    CHECK(sel(2));
+    {
+        auto row = sel.begin();
+        CHECK(row->readInteger(0) == 4096);
+        CHECK(std::string(row->readText(1)) == "blob");
+        CHECK(row->readInteger(2) == 3000);
+    }
+
+    CHECK(sel(3));
+    {
+        auto row = sel.begin();
+        CHECK(row->readInteger(0) == 10);
+        CHECK(std::string(row->readText(1)) == "null");
+    }
+
+    CHECK(sel(4));
+    {
+        auto row = sel.begin();
+        CHECK(row->readInteger(0) == 4096);
+        CHECK(row->readInteger(2) == 3000);
+    }
+
+    CHECK(sel(5));
+    {
+        auto row = sel.begin();
+        CHECK(std::string(row->readText(3)) == "transient");
+        CHECK(row->readInteger(2) == 16);
+    }
+
+    CHECK(sel(6));
+    {
+        auto row = sel.begin();
+        CHECK(std::string(row->readText(3)) == "owned");
+        CHECK(row->readInteger(2) == 1000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE T (Id INTEGER PRIMARY KEY, Data BLOB);");
+    db("INSERT INTO T VALUES (1, zeroblob(1000000)), (2, zeroblob(300)), (3, 'text');");
+
+    // chunked writes through a small buffer
+    {
+        SQLite3::BlobStream blob(db, "T", "Data", 1, true);
+        CHECK(blob.size() == 1000000);
+
+        std::vector<std::byte> chunk(4096);
+        while (blob.tell() < blob.size())
+        {
+            const auto n = std::min(chunk.size(), blob.size() - blob.tell());
+            for (std::size_t i = 0; i < n; i++)
+                chunk[i] = static_cast<std::byte>((blob.tell() + i) % 251);
+            blob.write(std::span<const std::byte>(chunk.data(), n));
+        }
+
+        // the value cannot grow
+        bool thrown = false;
+        try
+        {
+            blob.write(chunk);
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // chunked reads, seek, and reopen on other rows
+    {
+        SQLite3::BlobStream blob(db, "T", "Data", 1);
+        std::vector<std::byte> chunk(1000);
+        std::size_t total = 0;
+        for (std::size_t n; (n = blob.read(chunk)) != 0; total += n)
+        {
+            for (std::size_t i = 0; i < n; i++)
+                CHECK(chunk[i] == static_cast<std::byte>((total + i) % 251));
+        }
+        CHECK(total == 1000000);
+
+        blob.seek(500000);
+        CHECK(blob.read(std::span<std::byte>(chunk.data(), 1)) == 1);
+        CHECK(chunk[0] == static_cast<std::byte>(500000 % 251));
+
+        blob.reopen(2);
+        CHECK(blob.size() == 300 && blob.tell() == 0);
+        blob.reopen(3);
+        CHECK(blob.size() == 4);
+        CHECK(blob.read(chunk) == 4);
+        CHECK(std::string(reinterpret_cast<const char *>(chunk.data()), 4) == "text");
+
+        bool thrown = false;
+        try
+        {
+            blob.write(std::span<const std::byte>(chunk.data(), 1)); // opened read-only
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // iostream interface
+    {
+        SQLite3::BlobStream blob(db, "T", "Data", 2, true);
+        {
+            SQLite3::BlobStream::StreamBuf buf(blob);
+            std::ostream out(&buf);
+            out << "hello " << 42;
+            out.seekp(0, std::ios_base::end);
+            CHECK(out.tellp() == 300);
+        }
+
+        blob.seek(0);
+        SQLite3::BlobStream::StreamBuf buf(blob);
+        std::istream in(&buf);
+        std::string word;
+        int number = 0;
+        in >> word >> number;
+        CHECK(word == "hello" && number == 42);
+        in.seekg(299);
+        CHECK(in.get() == 0);
+        CHECK(in.get() == std::char_traits<char>::eof());
+    }
+
+    SQLite3Stmt sel(db, "SELECT substr(Data, 1, 8) FROM T WHERE Id = 2");
+    CHECK(sel());
+    CHECK(std::string(sel.begin()->readText(0)) == "hello 42");
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+struct Point
+{
+    int    id;
+    double x, y;
+};
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE P (Id INTEGER PRIMARY KEY, X REAL, Y REAL);");
+
+    std::vector<std::tuple<int, double, double>> rows;
+    for (int i = 0; i < 1000; i++)
+        rows.emplace_back(i, i * 0.5, i * 0.25);
+
+    SQLite3Stmt ins(db, "INSERT INTO P (Id, X, Y) VALUES (?, ?, ?)");
+
+    SQLite3Stmt::BulkOptions opts;
+    opts.chunk_rows = 300;
+    auto stats = ins.executeMany(rows, opts);
+    CHECK(stats.rows == 1000);
+    CHECK(stats.commits == 4);
+    CHECK(stats.bytes == 1000 * (sizeof(int) + 2 * sizeof(double)));
+    std::cout << stats.rowsPerSecond() << " rows/s\n";
+
+    std::vector<Point> points;
+    for (int i = 1000; i < 1500; i++)
+        points.push_back(Point{i, 1.0, 2.0});
+
+    stats = ins.executeMany(points,
+        [](const Point & p) { return std::tie(p.id, p.x, p.y); });
+    CHECK(stats.rows == 500);
+    CHECK(stats.commits == 1);
+
+    // a projection returning by value, with strings that only live in its result
+    db("CREATE TABLE S (Id INTEGER PRIMARY KEY, Name TEXT);");
+    SQLite3Stmt ins_s(db, "INSERT INTO S (Id, Name) VALUES (?, ?)");
+    stats = ins_s.executeMany(points,
+        [](const Point & p) { return std::make_tuple(p.id, "point #" + std::to_string(p.id)); });
+    CHECK(stats.rows == 500);
+    SQLite3Stmt name(db, "SELECT Name FROM S WHERE Id = 1499");
+    CHECK(name());
+    CHECK(std::string(name.begin()->readText(0)) == "point #1499");
+
+    // a failing row rolls back its chunk; earlier chunks stay committed
+    std::vector<std::pair<int, double>> dups{{2000, 0.0}, {2001, 0.0}, {0, 0.0}};
+    SQLite3Stmt ins2(db, "INSERT INTO P (Id, X) VALUES (?, ?)");
+    opts.chunk_rows = 1;
+    bool thrown = false;
+    try
+    {
+        ins2.executeMany(dups, opts);
+    }
+    catch (const SQLite3Error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    SQLite3Stmt cnt(db, "SELECT count(*) FROM P");
+    CHECK(cnt());
+    CHECK(cnt.begin()->readInteger(0) == 1502);
+
+    return 0;
+}
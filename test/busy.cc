@@ -0,0 +1,134 @@
+#include <sqlite3w.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace hgl;
+using std::chrono::milliseconds;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char db_file[] = "test_busy.db";
+
+static bool try_insert(SQLite3 & db, int k)
+{
+    try
+    {
+        SQLite3Stmt ins(db, "INSERT INTO T VALUES (?)");
+        ins(k);
+        return true;
+    }
+    catch (const SQLite3Error &)
+    {
+        return false;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::remove(db_file);
+
+    {
+        SQLite3 holder(db_file), writer(db_file);
+        holder("CREATE TABLE T (K INTEGER);");
+
+        auto lock = std::make_unique<SQLite3::Transaction>(holder, SQLite3::TransactionMode::Exclusive);
+
+        writer.setBusyPolicy(SQLite3::BusyPolicy::throwImmediately());
+        CHECK(!try_insert(writer, 1));
+        auto stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 1 && stats.retries == 0);
+
+        writer.resetBusyStats();
+        writer.setBusyPolicy(SQLite3::BusyPolicy::backoff(milliseconds(1), milliseconds(8), milliseconds(40)));
+        auto const t0 = std::chrono::steady_clock::now();
+        CHECK(!try_insert(writer, 2));
+        auto const spent = std::chrono::steady_clock::now() - t0;
+        CHECK(spent >= milliseconds(40) && spent < milliseconds(1000));
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 1 && stats.retries > 1);
+        CHECK(stats.histogram[6] + stats.histogram[7] == 1); // waited 32..128 ms
+
+        // lock released while backing off
+        writer.resetBusyStats();
+        writer.setBusyPolicy(SQLite3::BusyPolicy::backoff(milliseconds(1), milliseconds(10), milliseconds(2000)));
+        std::thread releaser([&lock]
+        {
+            std::this_thread::sleep_for(milliseconds(30));
+            lock->commit();
+        });
+        CHECK(try_insert(writer, 3));
+        releaser.join();
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 0);
+        CHECK(stats.wait_us >= 20000);
+
+        // SQLite retries through the busy handler
+        lock = std::make_unique<SQLite3::Transaction>(holder, SQLite3::TransactionMode::Exclusive);
+        writer.resetBusyStats();
+        writer.setBusyPolicy(SQLite3::BusyPolicy::timeout(milliseconds(20)));
+        CHECK(!try_insert(writer, 4));
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 1 && stats.retries > 1);
+        CHECK(stats.wait_us >= 20000);
+        lock->commit();
+        CHECK(try_insert(writer, 5));
+        CHECK(writer.getBusyStats().events == 1);
+
+        lock = std::make_unique<SQLite3::Transaction>(holder, SQLite3::TransactionMode::Exclusive);
+        writer.resetBusyStats();
+        writer.setBusyPolicy(SQLite3::BusyPolicy::timeout(milliseconds(2000)));
+        std::thread releaser1([&lock]
+        {
+            std::this_thread::sleep_for(milliseconds(30));
+            lock->commit();
+        });
+        CHECK(try_insert(writer, 7));
+        releaser1.join();
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 0 && stats.wait_us >= 20000);
+
+        // a wait inside db("...") is settled there, not by the next statement
+        lock = std::make_unique<SQLite3::Transaction>(holder, SQLite3::TransactionMode::Exclusive);
+        writer.resetBusyStats();
+        std::thread releaser3([&lock]
+        {
+            std::this_thread::sleep_for(milliseconds(30));
+            lock->commit();
+        });
+        writer("INSERT INTO T VALUES (8);");
+        releaser3.join();
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 0 && stats.wait_us >= 20000);
+        const auto waited = stats.wait_us;
+        std::this_thread::sleep_for(milliseconds(100));
+        CHECK(try_insert(writer, 9));
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.wait_us == waited);
+
+        // transaction control backs off too
+        lock = std::make_unique<SQLite3::Transaction>(holder, SQLite3::TransactionMode::Exclusive);
+        writer.resetBusyStats();
+        writer.setBusyPolicy(SQLite3::BusyPolicy::backoff(milliseconds(1), milliseconds(10), milliseconds(2000)));
+        std::thread releaser2([&lock]
+        {
+            std::this_thread::sleep_for(milliseconds(30));
+            lock->commit();
+        });
+        {
+            SQLite3::Transaction txn(writer, SQLite3::TransactionMode::Immediate);
+            CHECK(try_insert(writer, 6));
+            txn.commit();
+        }
+        releaser2.join();
+        stats = writer.getBusyStats();
+        CHECK(stats.events == 1 && stats.failures == 0 && stats.wait_us >= 20000);
+    }
+
+    std::remove(db_file);
+    return 0;
+}
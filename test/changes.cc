@@ -0,0 +1,189 @@
+#include <sqlite3w.h>
+#include <sqlite3w_changes.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY, V TEXT); CREATE TABLE U (K INTEGER PRIMARY KEY);");
+
+    auto changes = db.watchChanges(64);
+    CHECK(changes->capacity() == 64 && db.watchChanges() == changes);
+
+    ChangeEvent buf[16];
+
+    // autocommit statements publish at once
+    db("INSERT INTO T VALUES (1, 'a'), (2, 'b');");
+    CHECK(changes->drain(buf) == 2);
+    CHECK(buf[0].op == ChangeEvent::Op::Insert && buf[0].rowid == 1 && buf[1].rowid == 2);
+    CHECK(std::strcmp(buf[0].table, "T") == 0 && buf[0].table == buf[1].table);
+    CHECK(changes->drain(buf) == 0);
+
+    // transactions publish on commit only
+    {
+        SQLite3::Transaction txn(db);
+        db("UPDATE T SET V = 'x' WHERE K = 1; DELETE FROM T WHERE K = 2; INSERT INTO U VALUES (7);");
+        CHECK(changes->drain(buf) == 0);
+        txn.commit();
+    }
+    CHECK(changes->drain(buf) == 3);
+    CHECK(buf[0].op == ChangeEvent::Op::Update && buf[0].rowid == 1);
+    CHECK(buf[1].op == ChangeEvent::Op::Delete && buf[1].rowid == 2);
+    CHECK(buf[2].op == ChangeEvent::Op::Insert && std::strcmp(buf[2].table, "U") == 0);
+
+    // rolled back work leaves nothing behind
+    {
+        SQLite3::Transaction txn(db);
+        db("INSERT INTO T VALUES (3, 'c');");
+    }
+    CHECK(changes->drain(buf) == 0);
+
+    {
+        SQLite3::Transaction txn(db);
+        db("INSERT INTO T VALUES (4, 'd');");
+        {
+            SQLite3::Savepoint sp(db);
+            db("INSERT INTO T VALUES (5, 'e');");
+        }
+        {
+            SQLite3::Savepoint sp(db);
+            db("INSERT INTO T VALUES (6, 'f');");
+            sp.commit();
+        }
+        txn.commit();
+    }
+    CHECK(changes->drain(buf) == 2 && buf[0].rowid == 4 && buf[1].rowid == 6);
+
+    // a failing statement leaves nothing behind, unless OR FAIL keeps its rows
+    {
+        SQLite3::Transaction txn(db);
+        CHECK(!db.tryExec("INSERT INTO T VALUES (7, 'g'), (8, 'h'), (7, 'g');"));
+        SQLite3Stmt ins(db, "INSERT INTO T VALUES (?, 'i'), (?, 'j')");
+        CHECK(!ins.tryExec(9, 9));
+        CHECK(!db.tryExec("INSERT OR FAIL INTO T VALUES (10, 'k'), (11, 'l'), (10, 'k');"));
+        txn.commit();
+    }
+    CHECK(changes->drain(buf) == 2 && buf[0].rowid == 10 && buf[1].rowid == 11);
+    {
+        SQLite3Stmt cnt(db, "SELECT count(*) FROM T WHERE K IN (7, 8, 9)");
+        CHECK(cnt() && cnt.begin()->readInteger(0) == 0);
+    }
+
+    // savepoints in SQL, through exec and through (cached) statements
+    db("BEGIN; INSERT INTO U VALUES (1); SAVEPOINT a; INSERT INTO U VALUES (2); ROLLBACK TO a; RELEASE a; COMMIT;");
+    CHECK(changes->drain(buf) == 1 && buf[0].rowid == 1);
+    db("DELETE FROM U WHERE K < 100;");
+    CHECK(changes->drain(buf) == 2);
+    for (int i = 0; i < 2; i++)
+    {
+        SQLite3::Transaction txn(db);
+        SQLite3Stmt begin(db, "SAVEPOINT Outer");
+        begin();
+        db("INSERT INTO U VALUES (3); SAVEPOINT inner; INSERT INTO U VALUES (4);");
+        SQLite3Stmt undo(db, "ROLLBACK TO outer");
+        undo();
+        db("INSERT INTO U VALUES (5); RELEASE outer;");
+        txn.commit();
+        CHECK(changes->drain(buf) == 1 && buf[0].rowid == 5);
+        db("DELETE FROM U WHERE K < 100;");
+        CHECK(changes->drain(buf) == 1);
+    }
+    {
+        int rows = 0;
+        db("SAVEPOINT s; INSERT INTO U VALUES (6); ROLLBACK TO s; SELECT 1; RELEASE s;",
+            [](void * n, int, char **, char **) { ++*static_cast<int *>(n); return 0; }, &rows);
+        CHECK(rows == 1 && changes->drain(buf) == 0);
+    }
+
+    // a COMMIT that fails leaves the events pending, to be dropped by the rollback
+    {
+        std::remove("test_changes.db");
+        SQLite3 writer("test_changes.db"), reader("test_changes.db");
+        writer("CREATE TABLE F (K INTEGER PRIMARY KEY);");
+        writer.setBusyPolicy(SQLite3::BusyPolicy::throwImmediately());
+        auto fs = writer.watchChanges(8);
+        {
+            SQLite3::Transaction txn(writer);
+            writer("INSERT INTO F VALUES (1);");
+            SQLite3::Transaction read(reader);
+            SQLite3Stmt sel(reader, "SELECT count(*) FROM F");
+            CHECK(sel()); // holds a SHARED lock, so COMMIT cannot write
+            bool busy = false;
+            try { txn.commit(); } catch (const SQLite3Error & e) { busy = (e.errcode() & 0xff) == 5; } // SQLITE_BUSY
+            CHECK(busy && writer.inTransaction());
+            CHECK(fs->drain(buf) == 0);
+        }
+        CHECK(fs->drain(buf) == 0);
+        {
+            SQLite3::Transaction txn(writer);
+            writer("INSERT INTO F VALUES (2);");
+            txn.commit();
+        }
+        CHECK(fs->drain(buf) == 1 && buf[0].rowid == 2);
+    }
+    std::remove("test_changes.db");
+
+    // "DELETE FROM t" reports every row, and DROP still works
+    db("CREATE TABLE W (K INTEGER PRIMARY KEY); INSERT INTO W VALUES (1), (2), (3);");
+    CHECK(changes->drain(buf) == 3);
+    db("DELETE FROM W;");
+    CHECK(changes->drain(buf) == 3 && buf[2].op == ChangeEvent::Op::Delete);
+    db("DROP TABLE W;");
+    CHECK(!db.tryExec("SELECT * FROM W;"));
+
+    // overflow drops and counts
+    {
+        SQLite3::Transaction txn(db);
+        SQLite3Stmt ins(db, "INSERT INTO U VALUES (?)");
+        for (int i = 100; i < 200; i++)
+        {
+            ins(i);
+            ins.reset();
+        }
+        txn.commit();
+    }
+    CHECK(changes->dropped() == 100 - 64);
+    std::size_t taken = 0;
+    for (std::size_t n; (n = changes->drain(buf)) != 0; )
+        taken += n;
+    CHECK(taken == 64);
+
+    // consumer thread
+    std::vector<std::int64_t> seen;
+    std::thread consumer([&]
+    {
+        ChangeEvent batch[8];
+        while (changes->wait())
+        {
+            for (std::size_t i = 0, n = changes->drain(batch); i < n; i++)
+                seen.push_back(batch[i].rowid);
+        }
+    });
+    SQLite3Stmt ins(db, "INSERT INTO T VALUES (?, 'g')");
+    for (int i = 1000; i < 1020; i++)
+    {
+        ins(i);
+        ins.reset();
+    }
+    db.unwatchChanges(); // the consumer still gets what is queued
+
+    consumer.join();
+    CHECK(changes->closed());
+    CHECK(seen.size() == 20 && seen.front() == 1000 && seen.back() == 1019);
+
+    db("INSERT INTO T VALUES (2000, 'h');");
+    CHECK(changes->drain(buf) == 0);
+
+    return EXIT_SUCCESS;
+}
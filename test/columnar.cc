@@ -0,0 +1,172 @@
+#include <sqlite3w_columnar.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char * const filename = "test_columnar.col";
+static constexpr int rc_mismatch = 20;
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE M (Id INTEGER PRIMARY KEY, V REAL, Tag TEXT);");
+    {
+        SQLite3::Transaction txn(db);
+        SQLite3Stmt ins(db, "INSERT INTO M (Id, V, Tag) VALUES (?, ?, ?)");
+        for (int i = 0; i < 1000; i++)
+        {
+            if (i % 10 == 0)
+                ins(i, nullptr, nullptr);
+            else
+                ins(i, i * 0.5, "tag" + std::to_string(i));
+            ins.reset();
+        }
+        txn.commit();
+    }
+
+    // several row groups, one of them partial
+    {
+        SQLite3Stmt sel(db, "SELECT Id, V, Tag, CAST(ifnull(Tag, x'') AS BLOB) AS Raw FROM M ORDER BY Id");
+        ColumnarFile::WriteOptions opts;
+        opts.group_rows = 300;
+        const auto st = ColumnarFile::write(sel, filename, opts);
+        CHECK(st.rows == 1000);
+        CHECK(st.groups == 4);
+        CHECK(st.bytes > 1000 * 8 * 3);
+    }
+    {
+        ColumnarFile file(filename);
+        CHECK(file.columnCount() == 4);
+        CHECK(file.rowCount() == 1000);
+        CHECK(file.groupCount() == 4);
+        CHECK(file.groupRows(3) == 100);
+        CHECK(file.columnName(1) == "V");
+        CHECK(file.columnIndex("Tag") == 2);
+        CHECK(file.columnIndex("Raw") == 3);
+        CHECK(file.columnIndex("Nope") == -1);
+        CHECK(file.columnType(0) == SQLite3Stmt::Type::Integer);
+        CHECK(file.columnType(1) == SQLite3Stmt::Type::Float);
+        CHECK(file.columnType(2) == SQLite3Stmt::Type::Text);
+        CHECK(file.columnType(3) == SQLite3Stmt::Type::Blob);
+
+        std::int64_t id_sum = 0, expect_id_sum = 0;
+        double v_sum = 0, expect_v_sum = 0;
+        std::size_t nulls = 0, row = 0;
+        bool text_ok = true;
+        for (std::size_t g = 0; g < file.groupCount(); g++)
+        {
+            const auto ids = file.chunk(g, 0);
+            const auto vs = file.chunk(g, 1);
+            const auto tags = file.chunk(g, 2);
+            const auto raw = file.chunk(g, 3);
+            CHECK(ids.rows == file.groupRows(g));
+            CHECK(ids.ints.size() == ids.rows);
+            for (std::size_t r = 0; r < ids.rows; r++, row++)
+            {
+                id_sum += ids.ints[r];
+                v_sum += vs.floats[r];
+                if (vs.isNull(r))
+                {
+                    nulls++;
+                    text_ok = text_ok && tags.isNull(r) && tags.text(r).empty();
+                }
+                else
+                {
+                    const auto expect = "tag" + std::to_string(row);
+                    text_ok = text_ok && tags.text(r) == expect && raw.blob(r).size() == expect.size();
+                }
+            }
+        }
+        for (int i = 0; i < 1000; i++)
+        {
+            expect_id_sum += i;
+            if (i % 10 != 0)
+                expect_v_sum += i * 0.5;
+        }
+        CHECK(id_sum == expect_id_sum);
+        CHECK(v_sum == expect_v_sum);
+        CHECK(nulls == 100);
+        CHECK(text_ok);
+    }
+
+    // rewrite in place from a statement already stepped; an empty result keeps the columns
+    {
+        SQLite3Stmt sel(db, "SELECT Id, Tag FROM M WHERE Id >= ? ORDER BY Id");
+        CHECK(sel(995));
+        CHECK(ColumnarFile::write(sel, filename).rows == 5);
+        ColumnarFile file(filename);
+        CHECK(file.groupCount() == 1);
+        CHECK(file.chunk(0, 0).ints[0] == 995);
+        CHECK(file.chunk(0, 1).text(4) == "tag999");
+    }
+    {
+        SQLite3Stmt sel(db, "SELECT Id, Tag FROM M WHERE Id < 0");
+        CHECK(ColumnarFile::write(sel, filename).rows == 0);
+        ColumnarFile file(filename);
+        CHECK(file.columnCount() == 2);
+        CHECK(file.columnName(1) == "Tag");
+        CHECK(file.rowCount() == 0);
+        CHECK(file.groupCount() == 0);
+    }
+
+    // values are never coerced to the type of the first row
+    db("CREATE TABLE N (Id INTEGER PRIMARY KEY, V NUMERIC);"
+       "INSERT INTO N VALUES (1, NULL), (2, 3), (3, 2.5), (4, 7), (5, 'n/a');");
+    {
+        SQLite3Stmt sel(db, "SELECT V FROM N WHERE Id <= ? ORDER BY Id");
+        sel.bindInteger(1, 4);
+        ColumnarFile::WriteOptions opts;
+        opts.group_rows = 3;
+        CHECK(ColumnarFile::write(sel, filename, opts).rows == 4);
+        ColumnarFile file(filename);
+        CHECK(file.columnType(0) == SQLite3Stmt::Type::Unknown);
+        const auto g0 = file.chunk(0, 0), g1 = file.chunk(1, 0);
+        CHECK(g0.type == SQLite3Stmt::Type::Float && g0.isNull(0) && g0.floats[1] == 3.0 && g0.floats[2] == 2.5);
+        CHECK(g1.type == SQLite3Stmt::Type::Integer && g1.ints[0] == 7);
+
+        sel.reset();
+        sel.bindInteger(1, 5);
+        bool thrown = false;
+        try { ColumnarFile::write(sel, filename); } catch (const SQLite3Error & e) { thrown = e.errcode() == rc_mismatch; }
+        CHECK(thrown);
+        sel.reset();
+    }
+
+    // damaged or foreign files are rejected
+    {
+        std::ofstream(filename, std::ios::binary | std::ios::trunc) << "SQLite format 3, not columnar at all";
+        bool thrown = false;
+        try { ColumnarFile file(filename); } catch (const std::runtime_error &) { thrown = true; }
+        CHECK(thrown);
+
+        // a text offset past its heap: header, null bitmap, then offsets 0 and 3
+        SQLite3Stmt sel(db, "SELECT 'abc'");
+        ColumnarFile::write(sel, filename);
+        {
+            std::fstream f(filename, std::ios::binary | std::ios::in | std::ios::out);
+            const std::uint64_t off = 1 << 20;
+            f.seekp(16 + 8 + 8);
+            f.write(reinterpret_cast<const char *>(&off), sizeof off);
+        }
+        thrown = false;
+        try { ColumnarFile file(filename); } catch (const std::runtime_error &) { thrown = true; }
+        CHECK(thrown);
+
+        thrown = false;
+        try { ColumnarFile file("test_columnar_missing.col"); } catch (const std::system_error &) { thrown = true; }
+        CHECK(thrown);
+    }
+
+    std::remove(filename);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <sqlite3w.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+struct Mean
+{
+    double sum;
+    std::int64_t n;
+};
+
+struct Concat
+{
+    std::string text;
+};
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE P (Id INTEGER PRIMARY KEY, X REAL, Y REAL, Tag TEXT);");
+    db("INSERT INTO P VALUES (1, 0, 0, 'a'), (2, 3, 4, 'b'), (3, 6, 8, NULL), (4, 1, 1, 'c');");
+
+    // scalar functions: typed arguments and results
+    db.defineFunction("dist", [](double x, double y) { return std::sqrt(x * x + y * y); },
+        SQLite3::Deterministic | SQLite3::Innocuous);
+    db.defineFunction("tag_or", [](std::optional<std::string_view> tag, const std::string & fallback)
+        { return tag ? std::string(*tag) : fallback; });
+    db.defineFunction("always_null", [](std::int64_t) -> std::optional<std::int64_t> { return std::nullopt; });
+    db.defineFunction("fail", [](std::int64_t) -> std::int64_t { throw std::runtime_error("boom"); });
+
+    {
+        SQLite3Stmt sel(db, "SELECT Id FROM P WHERE dist(X, Y) BETWEEN 4 AND 6");
+        CHECK(sel());
+        CHECK(sel.begin()->readInteger(0) == 2);
+    }
+    {
+        SQLite3Stmt sel(db, "SELECT tag_or(Tag, 'none'), always_null(1) IS NULL FROM P WHERE Id = 3");
+        CHECK(sel());
+        auto row = sel.begin();
+        CHECK(std::string(row->readText(0)) == "none");
+        CHECK(row->readInteger(1) == 1);
+    }
+    {
+        bool thrown = false;
+        try
+        {
+            SQLite3Stmt sel(db, "SELECT fail(1)");
+            sel();
+        }
+        catch (const SQLite3Error & e)
+        {
+            thrown = std::string(e.what()) == "boom";
+        }
+        CHECK(thrown);
+    }
+
+    // aggregates
+    db.defineAggregate<Mean>("mean",
+        [](Mean & m, double v) { m.sum += v; m.n++; },
+        [](Mean & m) -> std::optional<double> { if (m.n == 0) return std::nullopt; return m.sum / m.n; });
+    db.defineAggregate<Concat>("tags",
+        [](Concat & c, std::optional<std::string_view> t) { if (t) c.text += *t; },
+        [](const Concat & c) { return c.text; });
+
+    {
+        SQLite3Stmt sel(db, "SELECT mean(X), tags(Tag) FROM P");
+        CHECK(sel());
+        auto row = sel.begin();
+        CHECK(row->readFloat(0) == 2.5);
+        CHECK(std::string(row->readText(1)) == "abc");
+    }
+    {
+        SQLite3Stmt sel(db, "SELECT mean(X) IS NULL FROM P WHERE Id > 100");
+        CHECK(sel());
+        CHECK(sel.begin()->readInteger(0) == 1);
+    }
+
+    // window function: moving sum
+    db.defineWindow<std::int64_t>("msum",
+        [](std::int64_t & s, std::int64_t v) { s += v; },
+        [](std::int64_t & s, std::int64_t v) { s -= v; },
+        [](std::int64_t & s) { return s; });
+    {
+        SQLite3Stmt sel(db, "SELECT msum(Id) OVER (ORDER BY Id ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM P");
+        CHECK(sel());
+        std::vector<std::int64_t> sums;
+        for (auto [s]: sel.rows<std::int64_t>())
+            sums.push_back(s);
+        CHECK((sums == std::vector<std::int64_t>{1, 3, 5, 7}));
+    }
+
+    db.removeFunction("dist", 2);
+    bool thrown = false;
+    try
+    {
+        SQLite3Stmt sel(db, "SELECT dist(1, 1)");
+    }
+    catch (const SQLite3Error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static constexpr int rc_range = 25;
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY, Name TEXT, Score REAL);");
+
+    // literal names are hashed at compile time
+    static_assert(SQLite3Stmt::Name(":k").hash == SQLite3Stmt::Name::_hash(":k"));
+
+    {
+        SQLite3Stmt ins(db, "INSERT INTO T (K, Name, Score) VALUES (:k, @name, $score)");
+        CHECK(ins.paramIndex(":k") == 1 && ins.paramIndex("@name") == 2 && ins.paramIndex("$score") == 3);
+        CHECK(ins.paramIndex(":missing") == 0 && ins.paramIndex("k") == 0);
+
+        for (int i = 1; i <= 3; i++)
+        {
+            ins.bind("$score", i * 1.5);
+            ins.bind("@name", std::string("user") + std::to_string(i));
+            ins.bind(":k", i);
+            ins();
+            ins.reset();
+        }
+
+        bool threw = false;
+        try
+        {
+            ins.bind(":nope", 1);
+        }
+        catch (const SQLite3Error &)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(ins.tryBind(":nope", 1).errcode() == rc_range);
+        CHECK(ins.tryBind(std::string(":k"), 4));
+    }
+
+    // anonymous and numbered parameters mix with named ones
+    {
+        SQLite3Stmt sel(db, "SELECT count(*) FROM T WHERE K >= ? AND Score < :max");
+        CHECK(sel.paramIndex(":max") == 2);
+        sel.bindInteger(1, 2);
+        sel.bind(":max", 10.0);
+        CHECK(sel() && sel.begin()->readInteger(0) == 2);
+    }
+
+    // columns by name, including aliases
+    {
+        SQLite3Stmt sel(db, "SELECT Name, Score * 2 AS Doubled, K FROM T WHERE K = :k");
+        CHECK(sel.columnIndex("K") == 2 && sel.columnIndex("Doubled") == 1 && sel.columnIndex("k") == -1);
+        sel.bind(":k", 2);
+        CHECK(sel());
+        auto row = sel.begin();
+        CHECK((*row)["K"].read<int>() == 2);
+        CHECK(std::string(row->readText((*row)["Name"].col)) == "user2");
+        CHECK(row->read<double>("Doubled") == 6.0);
+        CHECK((*row)["Name"].type() == SQLite3Stmt::Type::Text);
+
+        bool threw = false;
+        try
+        {
+            (void)(*row)["Score"];
+        }
+        catch (const std::out_of_range &)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // the tables are kept with the cached statement
+    for (int k = 1; k <= 3; k++)
+    {
+        SQLite3Stmt sel(db, "SELECT * FROM T WHERE K = :k");
+        sel.bind(":k", k);
+        CHECK(sel());
+        CHECK(sel.begin()->read<int>("K") == k);
+    }
+
+    // "SELECT *" sees columns added later
+    db("ALTER TABLE T ADD COLUMN Extra INTEGER DEFAULT 7;");
+    {
+        SQLite3Stmt sel(db, "SELECT * FROM T WHERE K = :k");
+        sel.bind(":k", 1);
+        CHECK(sel());
+        auto row = sel.begin();
+        CHECK(row->read<int>("Extra") == 7 && row->read<int>("K") == 1);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include <sqlite3w.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char db_file[] = "test_open_options.db";
+
+static void remove_db()
+{
+    std::remove(db_file);
+    std::remove("test_open_options.db-journal");
+    std::remove("test_open_options.db-wal");
+    std::remove("test_open_options.db-shm");
+}
+
+static std::string pragma(SQLite3 & db, const char * sql)
+{
+    SQLite3Stmt stmt(db, sql);
+    if (!stmt())
+        return std::string();
+    return stmt.begin()->readText(0);
+}
+
+int main(int argc, char const *argv[])
+{
+    remove_db();
+
+    // opening a missing file without Create fails
+    {
+        SQLite3::OpenOptions opts;
+        opts.flags = SQLite3::OpenOptions::ReadWrite;
+        bool thrown = false;
+        try
+        {
+            SQLite3 db(db_file, opts);
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // preset applied at open
+    {
+        auto opts = SQLite3::OpenOptions::readMostlyMmap(64 << 20);
+        opts.page_size = 8192;
+        SQLite3 db(db_file, opts);
+        CHECK(pragma(db, "PRAGMA journal_mode") == "wal");
+        CHECK(pragma(db, "PRAGMA synchronous") == "1");
+        CHECK(pragma(db, "PRAGMA mmap_size") == std::to_string(64 << 20));
+        CHECK(pragma(db, "PRAGMA cache_size") == "-16384");
+        CHECK(pragma(db, "PRAGMA temp_store") == "2");
+        CHECK(pragma(db, "PRAGMA page_size") == "8192");
+        db("CREATE TABLE T (K INTEGER PRIMARY KEY); INSERT INTO T VALUES (1);");
+    }
+
+    // read-only connection
+    {
+        SQLite3 db(db_file, SQLite3::OpenOptions::readOnly());
+        CHECK(pragma(db, "SELECT count(*) FROM T") == "1");
+        bool thrown = false;
+        try
+        {
+            db("INSERT INTO T VALUES (2);");
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // unsafe bulk-load preset on a reopened connection
+    {
+        SQLite3 db;
+        db.open(db_file, SQLite3::OpenOptions::bulkLoadUnsafe());
+        CHECK(pragma(db, "PRAGMA synchronous") == "0");
+        CHECK(pragma(db, "PRAGMA cache_size") == "-65536");
+        db("INSERT INTO T VALUES (2);");
+        CHECK(pragma(db, "SELECT count(*) FROM T") == "2");
+    }
+
+    // a journal mode that does not take effect fails the open
+    {
+        bool thrown = false;
+        try
+        {
+            SQLite3 db(":memory:", SQLite3::OpenOptions::durable());
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    // in-memory database through a URI
+    {
+        SQLite3::OpenOptions opts;
+        opts.flags |= SQLite3::OpenOptions::Uri;
+        SQLite3 db("file:mem_db?mode=memory", opts);
+        db("CREATE TABLE M (X);");
+        CHECK(pragma(db, "SELECT count(*) FROM M") == "0");
+    }
+
+    remove_db();
+    return 0;
+}
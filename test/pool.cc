@@ -0,0 +1,113 @@
+#include <sqlite3w_pool.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char db_file[] = "test_pool.db";
+
+static void remove_db()
+{
+    std::remove(db_file);
+    std::remove("test_pool.db-wal");
+    std::remove("test_pool.db-shm");
+}
+
+int main(int argc, char const *argv[])
+{
+    remove_db();
+
+    {
+        bool thrown = false;
+        try { SQLite3Pool pool(db_file, 0); } catch (const std::invalid_argument &) { thrown = true; }
+        CHECK(thrown);
+    }
+
+    {
+        SQLite3Pool pool(db_file, 4);
+        CHECK(pool.readerCount() == 4);
+
+        {
+            auto w = pool.writer();
+            (*w)("CREATE TABLE T (K INTEGER PRIMARY KEY, V INTEGER);");
+        }
+
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+
+        threads.emplace_back([&pool]
+        {
+            for (int i = 0; i < 200; i++)
+            {
+                auto w = pool.writer();
+                SQLite3Stmt ins(*w, "INSERT INTO T (K, V) VALUES (?, ?)");
+                ins(i, i * 2);
+            }
+        });
+
+        for (int t = 0; t < 8; t++)
+        {
+            threads.emplace_back([&pool, &failed]
+            {
+                std::int64_t last = 0;
+                for (int i = 0; i < 200; i++)
+                {
+                    auto r = pool.reader();
+                    SQLite3Stmt sel(*r, "SELECT count(*) FROM T");
+                    if (!sel())
+                        failed = true;
+                    const auto n = sel.begin()->readInteger(0);
+                    if (n < last)
+                        failed = true;
+                    last = n;
+                }
+            });
+        }
+
+        for (auto & th: threads)
+            th.join();
+        CHECK(!failed);
+
+        // readers reject writes
+        {
+            auto r = pool.reader();
+            bool thrown = false;
+            try
+            {
+                (*r)("INSERT INTO T (K, V) VALUES (-1, 0);");
+            }
+            catch (const SQLite3Error &)
+            {
+                thrown = true;
+            }
+            CHECK(thrown);
+        }
+
+        // all readers leased: tryReader() comes back empty
+        {
+            std::vector<SQLite3Pool::Lease> leases;
+            for (std::size_t i = 0; i < pool.readerCount(); i++)
+                leases.push_back(pool.reader());
+            CHECK(!pool.tryReader());
+            leases.pop_back();
+            CHECK(pool.tryReader());
+        }
+
+        auto r = pool.reader();
+        SQLite3Stmt sel(*r, "SELECT count(*) FROM T");
+        CHECK(sel());
+        CHECK(sel.begin()->readInteger(0) == 200);
+    }
+
+    remove_db();
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY, V INTEGER);");
+    {
+        SQLite3Stmt ins(db, "INSERT INTO T (K, V) VALUES (?, ?)");
+        for (int i = 0; i < 100; i++)
+        {
+            ins(i, 100 - i);
+            ins.reset();
+        }
+    }
+
+    // disabled: nothing is collected
+    CHECK(!db.isProfiling());
+    CHECK(db.getProfile().empty());
+
+    db.setProfiling(true);
+
+    SQLite3Stmt scan(db, "SELECT K FROM T WHERE V > ? ORDER BY V");
+    scan.bindInteger(1, 0);
+    for (int i = 0; i < 3; i++)
+    {
+        for (auto [k]: scan.rows<int>())
+            (void)k;
+    }
+    SQLite3Stmt point(db, "SELECT V FROM T WHERE K = ?");
+    CHECK(point(5));
+    point.reset();
+
+    auto prof = scan.getProfile();
+    CHECK(prof.runs == 3);
+    CHECK(prof.rows == 300);
+    CHECK(prof.fullscan_steps > 0);
+    CHECK(prof.sorts == 3);
+    CHECK(prof.vm_steps > 0);
+
+    auto pprof = point.getProfile();
+    CHECK(pprof.runs == 1);
+    CHECK(pprof.rows == 1);
+    CHECK(pprof.fullscan_steps == 0);
+
+    std::uint64_t hist_total = 0;
+    for (auto h: prof.histogram)
+        hist_total += h;
+    CHECK(prof.steps == 303);
+    CHECK(hist_total == prof.steps);
+    CHECK(prof.total_ns > 0);
+
+    auto json = db.getProfileJSON();
+    CHECK(json.front() == '[' && json.back() == ']');
+    CHECK(json.find("\"sql\":\"SELECT K FROM T WHERE V > ? ORDER BY V\"") != std::string::npos);
+    std::cout << json << '\n';
+
+    // a finalized statement's addresses reused by another one
+    db.setStmtCacheCapacity(0);
+    for (const char * sql: {"SELECT V FROM T WHERE K = 1", "SELECT V FROM T WHERE K = 2",
+            "SELECT V FROM T WHERE K = 3", "SELECT V FROM T WHERE K = 4"})
+    {
+        SQLite3Stmt one(db, sql);
+        for (auto [v]: one.rows<int>())
+            (void)v;
+        CHECK(one.getProfile().runs == 1);
+    }
+    db.setStmtCacheCapacity(SQLite3::default_stmt_cache_capacity);
+
+    db.setProfiling(false);
+    db.resetProfile();
+    CHECK(point(6));
+    point.reset();
+    CHECK(db.getProfile().empty());
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+    db("CREATE TABLE Config (App TEXT, Name TEXT, Value INTEGER);"
+       "CREATE TABLE Other (X);"
+       "CREATE VIEW Apps AS SELECT DISTINCT App FROM Config;"
+       "INSERT INTO Config VALUES ('a', 'x', 1), ('a', 'y', 2), ('b', 'x', NULL);");
+
+    const char * const by_app = "SELECT Name, Value FROM Config WHERE App = ? ORDER BY Name";
+    using Row = std::tuple<std::string, std::optional<std::int64_t>>;
+
+    // disabled: nothing is stored
+    CHECK(db.cachedQuery<std::string>("SELECT Name FROM Config").size() == 3);
+    CHECK(db.getQueryCacheStats().stores == 0 && db.getQueryCacheStats().budget == 0);
+
+    db.enableQueryCache(1 << 20);
+
+    auto query_app = [&db, by_app](const char * app)
+        { return db.cachedQuery<std::string, std::optional<std::int64_t>>(by_app, app); };
+
+    auto a = query_app("a");
+    CHECK((a == std::vector<Row>{{"x", 1}, {"y", 2}}));
+    auto again = db.cachedQuery<std::string, std::optional<std::int64_t>>(by_app, std::string("a"));
+    CHECK(again == a);
+    auto b = query_app("b");
+    CHECK((b == std::vector<Row>{{"x", std::nullopt}}));
+    auto s = db.getQueryCacheStats();
+    CHECK(s.hits == 1 && s.misses == 2 && s.stores == 2 && s.entries == 2 && s.bytes > 0);
+
+    // the column types are part of the key
+    CHECK((db.cachedQuery<std::string, double>(by_app, "a").size() == 2));
+    CHECK(db.getQueryCacheStats().entries == 3);
+
+    // changes to other tables keep the results
+    db("INSERT INTO Other VALUES (1);");
+    query_app("a");
+    CHECK(db.getQueryCacheStats().hits == 2);
+
+    // changes to a table read drop them
+    db("UPDATE Config SET Value = 10 WHERE Name = 'y';");
+    a = query_app("a");
+    CHECK((a == std::vector<Row>{{"x", 1}, {"y", 10}}));
+    CHECK(db.getQueryCacheStats().stale == 1);
+
+    // through views and aggregates
+    CHECK(db.cachedQuery<std::string>("SELECT App FROM Apps ORDER BY App").size() == 2);
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Config").front() == std::tuple(3));
+    db("INSERT INTO Config VALUES ('c', 'x', 3);");
+    CHECK(db.cachedQuery<std::string>("SELECT App FROM Apps ORDER BY App").size() == 3);
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Config").front() == std::tuple(4));
+
+    // "DELETE FROM t" is seen too, despite the truncate optimization
+    db("DELETE FROM Config;");
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Config").front() == std::tuple(0));
+    db("INSERT INTO Config VALUES ('a', 'x', 1);");
+
+    // transactions bypass the cache: their changes may be rolled back
+    const auto before = db.getQueryCacheStats();
+    {
+        SQLite3::Transaction txn(db);
+        db("INSERT INTO Config VALUES ('a', 'z', 5);");
+        CHECK(query_app("a").size() == 2);
+    }
+    CHECK(db.getQueryCacheStats().misses == before.misses && db.getQueryCacheStats().hits == before.hits);
+    CHECK(query_app("a").size() == 1);
+
+    // statements that write are run, never stored
+    const auto stores = db.getQueryCacheStats().stores;
+    CHECK(db.cachedQuery<std::int64_t>("INSERT INTO Other VALUES (2) RETURNING X").size() == 1);
+    CHECK(db.cachedQuery<std::int64_t>("INSERT INTO Other VALUES (2) RETURNING X").size() == 1);
+    CHECK(db.getQueryCacheStats().stores == stores);
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Other").front() == std::tuple(3));
+
+    // WITHOUT ROWID tables are not reported by the update hook: never stored
+    db("CREATE TABLE Kv (K TEXT PRIMARY KEY, V) WITHOUT ROWID; INSERT INTO Kv VALUES ('k', 1);");
+    const auto kv_stores = db.getQueryCacheStats().stores;
+    CHECK(db.cachedQuery<std::int64_t>("SELECT V FROM Kv").front() == std::tuple(1));
+    db("UPDATE Kv SET V = 2;");
+    CHECK(db.cachedQuery<std::int64_t>("SELECT V FROM Kv").front() == std::tuple(2));
+    CHECK(db.getQueryCacheStats().stores == kv_stores);
+
+    // nor are incremental blob writes
+    db("CREATE TABLE Bin (B BLOB); INSERT INTO Bin VALUES (x'00');");
+    CHECK(db.cachedQuery<std::int64_t>("SELECT B = x'00' FROM Bin").front() == std::tuple(1));
+    {
+        SQLite3::BlobStream blob(db, "Bin", "B", 1, true);
+        const std::byte ff[] = {std::byte{0xff}};
+        blob.write(ff);
+    }
+    CHECK(db.cachedQuery<std::int64_t>("SELECT B = x'00' FROM Bin").front() == std::tuple(0));
+
+    // DDL clears everything
+    db("DROP VIEW Apps;");
+    CHECK(db.getQueryCacheStats().entries == 0);
+    bool threw = false;
+    try
+    {
+        db.cachedQuery<std::string>("SELECT App FROM Apps");
+    }
+    catch (const SQLite3Error &)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // the budget is enforced with LRU eviction
+    db.enableQueryCache(1024);
+    for (int i = 0; i < 50; i++)
+        db.cachedQuery<std::int64_t>("SELECT ? + Value FROM Config", i);
+    s = db.getQueryCacheStats();
+    CHECK(s.bytes <= 1024 && s.evictions > 0 && s.entries < 50);
+    db.cachedQuery<std::int64_t>("SELECT ? + Value FROM Config", 49);
+    CHECK(db.getQueryCacheStats().hits == s.hits + 1);
+
+    // nor backups into the connection
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Bin").front() == std::tuple(1));
+    {
+        SQLite3 src;
+        src("CREATE TABLE Bin (B BLOB); INSERT INTO Bin VALUES (x'00'), (x'00');");
+        SQLite3::backup(db, src);
+    }
+    CHECK(db.cachedQuery<std::int64_t>("SELECT count(*) FROM Bin").front() == std::tuple(2));
+
+    db.disableQueryCache();
+    CHECK(db.getQueryCacheStats().entries == 0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char scan_sql[]       = "SELECT K FROM T WHERE B = ? ORDER BY B";
+static const char sort_sql[]       = "SELECT K FROM T WHERE A > ? ORDER BY B";
+static const char index_sql[]      = "SELECT K FROM T WHERE A = ?";
+static const char index_scan_sql[] = "SELECT A FROM T ORDER BY A";
+static const char join_sql[]       = "SELECT T.K FROM T, U WHERE T.B = U.B";
+static const char cte_sql[]        =
+    "WITH RECURSIVE S(N) AS (SELECT 1 UNION ALL SELECT N + 1 FROM S WHERE N < 5) SELECT N FROM S";
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY, A INTEGER, B TEXT);"
+       "CREATE INDEX TA ON T (A);"
+       "CREATE TABLE U (X INTEGER, B TEXT);");
+
+    CHECK(db.explainPlan(sort_sql) ==
+        "QUERY PLAN\n"
+        "|--SEARCH T USING INDEX TA (A>?)\n"
+        "`--USE TEMP B-TREE FOR ORDER BY\n");
+    CHECK(db.explainPlan(cte_sql) ==
+        "QUERY PLAN\n"
+        "|--CO-ROUTINE S\n"
+        "|  |--SETUP\n"
+        "|  |  `--SCAN CONSTANT ROW\n"
+        "|  `--RECURSIVE STEP\n"
+        "|     `--SCAN S\n"
+        "`--SCAN S\n");
+
+    bool thrown = false;
+    try { db.explainPlan("SELECT * FROM Nope"); } catch (const SQLite3Error &) { thrown = true; }
+    CHECK(thrown);
+
+    // off by default
+    CHECK(db.getPlanCheck() == SQLite3::PlanCheck::Off);
+    { SQLite3Stmt s(db, scan_sql); }
+    CHECK(db.getPlanIssues().empty());
+
+    // report: each issue once, also for statements compiled again
+    db.clearStmtCache();
+    db.setPlanCheck(SQLite3::PlanCheck::Report);
+    { SQLite3Stmt s(db, index_sql); }
+    { SQLite3Stmt s(db, cte_sql); }
+    { SQLite3Stmt s(db, "SELECT 1"); }
+    CHECK(db.getPlanIssues().empty());
+
+    { SQLite3Stmt s(db, scan_sql); }
+    { SQLite3Stmt s(db, scan_sql); }
+    db.setStmtCacheCapacity(0);
+    { SQLite3Stmt s(db, sort_sql); }
+    { SQLite3Stmt s(db, sort_sql); }
+    { SQLite3Stmt s(db, join_sql); }
+    db.execScript("SELECT count(*) FROM U; SELECT K FROM T WHERE A = 1;");
+    { SQLite3Stmt s(db, index_scan_sql); }
+
+    auto issues = db.getPlanIssues();
+    CHECK(issues.size() == 6);
+    CHECK(issues[0].kind == PlanIssue::FullScan && issues[0].sql == scan_sql && issues[0].detail == "SCAN T");
+    CHECK(issues[1].kind == PlanIssue::TempBTree && issues[1].sql == sort_sql);
+    CHECK(issues[2].kind == PlanIssue::FullScan && issues[2].sql == join_sql);
+    CHECK(issues[3].kind == PlanIssue::AutoIndex && issues[3].detail.find("AUTOMATIC") != std::string::npos);
+    CHECK(issues[4].kind == PlanIssue::FullScan && issues[4].sql == "SELECT count(*) FROM U;");
+    CHECK(issues[5].kind == PlanIssue::IndexScan && issues[5].detail == "SCAN T USING COVERING INDEX TA");
+    db.clearPlanIssues();
+    CHECK(db.getPlanIssues().empty());
+
+    // throw: only the selected kinds
+    db.setPlanCheck(SQLite3::PlanCheck::Throw, PlanIssue::TempBTree | PlanIssue::AutoIndex);
+    { SQLite3Stmt s(db, scan_sql); }
+    { SQLite3Stmt s(db, index_scan_sql); }
+    thrown = false;
+    try
+    {
+        SQLite3Stmt s(db, join_sql);
+    }
+    catch (const QueryPlanError & e)
+    {
+        thrown = true;
+        CHECK(e.issues().size() == 1);
+        CHECK(e.issues()[0].kind == PlanIssue::AutoIndex);
+        CHECK(std::string(e.what()).find(join_sql) != std::string::npos);
+    }
+    CHECK(thrown);
+
+    // an index fixes the plan
+    db("CREATE INDEX UB ON U (B);");
+    { SQLite3Stmt s(db, join_sql); }
+    db.setPlanCheck(SQLite3::PlanCheck::Off);
+    CHECK(db.getPlanIssues().empty());
+
+    return 0;
+}
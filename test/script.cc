@@ -0,0 +1,83 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const char * const setup =
+    "CREATE TABLE T (K INTEGER PRIMARY KEY, V TEXT);\n"
+    "-- later statements see the table created above\n"
+    "INSERT INTO T VALUES (1, 'one'), (2, 'two'), (3, NULL);\n"
+    "SELECT K, V FROM T ORDER BY K;\n";
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    // typed callback
+    std::vector<std::string> seen;
+    db.execScript(setup, [&seen](std::int64_t k, std::optional<std::string_view> v)
+        { seen.push_back(std::to_string(k) + "=" + std::string(v.value_or("null"))); });
+    CHECK((seen == std::vector<std::string>{"1=one", "2=two", "3=null"}));
+
+    // only statements with a matching number of columns reach a typed callback
+    std::int64_t sum = 0;
+    db.execScript(
+        "SELECT K, V FROM T; SELECT K FROM T; SELECT count(*) FROM T WHERE V IS NULL;",
+        [&sum](std::int64_t k) { sum += k; });
+    CHECK(sum == 1 + 2 + 3 + 1);
+
+    // RowReader callback gets every row
+    int rows = 0;
+    std::size_t cells = 0;
+    db.execScript("SELECT K, V FROM T; SELECT 42;", [&](SQLite3Stmt::RowReader & row)
+        { rows++; cells += row.size(); });
+    CHECK(rows == 4 && cells == 3 * 2 + 1);
+
+    // no callback, trailing comments and empty statements
+    db.execScript("DELETE FROM T WHERE K = 3;; -- done\n");
+    int count = -1;
+    db.execScript("SELECT count(*) FROM T", [&count](int n) { count = n; });
+    CHECK(count == 2);
+
+    // one-off statements do not fill the statement cache
+    db.setStmtCacheCapacity(8);
+    const auto before = db.getStmtCacheStats();
+    db.execScript("UPDATE T SET V = upper(V); SELECT 1;");
+    CHECK(db.getStmtCacheStats().size == before.size);
+
+    // cached scripts reuse their statements
+    const char * const bump = "UPDATE T SET K = K + 10; SELECT sum(K) FROM T;";
+    std::int64_t total = 0;
+    auto on_sum = [&total](std::int64_t s) { total = s; };
+    db.execScript(bump, on_sum, true);
+    CHECK(total == 23);
+    const auto first = db.getStmtCacheStats();
+    db.execScript(bump, on_sum, true);
+    CHECK(total == 43);
+    const auto second = db.getStmtCacheStats();
+    CHECK(second.hits == first.hits + 2 && second.misses == first.misses);
+
+    // a failing statement stops the script; earlier ones stay applied
+    bool threw = false;
+    try
+    {
+        db.execScript("INSERT INTO T VALUES (100, 'x'); SELECT * FROM Missing; INSERT INTO T VALUES (101, 'y');");
+    }
+    catch (const SQLite3Error &)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    db.execScript("SELECT count(*) FROM T", [&count](int n) { count = n; });
+    CHECK(count == 3);
+
+    return EXIT_SUCCESS;
+}
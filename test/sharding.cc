@@ -0,0 +1,106 @@
+#include <sqlite3w_shard.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static const std::vector<std::string> files = {
+    "test_shard_0.db", "test_shard_1.db", "test_shard_2.db", "test_shard_3.db" };
+
+static void remove_db()
+{
+    for (auto & f: files)
+    {
+        std::remove(f.c_str());
+        std::remove((f + "-journal").c_str());
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    remove_db();
+
+    {
+        ShardedSQLite3<std::int64_t> db(files);
+        CHECK(db.shardCount() == 4);
+
+        // the routing does not depend on the toolchain
+        CHECK(ShardHash<std::int64_t>()(1) == 0x89cd31291d2aefa4);
+        CHECK(ShardHash<std::string>()("a") == 0xaf63dc4c8601ec8c);
+        CHECK(db.shardOf(1) == 0x89cd31291d2aefa4 % 4);
+
+        db.executeAll("CREATE TABLE Events (Id INTEGER PRIMARY KEY, User INTEGER, Name TEXT);");
+
+        // concurrent writers, routed by user id
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; t++)
+        {
+            writers.emplace_back([&db, t]
+            {
+                for (std::int64_t i = t; i < 400; i += 4)
+                    db.execute(i % 37, "INSERT INTO Events VALUES (?, ?, ?)", i, i % 37, "e" + std::to_string(i));
+            });
+        }
+        for (auto & th: writers)
+            th.join();
+
+        // every user lives on exactly one shard
+        for (std::size_t s = 0; s < db.shardCount(); s++)
+        {
+            const auto wrong = db.withShard(s, [&db, s](SQLite3 & conn)
+            {
+                SQLite3Stmt sel(conn, "SELECT DISTINCT User FROM Events");
+                int bad = 0;
+                if (sel())
+                {
+                    for (auto [user]: sel.rows<std::int64_t>())
+                        bad += db.shardOf(user) != s;
+                }
+                return bad;
+            });
+            CHECK(wrong == 0);
+        }
+
+        auto all = db.query<std::int64_t, std::string>("SELECT Id, Name FROM Events");
+        CHECK(all.size() == 400);
+
+        auto ordered = db.queryMerged<0, std::int64_t, std::string>(
+            "SELECT Id, Name FROM Events WHERE Id >= ? ORDER BY Id", 100);
+        CHECK(ordered.size() == 300);
+        for (std::size_t i = 0; i < ordered.size(); i++)
+            CHECK(std::get<0>(ordered[i]) == static_cast<std::int64_t>(100 + i));
+        CHECK(std::get<1>(ordered.back()) == "e399");
+
+        auto counts = db.query<std::int64_t>("SELECT count(*) FROM Events WHERE User = ?", 5);
+        std::int64_t total = 0, non_empty = 0;
+        for (auto [n]: counts)
+        {
+            total += n;
+            non_empty += n != 0;
+        }
+        CHECK(total == 11 && non_empty == 1);
+
+        // errors from any shard reach the caller
+        bool thrown = false;
+        try
+        {
+            db.query<std::int64_t>("SELECT Missing FROM Events");
+        }
+        catch (const SQLite3Error &)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+
+    remove_db();
+    return 0;
+}
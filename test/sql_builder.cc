@@ -0,0 +1,74 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE Users (Id INTEGER PRIMARY KEY, Name TEXT, Age INTEGER);");
+
+    // compile-time statements
+    {
+        auto ins = db.makeInsert<"Users", "Id, Name, Age">();
+        ins(1, "ann", 30);
+        ins.reset();
+        ins(2, "ben", 17);
+    }
+    {
+        auto upd = db.makeUpdate<"Users", "Name,Age", "Id=?">();
+        upd("bob", 18, 2);
+    }
+    {
+        auto sel = db.makeSelect<"Users", "Name", "Age>?">();
+        std::string names;
+        for (auto [name]: sel.rows<std::string_view>())
+            names += name;
+        CHECK(names.empty()); // parameter left NULL
+        CHECK(sel(17));
+        for (auto [name]: sel.rows<std::string_view>())
+            names += name;
+        CHECK(names == "annbob");
+    }
+    {
+        auto del = db.makeDelete<"Users", "Age<?">();
+        del(20);
+        auto cnt = db.makeSelect<"Users", "count(*)">();
+        CHECK(cnt());
+        CHECK(cnt.begin()->readInteger(0) == 1);
+    }
+
+    // runtime statements longer than the initial buffer
+    std::string cols, vals;
+    db("CREATE TABLE Wide (C0 INTEGER);");
+    for (int i = 1; i < 200; i++)
+        db(("ALTER TABLE Wide ADD COLUMN Column_With_A_Long_Name_" + std::to_string(i) + " INTEGER;").c_str());
+    for (int i = 1; i < 200; i++)
+    {
+        cols += (i == 1 ? "" : ",") + std::string("Column_With_A_Long_Name_") + std::to_string(i);
+        vals += (i == 1 ? "?" : ",?");
+    }
+    db.makeInsert("Wide", cols.c_str(), vals.c_str())();
+    {
+        auto sel = db.makeSelect("Wide", cols.c_str());
+        CHECK(sel());
+        CHECK(sel.begin()->size() == 199);
+    }
+
+    // runtime UPDATE with several assignments
+    db.makeUpdate("Wide", {{"C0", "1"}, {"Column_With_A_Long_Name_1", "2"}}, nullptr)();
+    {
+        auto sel = db.makeSelect("Wide", "C0 + Column_With_A_Long_Name_1");
+        CHECK(sel());
+        CHECK(sel.begin()->readInteger(0) == 3);
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY, V INTEGER NOT NULL);");
+    db.setStmtCacheCapacity(2);
+
+    for (int i = 0; i < 100; i++)
+    {
+        SQLite3Stmt stmt(db, "INSERT INTO T (K, V) VALUES (?, ?)");
+        stmt(i, i * i);
+    }
+
+    auto stats = db.getStmtCacheStats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.hits == 99);
+    CHECK(stats.size == 1);
+
+    // whitespace and trailing semicolons do not change the key
+    {
+        SQLite3Stmt stmt(db, "INSERT INTO T (K, V)\n    VALUES (?, ?);");
+    }
+    CHECK(db.getStmtCacheStats().hits == 100);
+
+    // comments are part of the key: here the newline ends the comment
+    {
+        SQLite3Stmt a(db, "SELECT 1 -- x\n + 1");
+        CHECK(a());
+        CHECK(a.begin()->readInteger(0) == 2);
+    }
+    {
+        SQLite3Stmt b(db, "SELECT 1 -- x + 1");
+        CHECK(b());
+        CHECK(b.begin()->readInteger(0) == 1);
+    }
+
+    // input holding several statements is keyed as given
+    {
+        SQLite3Stmt a(db, "SELECT 3; SELECT 4");
+    }
+    {
+        const auto hits = db.getStmtCacheStats().hits;
+        SQLite3Stmt b(db, "SELECT 3; SELECT 4");
+        CHECK(db.getStmtCacheStats().hits == hits + 1);
+    }
+
+    // cached statements come back reset, with bindings cleared
+    for (int i = 0; i < 3; i++)
+    {
+        SQLite3Stmt stmt = db.makeSelect("T", "V", "K=?");
+        CHECK(stmt(7));
+        CHECK(stmt.begin()->readInteger(0) == 49);
+    }
+
+    // two statements alive at once with the same text do not share a handle
+    {
+        SQLite3Stmt a(db, "SELECT count(*) FROM T");
+        SQLite3Stmt b(db, "SELECT count(*) FROM T");
+        CHECK(a() && b());
+        CHECK(a.begin()->readInteger(0) == 100);
+        CHECK(b.begin()->readInteger(0) == 100);
+    }
+
+    // exceeding the capacity evicts the least recently used statement
+    {
+        SQLite3Stmt stmt(db, "SELECT max(V) FROM T");
+    }
+    stats = db.getStmtCacheStats();
+    CHECK(stats.size == 2);
+    CHECK(stats.evictions >= 1);
+
+    db.setStmtCacheCapacity(0);
+    CHECK(db.getStmtCacheStats().size == 0);
+
+    return 0;
+}
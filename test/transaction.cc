@@ -0,0 +1,83 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static std::int64_t count(SQLite3 & db)
+{
+    SQLite3Stmt stmt(db, "SELECT count(*) FROM T");
+    stmt();
+    return stmt.begin()->readInteger(0);
+}
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db("CREATE TABLE T (K INTEGER PRIMARY KEY);");
+
+    // committed transaction
+    {
+        SQLite3::Transaction txn(db, SQLite3::TransactionMode::Immediate);
+        CHECK(db.inTransaction());
+        db("INSERT INTO T VALUES (1);");
+        txn.commit();
+        CHECK(!txn);
+    }
+    CHECK(!db.inTransaction());
+    CHECK(count(db) == 1);
+
+    // exception unwinds through the guard and rolls back
+    try
+    {
+        SQLite3::Transaction txn(db);
+        db("INSERT INTO T VALUES (2);");
+        db("INSERT INTO T VALUES (1);"); // constraint violation
+        txn.commit();
+    }
+    catch (const SQLite3Error & e)
+    {
+        std::cout << "expected error: " << e.what() << '\n';
+    }
+    CHECK(!db.inTransaction());
+    CHECK(count(db) == 1);
+
+    // nested savepoints
+    {
+        SQLite3::Transaction txn(db, SQLite3::TransactionMode::Exclusive);
+        db("INSERT INTO T VALUES (10);");
+        {
+            SQLite3::Savepoint sp(db);
+            db("INSERT INTO T VALUES (11);");
+            {
+                SQLite3::Savepoint inner(db);
+                db("INSERT INTO T VALUES (12);");
+            } // rolled back
+            sp.commit();
+        }
+        {
+            SQLite3::Savepoint sp(db);
+            db("INSERT INTO T VALUES (13);");
+            sp.rollback();
+        }
+        txn.commit();
+    }
+    CHECK(count(db) == 3);
+
+    // a savepoint outside a transaction opens and commits its own
+    {
+        SQLite3::Savepoint sp(db);
+        CHECK(db.inTransaction());
+        db("INSERT INTO T VALUES (20);");
+        sp.commit();
+    }
+    CHECK(!db.inTransaction());
+    CHECK(count(db) == 4);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+// primary result codes, to avoid including sqlite3.h here
+static constexpr int rc_error = 1, rc_constraint = 19, rc_range = 25;
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    CHECK(db.tryExec("CREATE TABLE T (K INTEGER PRIMARY KEY, V TEXT NOT NULL);"));
+
+    const auto bad = db.tryExec("SELECT * FROM Missing;");
+    CHECK(!bad && bad.errcode() == rc_error);
+    CHECK(std::strstr(bad.message(), "Missing") != nullptr);
+
+    // expected constraint violations do not throw
+    SQLite3Stmt ins(db, "INSERT INTO T (K, V) VALUES (?, ?)");
+    int inserted = 0, conflicts = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        const auto res = ins.tryExec(i % 50, std::string("v") + std::to_string(i));
+        if (res)
+            inserted++;
+        else if ((res.error().errcode() & 0xff) == rc_constraint)
+            conflicts++;
+        ins.reset();
+    }
+    CHECK(inserted == 50 && conflicts == 50);
+
+    // step failures and binding failures
+    {
+        const auto res = ins.tryExec(1000, nullptr); // NOT NULL
+        CHECK(!res.has_value() && (res.error().errcode() & 0xff) == rc_constraint);
+        ins.reset();
+        CHECK(!ins.tryBindInteger(3, 0));
+        CHECK(ins.tryBindInteger(3, 0).errcode() == rc_range);
+        CHECK(ins.tryBindText(9, std::string("x")).errcode() == rc_range);
+    }
+
+    {
+        SQLite3Stmt cnt(db, "SELECT count(*) FROM T");
+        auto res = cnt.tryExec();
+        CHECK(res && *res);
+        CHECK(cnt.begin()->readInteger(0) == 50);
+    }
+
+    // manual stepping
+    {
+        SQLite3Stmt sel(db, "SELECT K FROM T ORDER BY K");
+        int rows = 0;
+        for (;;)
+        {
+            auto res = sel.tryStep();
+            CHECK(res);
+            if (!*res)
+                break;
+            rows++;
+        }
+        CHECK(rows == 50);
+    }
+
+    // the throwing layer reports the same code and message
+    try
+    {
+        ins(1, "dup");
+        CHECK(false);
+    }
+    catch (const SQLite3Error & e)
+    {
+        CHECK((e.errcode() & 0xff) == rc_constraint);
+        CHECK(std::strstr(e.what(), "UNIQUE") != nullptr);
+    }
+
+    const auto value = SQLite3Result<int>(SQLite3Status(rc_error)).value_or(-1);
+    CHECK(value == -1);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+static_assert(std::ranges::input_range<
+    SQLite3Stmt::RowRange<std::int64_t, double, std::string_view>>);
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    db(R"#(CREATE TABLE Scores (Id INTEGER PRIMARY KEY, Score REAL, Name TEXT, Note TEXT);
+        INSERT INTO Scores VALUES (1, 9.5, 'alice', 'top');
+        INSERT INTO Scores VALUES (2, 7.25, 'bob', NULL);
+        INSERT INTO Scores VALUES (3, 8.0, 'carol', 'x');)#");
+
+    SQLite3Stmt stmt(db, "SELECT Id, Score, Name, Note FROM Scores ORDER BY Id");
+
+    std::int64_t id_sum = 0;
+    double score_sum = 0;
+    std::string names;
+    int nulls = 0;
+
+    for (auto [id, score, name, note]:
+            stmt.rows<std::int64_t, double, std::string_view, std::optional<std::string>>())
+    {
+        id_sum += id;
+        score_sum += score;
+        names += name;
+        if (!note)
+            nulls++;
+    }
+
+    CHECK(id_sum == 6);
+    CHECK(score_sum == 24.75);
+    CHECK(names == "alicebobcarol");
+    CHECK(nulls == 1);
+
+    // the statement was reset, so it can be iterated again
+    int n = 0;
+    for (auto [id]: stmt.rows<int>())
+        n += id;
+    CHECK(n == 6);
+
+    // continue from a row reached through operator()
+    SQLite3Stmt sel(db, "SELECT Name FROM Scores WHERE Id >= ? ORDER BY Id");
+    CHECK(sel(2));
+    std::string rest;
+    for (auto [name]: sel.rows<const char *>())
+        rest += name;
+    CHECK(rest == "bobcarol");
+
+    // no results
+    CHECK(!sel(10));
+    std::size_t count = 0;
+    for ([[maybe_unused]] auto [name]: sel.rows<std::string>())
+        count++;
+    CHECK(count == 0);
+
+    // a statement that has run to the end is not run again
+    db("CREATE TABLE Runs (N INTEGER);"
+       "INSERT INTO Runs VALUES (0);");
+    SQLite3Stmt bump(db, "UPDATE Runs SET N = N + 1");
+    CHECK(!bump());
+    for ([[maybe_unused]] auto [n]: bump.rows<int>())
+        count++;
+    CHECK(count == 0);
+    SQLite3Stmt runs(db, "SELECT N FROM Runs");
+    CHECK(runs());
+    CHECK(runs.begin()->readInteger(0) == 1);
+
+    auto view = stmt.rows<std::int64_t>()
+        | std::views::transform([](auto row) { return std::get<0>(row) * 10; });
+    std::int64_t total = 0;
+    for (auto v: view)
+        total += v;
+    CHECK(total == 60);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <sqlite3w.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace hgl;
+
+#define CHECK(EXPR) \
+    if (!(EXPR)) { std::cerr << __LINE__ << ": check failed: " #EXPR "\n"; return EXIT_FAILURE; }
+
+struct City
+{
+    std::int64_t               id;
+    std::string                name;
+    double                     population;
+    std::optional<std::string> country;
+};
+
+static std::vector<std::int64_t> ids(SQLite3 & db, const char * sql)
+{
+    SQLite3Stmt stmt(db, sql);
+    std::vector<std::int64_t> out;
+    if (stmt())
+    {
+        for (auto [id]: stmt.rows<std::int64_t>())
+            out.push_back(id);
+    }
+    return out;
+}
+
+int main(int argc, char const *argv[])
+{
+    SQLite3 db;
+
+    // deliberately not sorted by id
+    const std::vector<City> cities = {
+        {30, "Lyon", 0.52, "FR"},
+        {10, "Paris", 2.1, "FR"},
+        {50, "Porto", 0.23, std::nullopt},
+        {20, "Berlin", 3.6, "DE"},
+        {40, "Hamburg", 1.8, "DE"},
+    };
+
+    db.defineTable<
+        VTableKey<"id", &City::id>,
+        VTableColumn<"name", &City::name>,
+        VTableColumn<"population", &City::population>,
+        VTableColumn<"country", &City::country>>("cities", cities);
+
+    CHECK((ids(db, "SELECT id FROM cities") == std::vector<std::int64_t>{10, 20, 30, 40, 50}));
+    CHECK((ids(db, "SELECT id FROM cities WHERE id = 40") == std::vector<std::int64_t>{40}));
+    CHECK((ids(db, "SELECT id FROM cities WHERE id > 20 AND id <= 40") == std::vector<std::int64_t>{30, 40}));
+    CHECK((ids(db, "SELECT id FROM cities WHERE id < 25.5") == std::vector<std::int64_t>{10, 20}));
+    CHECK((ids(db, "SELECT id FROM cities WHERE id >= 45 ORDER BY id") == std::vector<std::int64_t>{50}));
+    CHECK(ids(db, "SELECT id FROM cities WHERE id = NULL").empty());
+    CHECK((ids(db, "SELECT id FROM cities WHERE id = '30'") == std::vector<std::int64_t>{30}));
+    CHECK((ids(db, "SELECT id FROM cities WHERE country IS NULL") == std::vector<std::int64_t>{50}));
+    CHECK((ids(db, "SELECT id FROM cities ORDER BY id DESC") == std::vector<std::int64_t>{50, 40, 30, 20, 10}));
+
+    {
+        SQLite3Stmt plan(db, "EXPLAIN QUERY PLAN SELECT name FROM cities WHERE id = ?");
+        CHECK(plan());
+        CHECK(std::string(plan.begin()->readText(3)).find("VIRTUAL TABLE INDEX 1") != std::string::npos);
+    }
+
+    // join a real table against the container
+    db("CREATE TABLE Visits (City INTEGER, Days INTEGER);");
+    db("INSERT INTO Visits VALUES (10, 3), (40, 2), (10, 1), (99, 5);");
+    {
+        SQLite3Stmt sel(db,
+            "SELECT c.name, sum(v.Days) FROM Visits v JOIN cities c ON c.id = v.City "
+            "GROUP BY c.name ORDER BY c.name");
+        CHECK(sel());
+        std::vector<std::string> out;
+        for (auto [name, days]: sel.rows<std::string, std::int64_t>())
+            out.push_back(name + ":" + std::to_string(days));
+        CHECK((out == std::vector<std::string>{"Hamburg:2", "Paris:4"}));
+    }
+
+    // keyless, named table in the temp schema
+    const std::vector<std::pair<std::string, double>> rates = {{"EUR", 1.0}, {"USD", 0.92}};
+    db.defineTable<
+        VTableColumn<"code", &std::pair<std::string, double>::first>,
+        VTableColumn<"rate", &std::pair<std::string, double>::second>>("rates", rates, false);
+    {
+        SQLite3Stmt sel(db, "SELECT rate FROM temp.rates WHERE code = 'USD'");
+        CHECK(sel());
+        CHECK(sel.begin()->readFloat(0) == 0.92);
+    }
+
+    // text key: a constraint under another collation is not used to narrow
+    db.defineTable<
+        VTableKey<"name", &City::name>,
+        VTableColumn<"id", &City::id>>("cities_by_name", cities);
+    CHECK((ids(db, "SELECT id FROM cities_by_name WHERE name = 'Lyon'") == std::vector<std::int64_t>{30}));
+    CHECK(ids(db, "SELECT id FROM cities_by_name WHERE name = 'LYON'").empty());
+    CHECK((ids(db, "SELECT id FROM cities_by_name WHERE name = 'LYON' COLLATE NOCASE") == std::vector<std::int64_t>{30}));
+    CHECK((ids(db, "SELECT id FROM cities_by_name WHERE name >= 'h' COLLATE NOCASE ORDER BY name")
+        == std::vector<std::int64_t>{40, 30, 10, 50}));
+
+    // read-only
+    bool thrown = false;
+    try
+    {
+        db("DELETE FROM cities;");
+    }
+    catch (const SQLite3Error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    return 0;
+}